@@ -0,0 +1,263 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Bump allocator for the scratch memory of a single evaluation. Memory is
+ * carved out of large blocks and never freed piece by piece; arena_reset()
+ * takes all of it back in O(1) but keeps the blocks, so once an arena has
+ * grown to fit the largest expression it serves every later one without
+ * calling malloc(). An arena is not thread safe: every thread that
+ * evaluates expressions owns its own.
+ *
+ * Every function also accepts a NULL arena, in which case the memory comes
+ * from the C heap and must be given back with arena_release() or free().
+ */
+
+#define ARENA_BLOCK_BYTES 4096 // Capacity of the first block
+#define ARENA_ALIGN 16         // Alignment of every allocation
+
+/*
+ * ArenaBlock
+ * ----------
+ * Header of one block of arena memory; the usable bytes follow it.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock* next; // Next block in the chain, or NULL
+    size_t capacity;         // Usable bytes after the header
+} ArenaBlock;
+
+/* Size of a block header, rounded up so that block data stays aligned */
+#define ARENA_HEADER_BYTES \
+    ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/*
+ * ArenaStats
+ * ----------
+ * Allocation counters of an arena. Once the arena has warmed up,
+ * heapAllocations stays constant while allocations keeps growing.
+ */
+typedef struct {
+    size_t allocations;     // Allocations served by the arena
+    size_t heapAllocations; // Blocks obtained from malloc()
+    size_t resets;          // Calls to arena_reset()
+    size_t reservedBytes;   // Bytes held in blocks
+} ArenaStats;
+
+/*
+ * Arena
+ * -----
+ * A chain of blocks and a cursor into it. Blocks before current are full,
+ * current has used bytes taken, and any blocks after it are free.
+ */
+typedef struct {
+    ArenaBlock* head;    // First block, or NULL before the first allocation
+    ArenaBlock* current; // Block new allocations are carved from
+    size_t used;         // Bytes taken from current
+    void* last;          // Most recent allocation, which can grow in place
+    ArenaStats stats;    // Allocation counters
+} Arena;
+
+/*
+ * arena_init()
+ * ------------
+ * Initialises an empty arena. No memory is allocated until it is needed.
+ */
+static inline void arena_init(Arena* a)
+{
+    a->head = NULL;
+    a->current = NULL;
+    a->used = 0;
+    a->last = NULL;
+    memset(&a->stats, 0, sizeof(a->stats));
+}
+
+/*
+ * arena_free()
+ * ------------
+ * Returns every block to the heap and leaves the arena empty.
+ */
+static inline void arena_free(Arena* a)
+{
+    ArenaBlock* block = a->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena_init(a);
+}
+
+/*
+ * arena_reset()
+ * -------------
+ * Takes back every allocation at once, keeping the blocks for reuse.
+ * Pointers obtained from the arena before the reset become invalid.
+ */
+static inline void arena_reset(Arena* a)
+{
+    if (!a) {
+        return;
+    }
+    a->current = a->head;
+    a->used = 0;
+    a->last = NULL;
+    a->stats.resets++;
+}
+
+static inline char* arena_block_data(ArenaBlock* block)
+{
+    return (char*)block + ARENA_HEADER_BYTES;
+}
+
+static inline size_t arena_round(size_t size)
+{
+    return size ? (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) : ARENA_ALIGN;
+}
+
+/*
+ * arena_alloc()
+ * -------------
+ * Allocates size bytes aligned to ARENA_ALIGN. When the current block is
+ * full the arena moves on to the next free block, and only allocates a new
+ * one (at least twice the size of the last) when every block is in use.
+ *
+ * Returns: Pointer to the memory, or NULL on allocation failure.
+ */
+static inline void* arena_alloc(Arena* a, size_t size)
+{
+    if (!a) {
+        return malloc(size ? size : 1);
+    }
+
+    size_t rounded = arena_round(size);
+    if (rounded < size) {
+        return NULL;  // Overflow
+    }
+
+    while (a->current && a->current->capacity - a->used < rounded && a->current->next) {
+        a->current = a->current->next;
+        a->used = 0;
+    }
+
+    if (!a->current || a->current->capacity - a->used < rounded) {
+        size_t capacity = a->current ? a->current->capacity * 2 : ARENA_BLOCK_BYTES;
+        if (capacity < rounded) {
+            capacity = rounded;
+        }
+        ArenaBlock* block = (ArenaBlock*)malloc(ARENA_HEADER_BYTES + capacity);
+        if (!block) {
+            return NULL;
+        }
+        block->next = NULL;
+        block->capacity = capacity;
+        if (a->current) {
+            a->current->next = block;
+        } else {
+            a->head = block;
+        }
+        a->current = block;
+        a->used = 0;
+        a->stats.heapAllocations++;
+        a->stats.reservedBytes += capacity;
+    }
+
+    void* p = arena_block_data(a->current) + a->used;
+    a->used += rounded;
+    a->last = p;
+    a->stats.allocations++;
+    return p;
+}
+
+/*
+ * arena_grow()
+ * ------------
+ * Resizes an allocation to newSize bytes, preserving its contents. The
+ * most recent allocation is extended in place when its block has room,
+ * so a buffer that is built up by repeated appends costs no copies.
+ *
+ * p: Allocation to resize (may be NULL)
+ * oldSize: Current size of the allocation
+ * newSize: Size required
+ *
+ * Returns: Pointer to the resized memory, or NULL on allocation failure
+ *          (in which case p is left untouched).
+ */
+static inline void* arena_grow(Arena* a, void* p, size_t oldSize, size_t newSize)
+{
+    if (!a) {
+        return realloc(p, newSize ? newSize : 1);
+    }
+    if (!p) {
+        return arena_alloc(a, newSize);
+    }
+
+    if (p == a->last) {
+        size_t offset = (size_t)((char*)p - arena_block_data(a->current));
+        size_t rounded = arena_round(newSize);
+        if (rounded >= newSize && a->current->capacity - offset >= rounded) {
+            a->used = offset + rounded;
+            return p;
+        }
+    }
+
+    void* grown = arena_alloc(a, newSize);
+    if (grown) {
+        memcpy(grown, p, oldSize < newSize ? oldSize : newSize);
+    }
+    return grown;
+}
+
+/*
+ * arena_release()
+ * ---------------
+ * Gives back an allocation. Heap memory is freed; arena memory is only
+ * reclaimed if it was the most recent allocation, and otherwise waits for
+ * the next arena_reset().
+ */
+static inline void arena_release(Arena* a, void* p)
+{
+    if (!a) {
+        free(p);
+        return;
+    }
+    if (p && p == a->last) {
+        a->used = (size_t)((char*)p - arena_block_data(a->current));
+        a->last = NULL;
+    }
+}
+
+/*
+ * arena_strndup()
+ * ---------------
+ * Copies len characters of s into a new null terminated string.
+ *
+ * Returns: The copy, or NULL on allocation failure.
+ */
+static inline char* arena_strndup(Arena* a, const char* s, size_t len)
+{
+    char* copy = (char*)arena_alloc(a, len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/*
+ * arena_stats_add()
+ * -----------------
+ * Adds the counters of one arena to a running total.
+ */
+static inline void arena_stats_add(ArenaStats* total, const ArenaStats* stats)
+{
+    total->allocations += stats->allocations;
+    total->heapAllocations += stats->heapAllocations;
+    total->resets += stats->resets;
+    total->reservedBytes += stats->reservedBytes;
+}
+
+#endif /* ARENA_H */
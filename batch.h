@@ -0,0 +1,516 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "uqbasejump.h"
+
+/*
+ * Column conversion: many 64-bit values written out in one base at once.
+ * Each value is split into 32-bit chunks of RADIX_CHUNKS[base].digits32
+ * digits, and the chunks of several values are then taken apart digit by
+ * digit side by side in vector lanes. Every division is a multiplication
+ * by a reciprocal ("magic number") worked out once per base, so no divide
+ * instruction is issued per value. Lanes are eight 32-bit chunks with
+ * AVX2, four with SSE2 or NEON, and four scalar slots everywhere else (or
+ * when DIGITS_SCALAR_ONLY is defined, see digits.h).
+ *
+ * convert_int_to_str_any_base() remains the reference: for every value and
+ * base the digits produced here are exactly the digits it produces.
+ */
+
+#if defined(DIGITS_AVX2)
+#define BATCH_VECTOR
+#define BATCH_LANES 8
+typedef __m256i BatchLanes;
+#elif defined(DIGITS_SSE2)
+#define BATCH_VECTOR
+#define BATCH_LANES 4
+typedef __m128i BatchLanes;
+#elif defined(DIGITS_NEON)
+#define BATCH_VECTOR
+#define BATCH_LANES 4
+typedef uint32x4_t BatchLanes;
+#else
+#define BATCH_LANES 4
+#endif
+
+/*
+ * RadixMagic
+ * ----------
+ * Reciprocal of a divisor that is not a power of two, in the form used by
+ * libdivide: n / d == mulhi(n, multiplier) >> shift, or, when the exact
+ * multiplier needs one bit more than the word, the "add" form
+ * ((n - q) / 2 + q) >> shift with q = mulhi(n, multiplier).
+ */
+typedef struct {
+    uint32_t multiplier; // Low 32 bits of the reciprocal
+    int shift;           // floor(log2(divisor))
+    bool add;            // Whether the reciprocal needed 33 bits
+} RadixMagic;
+
+/*
+ * RadixMagic64
+ * ------------
+ * 64-bit counterpart of RadixMagic, used to split values into chunks.
+ */
+typedef struct {
+    uint64_t multiplier; // Low 64 bits of the reciprocal
+    int shift;           // floor(log2(divisor))
+    bool add;            // Whether the reciprocal needed 65 bits
+} RadixMagic64;
+
+/*
+ * radix_magic()
+ * -------------
+ * Works out the reciprocal of a 32-bit divisor d, which must be at least
+ * 3 and not a power of two.
+ */
+static inline RadixMagic radix_magic(uint32_t d)
+{
+    RadixMagic magic;
+    int log2d = 31 - __builtin_clz(d);
+    uint64_t numerator = (uint64_t)1 << (32 + log2d);
+    uint32_t m = (uint32_t)(numerator / d);
+    uint32_t rem = (uint32_t)(numerator % d);
+
+    magic.shift = log2d;
+    magic.add = d - rem >= (1u << log2d);
+    if (magic.add) {
+        // One more bit of precision, with the top bit left implicit
+        uint32_t twiceRem = rem + rem;
+        m += m;
+        if (twiceRem >= d || twiceRem < rem) {
+            m++;
+        }
+    }
+    magic.multiplier = m + 1;
+    return magic;
+}
+
+/*
+ * radix_magic_divide()
+ * --------------------
+ * Returns n / d for the divisor whose reciprocal is magic. This is the
+ * scalar form of the lane kernels below.
+ */
+static inline uint32_t radix_magic_divide(uint32_t n, const RadixMagic* magic)
+{
+    uint32_t q = (uint32_t)(((uint64_t)n * magic->multiplier) >> 32);
+    if (magic->add) {
+        return (((n - q) >> 1) + q) >> magic->shift;
+    }
+    return q >> magic->shift;
+}
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 BatchU128;
+
+/*
+ * radix_magic64()
+ * ---------------
+ * Works out the reciprocal of a 64-bit divisor d, which must be at least
+ * 3 and not a power of two.
+ */
+static inline RadixMagic64 radix_magic64(uint64_t d)
+{
+    RadixMagic64 magic;
+    int log2d = 63 - __builtin_clzll(d);
+    BatchU128 numerator = (BatchU128)1 << (64 + log2d);
+    uint64_t m = (uint64_t)(numerator / d);
+    uint64_t rem = (uint64_t)(numerator % d);
+
+    magic.shift = log2d;
+    magic.add = d - rem >= ((uint64_t)1 << log2d);
+    if (magic.add) {
+        uint64_t twiceRem = rem + rem;
+        m += m;
+        if (twiceRem >= d || twiceRem < rem) {
+            m++;
+        }
+    }
+    magic.multiplier = m + 1;
+    return magic;
+}
+
+/*
+ * radix_magic64_divide()
+ * ----------------------
+ * Returns n / d for the 64-bit divisor whose reciprocal is magic.
+ */
+static inline uint64_t radix_magic64_divide(uint64_t n, const RadixMagic64* magic)
+{
+    uint64_t q = (uint64_t)(((BatchU128)n * magic->multiplier) >> 64);
+    if (magic->add) {
+        return (((n - q) >> 1) + q) >> magic->shift;
+    }
+    return q >> magic->shift;
+}
+#endif /* __SIZEOF_INT128__ */
+
+#ifdef BATCH_VECTOR
+/*
+ * batch_divide()
+ * --------------
+ * Divides every lane of n by the divisor whose reciprocal is magic, and
+ * stores the remainders (n - quotient * d) in rem.
+ *
+ * Returns: The quotients.
+ */
+#if defined(DIGITS_AVX2)
+static inline BatchLanes batch_divide(BatchLanes n, const RadixMagic* magic, uint32_t d,
+        BatchLanes* rem)
+{
+    __m256i m = _mm256_set1_epi32((int)magic->multiplier);
+    __m128i shift = _mm_cvtsi32_si128(magic->shift);
+    // High halves of the even and odd 32x32-bit products
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(n, m), 32);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(n, 32), m);
+    __m256i q = _mm256_blend_epi32(even, odd, 0xAA);
+    if (magic->add) {
+        q = _mm256_add_epi32(_mm256_srli_epi32(_mm256_sub_epi32(n, q), 1), q);
+    }
+    q = _mm256_srl_epi32(q, shift);
+    *rem = _mm256_sub_epi32(n, _mm256_mullo_epi32(q, _mm256_set1_epi32((int)d)));
+    return q;
+}
+#elif defined(DIGITS_SSE2)
+static inline BatchLanes batch_divide(BatchLanes n, const RadixMagic* magic, uint32_t d,
+        BatchLanes* rem)
+{
+    __m128i m = _mm_set1_epi32((int)magic->multiplier);
+    __m128i shift = _mm_cvtsi32_si128(magic->shift);
+    __m128i high = _mm_set_epi32(-1, 0, -1, 0);
+    // High halves of the even and odd 32x32-bit products
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(n, m), 32);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(n, 32), m);
+    __m128i q = _mm_or_si128(even, _mm_and_si128(odd, high));
+    if (magic->add) {
+        q = _mm_add_epi32(_mm_srli_epi32(_mm_sub_epi32(n, q), 1), q);
+    }
+    q = _mm_srl_epi32(q, shift);
+    // SSE2 has no 32-bit mullo; the products of small quotients are exact
+    __m128i dd = _mm_set1_epi32((int)d);
+    __m128i evenProduct = _mm_mul_epu32(q, dd);
+    __m128i oddProduct = _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(q, 32), dd), 32);
+    __m128i product = _mm_or_si128(_mm_andnot_si128(high, evenProduct), oddProduct);
+    *rem = _mm_sub_epi32(n, product);
+    return q;
+}
+#else
+static inline BatchLanes batch_divide(BatchLanes n, const RadixMagic* magic, uint32_t d,
+        BatchLanes* rem)
+{
+    uint32x2_t m = vdup_n_u32(magic->multiplier);
+    uint64x2_t low = vmull_u32(vget_low_u32(n), m);
+    uint64x2_t top = vmull_u32(vget_high_u32(n), m);
+    uint32x4_t q = vcombine_u32(vshrn_n_u64(low, 32), vshrn_n_u64(top, 32));
+    if (magic->add) {
+        q = vaddq_u32(vshrq_n_u32(vsubq_u32(n, q), 1), q);
+    }
+    q = vshlq_u32(q, vdupq_n_s32(-magic->shift));
+    *rem = vmlsq_n_u32(n, q, d);
+    return q;
+}
+#endif
+
+/*
+ * batch_pack_digits()
+ * -------------------
+ * Turns the remainders of four consecutive steps, most significant (d3)
+ * first, into digit characters grouped by lane: the four characters of
+ * lane l, in print order, are stored at out + 4 * l.
+ */
+#if defined(DIGITS_AVX2)
+static inline void batch_pack_digits(BatchLanes d3, BatchLanes d2, BatchLanes d1,
+        BatchLanes d0, char* out)
+{
+    // 4x4 transpose within each 128-bit half, then narrow to bytes
+    __m256i low01 = _mm256_unpacklo_epi32(d3, d2);
+    __m256i high01 = _mm256_unpackhi_epi32(d3, d2);
+    __m256i low23 = _mm256_unpacklo_epi32(d1, d0);
+    __m256i high23 = _mm256_unpackhi_epi32(d1, d0);
+    __m256i words = _mm256_packs_epi32(_mm256_unpacklo_epi64(low01, low23),
+                                       _mm256_unpackhi_epi64(low01, low23));
+    __m256i moreWords = _mm256_packs_epi32(_mm256_unpacklo_epi64(high01, high23),
+                                           _mm256_unpackhi_epi64(high01, high23));
+    __m256i digits = _mm256_packus_epi16(words, moreWords);
+    __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(digits, _mm256_set1_epi8(9)),
+                                       _mm256_set1_epi8('A' - '0' - 10));
+    digits = _mm256_add_epi8(digits, _mm256_add_epi8(letters, _mm256_set1_epi8('0')));
+    _mm256_storeu_si256((__m256i*)out, digits);
+}
+#elif defined(DIGITS_SSE2)
+static inline void batch_pack_digits(BatchLanes d3, BatchLanes d2, BatchLanes d1,
+        BatchLanes d0, char* out)
+{
+    __m128i low01 = _mm_unpacklo_epi32(d3, d2);
+    __m128i high01 = _mm_unpackhi_epi32(d3, d2);
+    __m128i low23 = _mm_unpacklo_epi32(d1, d0);
+    __m128i high23 = _mm_unpackhi_epi32(d1, d0);
+    __m128i words = _mm_packs_epi32(_mm_unpacklo_epi64(low01, low23),
+                                    _mm_unpackhi_epi64(low01, low23));
+    __m128i moreWords = _mm_packs_epi32(_mm_unpacklo_epi64(high01, high23),
+                                        _mm_unpackhi_epi64(high01, high23));
+    __m128i digits = _mm_packus_epi16(words, moreWords);
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(digits, _mm_set1_epi8(9)),
+                                    _mm_set1_epi8('A' - '0' - 10));
+    digits = _mm_add_epi8(digits, _mm_add_epi8(letters, _mm_set1_epi8('0')));
+    _mm_storeu_si128((__m128i*)out, digits);
+}
+#else
+static inline void batch_pack_digits(BatchLanes d3, BatchLanes d2, BatchLanes d1,
+        BatchLanes d0, char* out)
+{
+    uint32x4x2_t t01 = vtrnq_u32(d3, d2);
+    uint32x4x2_t t23 = vtrnq_u32(d1, d0);
+    uint32x4_t lane0 = vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0]));
+    uint32x4_t lane1 = vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1]));
+    uint32x4_t lane2 = vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0]));
+    uint32x4_t lane3 = vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1]));
+    uint16x8_t words = vcombine_u16(vmovn_u32(lane0), vmovn_u32(lane1));
+    uint16x8_t moreWords = vcombine_u16(vmovn_u32(lane2), vmovn_u32(lane3));
+    uint8x16_t digits = vcombine_u8(vmovn_u16(words), vmovn_u16(moreWords));
+    uint8x16_t letters = vandq_u8(vcgtq_u8(digits, vdupq_n_u8(9)), vdupq_n_u8('A' - '0' - 10));
+    digits = vaddq_u8(digits, vaddq_u8(letters, vdupq_n_u8('0')));
+    vst1q_u8((uint8_t*)out, digits);
+}
+#endif
+#endif /* BATCH_VECTOR */
+
+/*
+ * batch_chunk_digits()
+ * --------------------
+ * Writes the low count digits of BATCH_LANES 32-bit chunks, zero padded,
+ * the digits of lane l ending just before ends[l], one digit of every lane
+ * per step.
+ */
+static inline void batch_chunk_digits(const uint32_t* chunks, int count, uint32_t base,
+        const RadixMagic* magic, char* const* ends)
+{
+#ifdef BATCH_VECTOR
+    uint32_t digits[BATCH_LANES];
+    char packed[BATCH_LANES * 4];
+#if defined(DIGITS_AVX2)
+    BatchLanes n = _mm256_loadu_si256((const __m256i*)chunks);
+#elif defined(DIGITS_SSE2)
+    BatchLanes n = _mm_loadu_si128((const __m128i*)chunks);
+#else
+    BatchLanes n = vld1q_u32(chunks);
+#endif
+    // Four digits of every lane at a time, then one digit per step
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        BatchLanes d0, d1, d2, d3;
+        n = batch_divide(n, magic, base, &d0);
+        n = batch_divide(n, magic, base, &d1);
+        n = batch_divide(n, magic, base, &d2);
+        n = batch_divide(n, magic, base, &d3);
+        batch_pack_digits(d3, d2, d1, d0, packed);
+        for (int l = 0; l < BATCH_LANES; l++) {
+            memcpy(ends[l] - j - 4, packed + 4 * l, 4);
+        }
+    }
+    for (j++; j <= count; j++) {
+        BatchLanes rem;
+        n = batch_divide(n, magic, base, &rem);
+#if defined(DIGITS_AVX2)
+        _mm256_storeu_si256((__m256i*)digits, rem);
+#elif defined(DIGITS_SSE2)
+        _mm_storeu_si128((__m128i*)digits, rem);
+#else
+        vst1q_u32(digits, rem);
+#endif
+        for (int l = 0; l < BATCH_LANES; l++) {
+            ends[l][-j] = DIGIT_CHARS[digits[l]];
+        }
+    }
+#else
+    for (int l = 0; l < BATCH_LANES; l++) {
+        uint32_t n = chunks[l];
+        for (int j = 1; j <= count; j++) {
+            uint32_t q = radix_magic_divide(n, magic);
+            ends[l][-j] = DIGIT_CHARS[n - q * base];
+            n = q;
+        }
+    }
+#endif
+}
+
+/*
+ * convert_batch_digits()
+ * ----------------------
+ * Returns the number of digits of UINT64_MAX in base (2-36): the widest a
+ * value converted by convert_batch_to_base() can be.
+ */
+static inline size_t convert_batch_digits(int base)
+{
+    return convert_int_to_str_any_base_size(UINT64_MAX, base);
+}
+
+/*
+ * convert_batch_emit()
+ * --------------------
+ * Copies the count digits of one value, which may start with zeros, into
+ * the output of convert_batch_to_base().
+ *
+ * Returns: Bytes written, or CONVERT_ERROR if the value needs more than
+ *          width digits.
+ */
+static inline size_t convert_batch_emit(const char* digits, size_t count, size_t width,
+        char* out, uint8_t* length)
+{
+    if (width == 0) {
+        // Length-tagged: strip the padding, eight zeros at a time, but keep
+        // a lone zero
+        uint64_t zeros;
+        memset(&zeros, '0', sizeof(zeros));
+        size_t skip = 0;
+        while (skip + 8 < count) {
+            uint64_t word;
+            memcpy(&word, digits + skip, sizeof(word));
+            if (word != zeros) {
+                break;
+            }
+            skip += 8;
+        }
+        while (skip + 1 < count && digits[skip] == '0') {
+            skip++;
+        }
+        memcpy(out, digits + skip, count - skip);
+        *length = (uint8_t)(count - skip);
+        return count - skip;
+    }
+    if (width >= count) {
+        memset(out, '0', width - count);
+        memcpy(out + width - count, digits, count);
+        return width;
+    }
+    for (size_t k = 0; k < count - width; k++) {
+        if (digits[k] != '0') {
+            return CONVERT_ERROR;
+        }
+    }
+    memcpy(out, digits + count - width, width);
+    return width;
+}
+
+/*
+ * convert_batch_to_base()
+ * -----------------------
+ * Writes n values in one base, as the digits
+ * convert_int_to_str_any_base() would produce for each, in one of two
+ * layouts:
+ *
+ *   width > 0:  fixed width. Value i takes width bytes at out + i * width,
+ *               zero padded on the left (a column of n * width bytes).
+ *   width == 0: length-tagged. The digits of every value follow each other
+ *               without padding, and lengths[i] receives the digit count
+ *               of value i.
+ *
+ * No terminators are written and no memory is allocated.
+ *
+ * values: The values to convert
+ * n: Number of values
+ * base: The base to write them in (2-36)
+ * width: Digits per value, or 0 for the length-tagged layout
+ * out: Buffer of n * width bytes, or n * convert_batch_digits(base) bytes
+ *      for the length-tagged layout
+ * lengths: Array of n entries for the length-tagged layout (ignored when
+ *          width > 0)
+ *
+ * Returns: The number of bytes written to out, or CONVERT_ERROR if the
+ *          arguments are invalid or a value needs more than width digits.
+ */
+static inline size_t convert_batch_to_base(const uint64_t* values, size_t n, int base,
+        size_t width, char* out, uint8_t* lengths)
+{
+    if ((!values && n > 0) || !out || base < 2 || base > 36 || (width == 0 && !lengths)) {
+        return CONVERT_ERROR;
+    }
+
+    size_t full = convert_batch_digits(base);
+    char padded[BATCH_LANES][FORMAT_DIGITS_BYTES];
+    size_t used = 0;
+
+    // Powers of two need no division at all
+    int shift = radix_pow2_shift(base);
+    if (shift) {
+        char* end = padded[0] + full;
+        for (size_t i = 0; i < n; i++) {
+            char* start = values[i] ? format_pow2_digits(values[i], shift, end) : end - 1;
+            if (!values[i]) {
+                *start = '0';
+            }
+            size_t written = convert_batch_emit(start, (size_t)(end - start), width,
+                    out + used, width ? NULL : &lengths[i]);
+            if (written == CONVERT_ERROR) {
+                return CONVERT_ERROR;
+            }
+            used += written;
+        }
+        return used;
+    }
+
+    // Digits of the low, middle and high chunk of every value
+    const RadixChunk* chunk = &RADIX_CHUNKS[base];
+    int chunkDigits = chunk->digits32;
+    int topDigits = (int)full - 2 * chunkDigits;
+    RadixMagic magic = radix_magic((uint32_t)base);
+#if defined(__SIZEOF_INT128__)
+    RadixMagic64 chunkMagic = radix_magic64(chunk->power32);
+#endif
+    char* ends[3][BATCH_LANES];
+    for (int l = 0; l < BATCH_LANES; l++) {
+        ends[0][l] = padded[l] + full;
+        ends[1][l] = ends[0][l] - chunkDigits;
+        ends[2][l] = ends[1][l] - chunkDigits;
+    }
+
+    for (size_t i = 0; i < n; i += BATCH_LANES) {
+        size_t lanes = n - i < BATCH_LANES ? n - i : BATCH_LANES;
+        uint32_t chunks[3][BATCH_LANES];
+        uint32_t middle = 0;
+        uint32_t top = 0;
+        for (size_t l = 0; l < BATCH_LANES; l++) {
+            uint64_t value = l < lanes ? values[i + l] : 0;
+            for (int c = 0; c < 2; c++) {
+#if defined(__SIZEOF_INT128__)
+                uint64_t q = radix_magic64_divide(value, &chunkMagic);
+#else
+                uint64_t q = value / chunk->power32;
+#endif
+                chunks[c][l] = (uint32_t)(value - q * chunk->power32);
+                value = q;
+            }
+            chunks[2][l] = (uint32_t)value;
+            middle |= chunks[1][l];
+            top |= chunks[2][l];
+        }
+
+        // Only the chunks that are non-zero in some lane are taken apart
+        size_t span = (size_t)chunkDigits;
+        batch_chunk_digits(chunks[0], chunkDigits, (uint32_t)base, &magic, ends[0]);
+        if (middle | top) {
+            span += (size_t)chunkDigits;
+            batch_chunk_digits(chunks[1], chunkDigits, (uint32_t)base, &magic, ends[1]);
+        }
+        if (top) {
+            span = full;
+            batch_chunk_digits(chunks[2], topDigits, (uint32_t)base, &magic, ends[2]);
+        }
+
+        for (size_t l = 0; l < lanes; l++) {
+            size_t written = convert_batch_emit(ends[0][l] - span, span, width, out + used,
+                    width ? NULL : &lengths[i + l]);
+            if (written == CONVERT_ERROR) {
+                return CONVERT_ERROR;
+            }
+            used += written;
+        }
+    }
+    return used;
+}
+
+#endif /* BATCH_H */
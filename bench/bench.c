@@ -0,0 +1,778 @@
+#define _GNU_SOURCE // wait4()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "uqbasejump.h"
+
+/*
+ * Benchmark suite for uqbasejump, run by "make bench".
+ *
+ * Micro benchmarks time the conversion and evaluation helpers of
+ * uqbasejump.h in-process; macro benchmarks generate --file corpora of
+ * the requested sizes and time the uqbasejump binary over them. Every
+ * result is written to stdout as one JSON document, so that runs can be
+ * kept and compared.
+ */
+
+/* Program constants */
+#define BENCH_MIN_SECONDS 0.1     // Shortest timed run of a micro benchmark
+#define BENCH_REPEATS 3           // Timed runs per micro benchmark (best kept)
+#define BENCH_SAMPLES 4096        // Inputs cycled through by a micro benchmark
+#define BENCH_MAX_TEXT 128        // Longest generated number or expression
+#define BENCH_ARENA_OPS 1024      // Operations between scratch arena resets
+#define BENCH_WRITE_BYTES (1 << 20) // Corpus bytes written at a time
+#define BENCH_DEFAULT_LINES "1000000,10000000,100000000"
+#define BENCH_DEFAULT_DIR "/tmp"
+#define BENCH_DEFAULT_BINARY "./uqbasejump"
+#define BENCH_DECIMAL 10          // Base of evaluate_expression() and sizes
+
+/* Mix enumeration
+ * ---------------
+ * The operators used by generated expressions.
+ */
+enum Mix
+{
+    MIX_ADDITIVE,       // + and -
+    MIX_MULTIPLICATIVE, // * and /
+    MIX_MIXED           // All four, with parentheses
+};
+
+/* Corpus struct
+ * -------------
+ * One generated --file workload: expressions in one base with one mix of
+ * operators, run with the given number of --jobs.
+ */
+typedef struct
+{
+    const char *name; // Name used in the results and the file name
+    int base;         // --inputbase of the expressions
+    enum Mix mix;     // Operators of the expressions
+    int jobs;         // --jobs for the run (0 = one per CPU)
+} Corpus;
+
+static const Corpus CORPORA[] = {
+    {"decimal-mixed", 10, MIX_MIXED, 1},
+    {"decimal-mixed-parallel", 10, MIX_MIXED, 0},
+    {"hex-additive", 16, MIX_ADDITIVE, 1},
+    {"binary-multiplicative", 2, MIX_MULTIPLICATIVE, 1},
+    {"base36-mixed", 36, MIX_MIXED, 1},
+};
+
+static const int MICRO_BASES[] = {2, 3, 8, 10, 16, 36};
+static const int MICRO_BITS[] = {8, 16, 32, 64};
+
+/* Sink for benchmark results, so that no timed work is optimised away */
+static volatile unsigned long long benchSink;
+
+/* BenchOptions struct
+ * -------------------
+ * Command line settings of the suite.
+ */
+typedef struct
+{
+    const char *binary; // uqbasejump binary run by the macro benchmarks
+    const char *lines;  // Comma-separated corpus sizes, in lines
+    const char *dir;    // Directory the corpora are generated in
+    bool micro;         // Whether to run the micro benchmarks
+    bool macro;         // Whether to run the macro benchmarks
+    bool keep;          // Whether to keep the generated corpora
+} BenchOptions;
+
+/* MicroInput struct
+ * -----------------
+ * The samples a micro benchmark cycles through.
+ */
+typedef struct
+{
+    int base;                                   // Base of the samples
+    int outputBase;                             // Target base, where one applies
+    unsigned long long values[BENCH_SAMPLES];   // Sample values
+    char text[BENCH_SAMPLES][BENCH_MAX_TEXT];   // Sample strings
+    char chars[BENCH_SAMPLES];                  // Sample characters
+    ExprProgram program;                        // text[0] compiled with bound literals
+} MicroInput;
+
+typedef unsigned long long (*MicroFn)(MicroInput *input, Arena *arena, size_t ops);
+
+/* Function prototypes */
+double bench_now(void);
+uint64_t bench_random(uint64_t *state);
+unsigned long long bench_random_value(uint64_t *state, int bits);
+size_t bench_expression(uint64_t *state, int base, enum Mix mix, char *out);
+double micro_time(MicroFn fn, MicroInput *input);
+void micro_report(bool *first, const char *name, const char *params, double ns);
+unsigned long long micro_char_to_digit(MicroInput *input, Arena *arena, size_t ops);
+unsigned long long micro_str_to_int(MicroInput *input, Arena *arena, size_t ops);
+unsigned long long micro_int_to_str(MicroInput *input, Arena *arena, size_t ops);
+unsigned long long micro_convert_expression(MicroInput *input, Arena *arena,
+                                            size_t ops);
+unsigned long long micro_evaluate_expression(MicroInput *input, Arena *arena,
+                                             size_t ops);
+void micro_rebind_prepare(uint64_t *state, enum Mix mix, MicroInput *input);
+unsigned long long micro_rebind_expression(MicroInput *input, Arena *arena,
+                                           size_t ops);
+void run_micro(void);
+bool corpus_generate(const char *path, const Corpus *corpus, unsigned long long lines,
+                     unsigned long long *bytes);
+void corpus_run(bool *first, const BenchOptions *options, const Corpus *corpus,
+                unsigned long long lines);
+void run_macro(const BenchOptions *options);
+void bench_usage(void);
+void parse_bench_arguments(int argc, char **argv, BenchOptions *options);
+
+/* bench_now()
+ * -----------
+ * Returns: Seconds on the monotonic clock.
+ */
+double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/* bench_random()
+ * --------------
+ * Returns the next number of a xorshift64* generator, so that every run
+ * generates the same inputs.
+ *
+ * state: Generator state (not 0)
+ */
+uint64_t bench_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/* bench_random_value()
+ * --------------------
+ * Returns: A random value of exactly bits bits (1-64).
+ */
+unsigned long long bench_random_value(uint64_t *state, int bits)
+{
+    unsigned long long value = bench_random(state);
+    if (bits < 64)
+    {
+        value &= (1ULL << bits) - 1;
+        value |= 1ULL << (bits - 1);
+    }
+    else
+    {
+        value |= 1ULL << 63;
+    }
+    return value;
+}
+
+/* bench_expression()
+ * ------------------
+ * Writes a random expression of two to five operands in base with the
+ * operators of mix. Operands are kept small enough to stay within double
+ * precision; about a third of the expressions with + or - and / still
+ * cannot be evaluated (negative or fractional results), so the error path
+ * is measured too.
+ *
+ * state: Generator state
+ * base: Base of the operands (2-36)
+ * mix: Operators to use
+ * out: Buffer of at least BENCH_MAX_TEXT bytes
+ *
+ * Returns: The length of the expression, which is null terminated
+ */
+size_t bench_expression(uint64_t *state, int base, enum Mix mix, char *out)
+{
+    static const char ADDITIVE[] = "+-";
+    static const char MULTIPLICATIVE[] = "*/";
+    static const char MIXED[] = "+-*/";
+    int operands = 2 + (int)(bench_random(state) % 4);
+    bool parenthesis = mix == MIX_MIXED && bench_random(state) % 2 == 0;
+    size_t len = 0;
+
+    for (int i = 0; i < operands; i++)
+    {
+        if (i > 0)
+        {
+            uint64_t pick = bench_random(state);
+            out[len++] = mix == MIX_ADDITIVE         ? ADDITIVE[pick % 2]
+                         : mix == MIX_MULTIPLICATIVE ? MULTIPLICATIVE[pick % 2]
+                                                     : MIXED[pick % 4];
+        }
+        if (parenthesis && i == 0)
+        {
+            out[len++] = '(';
+        }
+        int bits = mix == MIX_MULTIPLICATIVE ? 1 + (int)(bench_random(state) % 10)
+                                             : 1 + (int)(bench_random(state) % 24);
+        char digits[FORMAT_DIGITS_BYTES];
+        char *end = digits + sizeof(digits);
+        char *start = format_digits(bench_random_value(state, bits), base, end);
+        memcpy(out + len, start, (size_t)(end - start));
+        len += (size_t)(end - start);
+        if (parenthesis && i == 1)
+        {
+            out[len++] = ')';
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/* micro_time()
+ * ------------
+ * Times a micro benchmark: the operation count is doubled until one run
+ * takes BENCH_MIN_SECONDS, then the best of BENCH_REPEATS runs is kept.
+ *
+ * fn: The benchmark
+ * input: Its samples
+ *
+ * Returns: Nanoseconds per operation
+ */
+double micro_time(MicroFn fn, MicroInput *input)
+{
+    Arena arena;
+    arena_init(&arena);
+    size_t ops = 1024;
+    for (;;)
+    {
+        double start = bench_now();
+        benchSink += fn(input, &arena, ops);
+        if (bench_now() - start >= BENCH_MIN_SECONDS)
+        {
+            break;
+        }
+        ops *= 2;
+    }
+
+    double best = 0;
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+    {
+        double start = bench_now();
+        benchSink += fn(input, &arena, ops);
+        double elapsed = bench_now() - start;
+        if (repeat == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    arena_free(&arena);
+    return best * 1e9 / (double)ops;
+}
+
+/* micro_report()
+ * --------------
+ * Prints one micro benchmark result as a JSON object.
+ *
+ * first: Whether no result has been printed yet (cleared)
+ * name: The function benchmarked
+ * params: Further JSON members, each followed by a comma, or ""
+ * ns: Nanoseconds per operation
+ */
+void micro_report(bool *first, const char *name, const char *params, double ns)
+{
+    printf("%s\n    {\"name\": \"%s\", %s\"ns_per_op\": %.3f}", *first ? "" : ",",
+           name, params, ns);
+    *first = false;
+}
+
+/* micro_char_to_digit()
+ * ---------------------
+ * Benchmark of char_to_digit() over every character of the samples.
+ */
+unsigned long long micro_char_to_digit(MicroInput *input, Arena *arena, size_t ops)
+{
+    (void)arena;
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        sum += (unsigned long long)char_to_digit(input->chars[i % BENCH_SAMPLES]);
+    }
+    return sum;
+}
+
+/* micro_str_to_int()
+ * ------------------
+ * Benchmark of convert_str_to_int_any_base() on the sample strings.
+ */
+unsigned long long micro_str_to_int(MicroInput *input, Arena *arena, size_t ops)
+{
+    (void)arena;
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        sum += convert_str_to_int_any_base(input->text[i % BENCH_SAMPLES], input->base);
+    }
+    return sum;
+}
+
+/* micro_int_to_str()
+ * ------------------
+ * Benchmark of convert_int_to_str_any_base() on the sample values, with
+ * the results drawn from a scratch arena as file mode does.
+ */
+unsigned long long micro_int_to_str(MicroInput *input, Arena *arena, size_t ops)
+{
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        if (i % BENCH_ARENA_OPS == 0)
+        {
+            arena_reset(arena);
+        }
+        char *digits = convert_int_to_str_any_base_arena(arena, input->values[i % BENCH_SAMPLES],
+                                                         input->base);
+        sum += (unsigned char)digits[0];
+    }
+    return sum;
+}
+
+/* micro_convert_expression()
+ * --------------------------
+ * Benchmark of convert_expression() on the sample expressions.
+ */
+unsigned long long micro_convert_expression(MicroInput *input, Arena *arena,
+                                            size_t ops)
+{
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        if (i % BENCH_ARENA_OPS == 0)
+        {
+            arena_reset(arena);
+        }
+        char *converted = convert_expression_arena(arena, input->text[i % BENCH_SAMPLES],
+                                                   input->base, input->outputBase);
+        sum += converted ? (unsigned char)converted[0] : 0;
+    }
+    return sum;
+}
+
+/* micro_evaluate_expression()
+ * ---------------------------
+ * Benchmark of evaluate_expression() on the sample expressions.
+ */
+unsigned long long micro_evaluate_expression(MicroInput *input, Arena *arena,
+                                             size_t ops)
+{
+    (void)arena;
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        unsigned long long result = 0;
+        if (evaluate_expression(input->text[i % BENCH_SAMPLES], &result) == 0)
+        {
+            sum += result;
+        }
+    }
+    return sum;
+}
+
+/* micro_rebind_prepare()
+ * ----------------------
+ * Gives every sample expression the shape of the first one, with each
+ * literal replaced by a fresh random one as in bench_expression(), and
+ * compiles the first with bound literals. Every sample is then rebound
+ * and run once and checked against evaluate_expression(), so the bound
+ * path is known to agree with the folding one before it is timed.
+ *
+ * state: Generator state
+ * mix: Operators the samples were generated with
+ * input: Samples in base 10, of which text[0] is the template (modified)
+ *
+ * Errors: Program exits with EXIT_FAILURE if the template cannot be
+ * compiled or a sample gives a different status or result
+ */
+void micro_rebind_prepare(uint64_t *state, enum Mix mix, MicroInput *input)
+{
+    const char *template = input->text[0];
+    for (int i = 1; i < BENCH_SAMPLES; i++)
+    {
+        size_t len = 0;
+        for (const char *c = template; *c;)
+        {
+            if (digit_value(*c) < 0)
+            {
+                input->text[i][len++] = *c++;
+                continue;
+            }
+            while (digit_value(*c) >= 0)
+            {
+                c++;
+            }
+            int bits = mix == MIX_MULTIPLICATIVE ? 1 + (int)(bench_random(state) % 10)
+                                                 : 1 + (int)(bench_random(state) % 24);
+            char digits[FORMAT_DIGITS_BYTES];
+            char *end = digits + sizeof(digits);
+            char *start = format_digits(bench_random_value(state, bits), BENCH_DECIMAL, end);
+            memcpy(input->text[i] + len, start, (size_t)(end - start));
+            len += (size_t)(end - start);
+        }
+        input->text[i][len] = '\0';
+    }
+
+    expr_program_init(&input->program);
+    if (compile_expression(template, strlen(template), BENCH_DECIMAL, true,
+                           &input->program) != 0)
+    {
+        fprintf(stderr, "compile_expression() cannot bind %s\n", template);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        const char *text = input->text[i];
+        unsigned long long bound = 0, folded = 0;
+        int boundStatus = rebind_expr_program(&input->program, text, strlen(text),
+                                              BENCH_DECIMAL);
+        if (boundStatus == 0)
+        {
+            boundStatus = run_expr_program(&input->program, NULL, &bound);
+        }
+        int foldedStatus = evaluate_expression(text, &folded);
+        if ((boundStatus == 0) != (foldedStatus == 0) || bound != folded)
+        {
+            fprintf(stderr, "rebind_expr_program() gives %d (%llu) for %s but "
+                            "evaluate_expression() gives %d (%llu)\n",
+                    boundStatus, bound, text, foldedStatus, folded);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* micro_rebind_expression()
+ * -------------------------
+ * Benchmark of rebind_expr_program() and run_expr_program() on samples of
+ * one shape (see micro_rebind_prepare()), the path that skips compiling
+ * when only the literals of an expression change.
+ */
+unsigned long long micro_rebind_expression(MicroInput *input, Arena *arena,
+                                           size_t ops)
+{
+    (void)arena;
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < ops; i++)
+    {
+        const char *text = input->text[i % BENCH_SAMPLES];
+        unsigned long long result = 0;
+        if (rebind_expr_program(&input->program, text, strlen(text), BENCH_DECIMAL) == 0 &&
+            run_expr_program(&input->program, NULL, &result) == 0)
+        {
+            sum += result;
+        }
+    }
+    return sum;
+}
+
+/* run_micro()
+ * -----------
+ * Runs every micro benchmark and prints the "micro" array of the results.
+ */
+void run_micro(void)
+{
+    static MicroInput input;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    char params[128];
+    bool first = true;
+    printf("  \"micro\": [");
+
+    // Digits of every base, as a long literal would hold them
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        input.chars[i] = DIGIT_CHARS[bench_random(&state) % 36];
+    }
+    micro_report(&first, "char_to_digit", "", micro_time(micro_char_to_digit, &input));
+
+    size_t baseCount = sizeof(MICRO_BASES) / sizeof(MICRO_BASES[0]);
+    size_t bitsCount = sizeof(MICRO_BITS) / sizeof(MICRO_BITS[0]);
+    for (size_t b = 0; b < baseCount; b++)
+    {
+        for (size_t s = 0; s < bitsCount; s++)
+        {
+            input.base = MICRO_BASES[b];
+            for (int i = 0; i < BENCH_SAMPLES; i++)
+            {
+                input.values[i] = bench_random_value(&state, MICRO_BITS[s]);
+                char *end = input.text[i] + FORMAT_DIGITS_BYTES;
+                char *start = format_digits(input.values[i], input.base, end);
+                memmove(input.text[i], start, (size_t)(end - start));
+                input.text[i][end - start] = '\0';
+            }
+            snprintf(params, sizeof(params), "\"base\": %d, \"bits\": %d, ",
+                     input.base, MICRO_BITS[s]);
+            micro_report(&first, "convert_str_to_int_any_base", params,
+                         micro_time(micro_str_to_int, &input));
+            micro_report(&first, "convert_int_to_str_any_base", params,
+                         micro_time(micro_int_to_str, &input));
+        }
+    }
+
+    static const int PAIRS[][2] = {{10, 16}, {16, 2}, {2, 10}, {36, 10}};
+    for (size_t p = 0; p < sizeof(PAIRS) / sizeof(PAIRS[0]); p++)
+    {
+        input.base = PAIRS[p][0];
+        input.outputBase = PAIRS[p][1];
+        for (int i = 0; i < BENCH_SAMPLES; i++)
+        {
+            bench_expression(&state, input.base, MIX_MIXED, input.text[i]);
+        }
+        snprintf(params, sizeof(params), "\"input_base\": %d, \"output_base\": %d, ",
+                 input.base, input.outputBase);
+        micro_report(&first, "convert_expression", params,
+                     micro_time(micro_convert_expression, &input));
+    }
+
+    static const char *MIX_NAMES[] = {"additive", "multiplicative", "mixed"};
+    for (int mix = MIX_ADDITIVE; mix <= MIX_MIXED; mix++)
+    {
+        for (int i = 0; i < BENCH_SAMPLES; i++)
+        {
+            bench_expression(&state, BENCH_DECIMAL, (enum Mix)mix, input.text[i]);
+        }
+        snprintf(params, sizeof(params), "\"mix\": \"%s\", ", MIX_NAMES[mix]);
+        micro_report(&first, "evaluate_expression", params,
+                     micro_time(micro_evaluate_expression, &input));
+
+        // The same mix again, every sample with the shape of the first
+        micro_rebind_prepare(&state, (enum Mix)mix, &input);
+        snprintf(params, sizeof(params), "\"mix\": \"%s\", \"shape\": \"fixed\", ",
+                 MIX_NAMES[mix]);
+        micro_report(&first, "evaluate_expression", params,
+                     micro_time(micro_evaluate_expression, &input));
+        micro_report(&first, "rebind_expr_program", params,
+                     micro_time(micro_rebind_expression, &input));
+        expr_program_free(&input.program);
+    }
+    printf("\n  ]");
+}
+
+/* corpus_generate()
+ * -----------------
+ * Writes lines random expressions of a corpus to path.
+ *
+ * path: The file to create
+ * corpus: The workload to generate
+ * lines: Number of expressions
+ * bytes: Receives the size of the file
+ *
+ * Returns: true if the file was written, false otherwise
+ */
+bool corpus_generate(const char *path, const Corpus *corpus, unsigned long long lines,
+                     unsigned long long *bytes)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    char *buffer = malloc(BENCH_WRITE_BYTES + BENCH_MAX_TEXT);
+    if (!buffer)
+    {
+        close(fd);
+        return false;
+    }
+
+    uint64_t state = 0xD1B54A32D192ED03ULL ^ (uint64_t)corpus->base;
+    size_t used = 0;
+    bool ok = true;
+    *bytes = 0;
+    for (unsigned long long i = 0; i < lines && ok; i++)
+    {
+        used += bench_expression(&state, corpus->base, corpus->mix, buffer + used);
+        buffer[used++] = '\n';
+        if (used >= BENCH_WRITE_BYTES || i + 1 == lines)
+        {
+            ok = write(fd, buffer, used) == (ssize_t)used;
+            *bytes += used;
+            used = 0;
+        }
+    }
+    free(buffer);
+    return close(fd) == 0 && ok;
+}
+
+/* corpus_run()
+ * ------------
+ * Generates one corpus, times the uqbasejump binary over it with --file,
+ * and prints the result as a JSON object. Output goes to /dev/null.
+ *
+ * first: Whether no result has been printed yet (cleared)
+ * options: Settings of the suite
+ * corpus: The workload
+ * lines: Number of expressions
+ */
+void corpus_run(bool *first, const BenchOptions *options, const Corpus *corpus,
+                unsigned long long lines)
+{
+    char path[4096];
+    char base[8];
+    char jobs[8];
+    unsigned long long bytes = 0;
+    snprintf(path, sizeof(path), "%s/ujb-bench-%s-%llu.txt", options->dir,
+             corpus->name, lines);
+    snprintf(base, sizeof(base), "%d", corpus->base);
+    snprintf(jobs, sizeof(jobs), "%d", corpus->jobs);
+    if (!corpus_generate(path, corpus, lines, &bytes))
+    {
+        fprintf(stderr, "ujb_bench: can't write corpus \"%s\"\n", path);
+        unlink(path);
+        return;
+    }
+
+    double start = bench_now();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execl(options->binary, options->binary, "--file", path, "--inputbase", base,
+              "--jobs", jobs, (char *)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+    {
+        status = -1;
+    }
+    double seconds = bench_now() - start;
+    if (!options->keep)
+    {
+        unlink(path);
+    }
+
+    printf("%s\n    {\"corpus\": \"%s\", \"base\": %d, \"jobs\": %d, "
+           "\"lines\": %llu, \"bytes\": %llu, \"exit_status\": %d, "
+           "\"seconds\": %.4f, \"user_seconds\": %.4f, \"sys_seconds\": %.4f, "
+           "\"lines_per_second\": %.0f, \"max_rss_kb\": %ld}",
+           *first ? "" : ",", corpus->name, corpus->base, corpus->jobs, lines,
+           bytes, WIFEXITED(status) ? WEXITSTATUS(status) : -1, seconds,
+           (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec * 1e-6,
+           (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec * 1e-6,
+           seconds > 0 ? (double)lines / seconds : 0.0, usage.ru_maxrss);
+    fflush(stdout);
+    *first = false;
+}
+
+/* run_macro()
+ * -----------
+ * Runs every corpus at every size and prints the "macro" array of the
+ * results.
+ *
+ * options: Settings of the suite
+ */
+void run_macro(const BenchOptions *options)
+{
+    bool first = true;
+    printf("  \"macro\": [");
+    const char *sizes = options->lines;
+    while (*sizes)
+    {
+        char *end;
+        unsigned long long lines = strtoull(sizes, &end, BENCH_DECIMAL);
+        if (end == sizes)
+        {
+            break; // Not a number
+        }
+        for (size_t c = 0; c < sizeof(CORPORA) / sizeof(CORPORA[0]) && lines > 0; c++)
+        {
+            corpus_run(&first, options, &CORPORA[c], lines);
+        }
+        sizes = *end == ',' ? end + 1 : end;
+    }
+    printf("\n  ]");
+}
+
+/* bench_usage()
+ * -------------
+ * Prints usage information to stderr and exits with status 1.
+ */
+void bench_usage(void)
+{
+    fprintf(stderr, "Usage: ujb_bench [--binary path] [--lines N[,N...]] [--dir path] "
+                    "[--micro-only | --macro-only] [--keep]\n");
+    exit(1);
+}
+
+/* parse_bench_arguments()
+ * -----------------------
+ * Parses the command line of the suite.
+ *
+ * argc: Number of command line arguments
+ * argv: Array of command line argument strings
+ * options: Receives the settings
+ */
+void parse_bench_arguments(int argc, char **argv, BenchOptions *options)
+{
+    options->binary = BENCH_DEFAULT_BINARY;
+    options->lines = BENCH_DEFAULT_LINES;
+    options->dir = BENCH_DEFAULT_DIR;
+    options->micro = true;
+    options->macro = true;
+    options->keep = false;
+    for (int i = 1; i < argc; i++)
+    {
+        bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--binary") == 0 && value)
+        {
+            options->binary = argv[++i];
+        }
+        else if (strcmp(argv[i], "--lines") == 0 && value)
+        {
+            options->lines = argv[++i];
+        }
+        else if (strcmp(argv[i], "--dir") == 0 && value)
+        {
+            options->dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--micro-only") == 0)
+        {
+            options->macro = false;
+        }
+        else if (strcmp(argv[i], "--macro-only") == 0)
+        {
+            options->micro = false;
+        }
+        else if (strcmp(argv[i], "--keep") == 0)
+        {
+            options->keep = true;
+        }
+        else
+        {
+            bench_usage();
+        }
+    }
+    if (!options->micro && !options->macro)
+    {
+        bench_usage();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    parse_bench_arguments(argc, argv, &options);
+
+    printf("{\n  \"version\": 1,\n");
+    if (options.micro)
+    {
+        run_micro();
+        printf(options.macro ? ",\n" : "\n");
+    }
+    if (options.macro)
+    {
+        run_macro(&options);
+        printf("\n");
+    }
+    printf("}\n");
+    return 0;
+}
@@ -0,0 +1,1504 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "radix.h"
+#include "digits.h"
+#include "arena.h"
+
+/*
+ * Arbitrary-precision signed integers used by the --precision big
+ * evaluator. Magnitudes are stored as little-endian arrays of 32-bit limbs;
+ * values of up to BIGINT_INLINE_LIMBS limbs (64 bits) live inside the
+ * BigInt itself and never touch the heap.
+ */
+
+typedef uint32_t BigLimb;  // One digit of the magnitude (base 2^32)
+typedef uint64_t BigDLimb; // Double-width limb for intermediate products
+
+#define BIGINT_LIMB_BITS 32
+#define BIGINT_INLINE_LIMBS 2            // Limbs stored without allocation
+#define BIGINT_KARATSUBA_THRESHOLD 32    // Limbs below which we use schoolbook
+#define BIGINT_MAX_LIMBS ((size_t)1 << 21) // Size cap (64M bits) for results
+
+/*
+ * BigInt
+ * ------
+ * A sign-magnitude integer. size is the number of significant limbs (zero
+ * has size 0 and is never negative). heap is NULL while the value fits in
+ * the inline limbs.
+ */
+typedef struct {
+    BigLimb* heap;                       // Allocated limbs, or NULL for inline
+    size_t size;                         // Number of significant limbs
+    size_t capacity;                     // Limbs available in storage
+    bool negative;                       // Sign of the value
+    BigLimb small[BIGINT_INLINE_LIMBS];  // Inline storage for small values
+} BigInt;
+
+/*
+ * bigint_limbs()
+ * --------------
+ * Returns a pointer to the limb storage of a BigInt.
+ */
+static inline BigLimb* bigint_limbs(BigInt* a)
+{
+    return a->heap ? a->heap : a->small;
+}
+
+static inline const BigLimb* bigint_limbs_const(const BigInt* a)
+{
+    return a->heap ? a->heap : a->small;
+}
+
+/*
+ * bigint_init()
+ * -------------
+ * Initialises a BigInt to zero. Must be called before any other use.
+ */
+static inline void bigint_init(BigInt* a)
+{
+    a->heap = NULL;
+    a->size = 0;
+    a->capacity = BIGINT_INLINE_LIMBS;
+    a->negative = false;
+}
+
+/*
+ * bigint_free()
+ * -------------
+ * Releases any heap storage held by a BigInt and resets it to zero.
+ */
+static inline void bigint_free(BigInt* a)
+{
+    free(a->heap);
+    bigint_init(a);
+}
+
+/*
+ * bigint_reserve()
+ * ----------------
+ * Ensures a BigInt can hold at least n limbs, preserving its value.
+ *
+ * Returns: 0 if successful, 1 if n exceeds BIGINT_MAX_LIMBS or memory
+ *          could not be allocated.
+ */
+static inline int bigint_reserve(BigInt* a, size_t n)
+{
+    if (n <= a->capacity) {
+        return 0;
+    }
+    if (n > BIGINT_MAX_LIMBS + 2) {
+        return 1;
+    }
+
+    size_t newCapacity = a->capacity * 2;
+    if (newCapacity < n) {
+        newCapacity = n;
+    }
+    BigLimb* newLimbs = (BigLimb*)realloc(a->heap, newCapacity * sizeof(BigLimb));
+    if (!newLimbs) {
+        return 1;
+    }
+    if (!a->heap) {
+        memcpy(newLimbs, a->small, a->size * sizeof(BigLimb));
+    }
+    a->heap = newLimbs;
+    a->capacity = newCapacity;
+    return 0;
+}
+
+/*
+ * bigint_normalize()
+ * ------------------
+ * Drops high zero limbs so that size counts only significant limbs.
+ */
+static inline void bigint_normalize(BigInt* a)
+{
+    const BigLimb* limbs = bigint_limbs(a);
+    while (a->size > 0 && limbs[a->size - 1] == 0) {
+        a->size--;
+    }
+    if (a->size == 0) {
+        a->negative = false;
+    }
+}
+
+/*
+ * bigint_set_u64()
+ * ----------------
+ * Sets a BigInt to a non-negative 64-bit value. Always fits inline storage.
+ */
+static inline void bigint_set_u64(BigInt* a, uint64_t value)
+{
+    BigLimb* limbs = bigint_limbs(a);
+    limbs[0] = (BigLimb)value;
+    limbs[1] = (BigLimb)(value >> BIGINT_LIMB_BITS);
+    a->size = 2;
+    a->negative = false;
+    bigint_normalize(a);
+}
+
+/*
+ * bigint_fits_u64()
+ * -----------------
+ * Returns true if the magnitude of a fits in 64 bits.
+ */
+static inline bool bigint_fits_u64(const BigInt* a)
+{
+    return a->size <= 2;
+}
+
+/*
+ * bigint_mag_u64()
+ * ----------------
+ * Returns the magnitude of a BigInt that satisfies bigint_fits_u64().
+ */
+static inline uint64_t bigint_mag_u64(const BigInt* a)
+{
+    const BigLimb* limbs = bigint_limbs_const(a);
+    uint64_t value = 0;
+    if (a->size > 1) {
+        value = (uint64_t)limbs[1] << BIGINT_LIMB_BITS;
+    }
+    if (a->size > 0) {
+        value |= limbs[0];
+    }
+    return value;
+}
+
+/*
+ * bigint_is_zero()
+ * ----------------
+ * Returns true if the BigInt is zero.
+ */
+static inline bool bigint_is_zero(const BigInt* a)
+{
+    return a->size == 0;
+}
+
+/*
+ * bigint_copy()
+ * -------------
+ * Copies the value of src into dst.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int bigint_copy(BigInt* dst, const BigInt* src)
+{
+    if (dst == src) {
+        return 0;
+    }
+    if (bigint_reserve(dst, src->size) != 0) {
+        return 1;
+    }
+    memcpy(bigint_limbs(dst), bigint_limbs_const(src), src->size * sizeof(BigLimb));
+    dst->size = src->size;
+    dst->negative = src->negative;
+    return 0;
+}
+
+/*
+ * bigint_swap()
+ * -------------
+ * Exchanges the values of two BigInts without copying heap limbs.
+ */
+static inline void bigint_swap(BigInt* a, BigInt* b)
+{
+    BigInt tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/*
+ * bigint_bit_length()
+ * -------------------
+ * Returns the number of bits in the magnitude of a (0 for zero).
+ */
+static inline size_t bigint_bit_length(const BigInt* a)
+{
+    if (a->size == 0) {
+        return 0;
+    }
+    BigLimb top = bigint_limbs_const(a)[a->size - 1];
+    size_t bits = 0;
+    while (top) {
+        bits++;
+        top >>= 1;
+    }
+    return (a->size - 1) * BIGINT_LIMB_BITS + bits;
+}
+
+/*
+ * limbs_cmp()
+ * -----------
+ * Compares two normalized magnitudes.
+ * Returns: <0, 0 or >0 as a is less than, equal to or greater than b.
+ */
+static inline int limbs_cmp(const BigLimb* a, size_t an, const BigLimb* b, size_t bn)
+{
+    if (an != bn) {
+        return an < bn ? -1 : 1;
+    }
+    while (an > 0) {
+        an--;
+        if (a[an] != b[an]) {
+            return a[an] < b[an] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * limbs_add()
+ * -----------
+ * Computes r = a + b over an limbs, where an >= bn. r may alias a or b.
+ * Returns: The carry out of the top limb.
+ */
+static inline BigLimb limbs_add(BigLimb* r, const BigLimb* a, size_t an,
+        const BigLimb* b, size_t bn)
+{
+    BigDLimb carry = 0;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        carry += (BigDLimb)a[i] + b[i];
+        r[i] = (BigLimb)carry;
+        carry >>= BIGINT_LIMB_BITS;
+    }
+    for (; i < an; i++) {
+        carry += a[i];
+        r[i] = (BigLimb)carry;
+        carry >>= BIGINT_LIMB_BITS;
+    }
+    return (BigLimb)carry;
+}
+
+/*
+ * limbs_sub()
+ * -----------
+ * Computes r = a - b over an limbs, where an >= bn. r may alias a or b.
+ * Returns: The borrow out of the top limb (0 when a >= b).
+ */
+static inline BigLimb limbs_sub(BigLimb* r, const BigLimb* a, size_t an,
+        const BigLimb* b, size_t bn)
+{
+    BigLimb borrow = 0;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        BigDLimb diff = (BigDLimb)a[i] - b[i] - borrow;
+        r[i] = (BigLimb)diff;
+        borrow = (BigLimb)((diff >> BIGINT_LIMB_BITS) & 1);
+    }
+    for (; i < an; i++) {
+        BigDLimb diff = (BigDLimb)a[i] - borrow;
+        r[i] = (BigLimb)diff;
+        borrow = (BigLimb)((diff >> BIGINT_LIMB_BITS) & 1);
+    }
+    return borrow;
+}
+
+/*
+ * limbs_mul_small_add()
+ * ---------------------
+ * Computes r = a * m + add over n limbs. r may alias a.
+ * Returns: The limb carried out of the top.
+ */
+static inline BigLimb limbs_mul_small_add(BigLimb* r, const BigLimb* a, size_t n,
+        BigLimb m, BigLimb add)
+{
+    BigDLimb carry = add;
+    for (size_t i = 0; i < n; i++) {
+        carry += (BigDLimb)a[i] * m;
+        r[i] = (BigLimb)carry;
+        carry >>= BIGINT_LIMB_BITS;
+    }
+    return (BigLimb)carry;
+}
+
+/*
+ * limbs_div_small()
+ * -----------------
+ * Computes r = a / d over n limbs. r may alias a.
+ * Returns: The remainder a % d.
+ */
+static inline BigLimb limbs_div_small(BigLimb* r, const BigLimb* a, size_t n, BigLimb d)
+{
+    BigDLimb rem = 0;
+    while (n > 0) {
+        n--;
+        BigDLimb cur = (rem << BIGINT_LIMB_BITS) | a[n];
+        r[n] = (BigLimb)(cur / d);
+        rem = cur % d;
+    }
+    return (BigLimb)rem;
+}
+
+/*
+ * limbs_mul_schoolbook()
+ * ----------------------
+ * Computes r = a * b, where r has an + bn limbs and must not alias a or b.
+ */
+static inline void limbs_mul_schoolbook(BigLimb* r, const BigLimb* a, size_t an,
+        const BigLimb* b, size_t bn)
+{
+    memset(r, 0, (an + bn) * sizeof(BigLimb));
+    for (size_t j = 0; j < bn; j++) {
+        BigDLimb carry = 0;
+        BigDLimb bj = b[j];
+        if (bj == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < an; i++) {
+            carry += (BigDLimb)a[i] * bj + r[i + j];
+            r[i + j] = (BigLimb)carry;
+            carry >>= BIGINT_LIMB_BITS;
+        }
+        r[an + j] = (BigLimb)carry;
+    }
+}
+
+/*
+ * limbs_add_into()
+ * ----------------
+ * Adds a (an limbs) into r (rn limbs, rn >= an), propagating the carry.
+ */
+static inline void limbs_add_into(BigLimb* r, size_t rn, const BigLimb* a, size_t an)
+{
+    BigLimb carry = limbs_add(r, r, an, a, an);
+    for (size_t i = an; carry && i < rn; i++) {
+        r[i]++;
+        carry = (r[i] == 0);
+    }
+}
+
+/*
+ * limbs_sub_into()
+ * ----------------
+ * Subtracts a (an limbs) from r (rn limbs, rn >= an), propagating the
+ * borrow. The caller guarantees the result is non-negative.
+ */
+static inline void limbs_sub_into(BigLimb* r, size_t rn, const BigLimb* a, size_t an)
+{
+    BigLimb borrow = limbs_sub(r, r, an, a, an);
+    for (size_t i = an; borrow && i < rn; i++) {
+        borrow = (r[i] == 0);
+        r[i]--;
+    }
+}
+
+/*
+ * limbs_mul()
+ * -----------
+ * Computes r = a * b, where r has an + bn limbs and must not alias a or b.
+ * Uses schoolbook multiplication below BIGINT_KARATSUBA_THRESHOLD limbs and
+ * Karatsuba above it; very unbalanced operands are multiplied in slices of
+ * the shorter operand's length.
+ *
+ * Returns: 0 if successful, 1 if scratch memory could not be allocated.
+ */
+static inline int limbs_mul(BigLimb* r, const BigLimb* a, size_t an,
+        const BigLimb* b, size_t bn)
+{
+    if (an < bn) {
+        const BigLimb* t = a;
+        a = b;
+        b = t;
+        size_t tn = an;
+        an = bn;
+        bn = tn;
+    }
+
+    if (bn < BIGINT_KARATSUBA_THRESHOLD) {
+        limbs_mul_schoolbook(r, a, an, b, bn);
+        return 0;
+    }
+
+    size_t h = (an + 1) / 2;
+    if (bn <= h) {
+        // Unbalanced: multiply bn-sized slices of a and accumulate
+        BigLimb* part = (BigLimb*)malloc(2 * bn * sizeof(BigLimb));
+        if (!part) {
+            return 1;
+        }
+        memset(r, 0, (an + bn) * sizeof(BigLimb));
+        for (size_t off = 0; off < an; off += bn) {
+            size_t n = (an - off < bn) ? an - off : bn;
+            if (limbs_mul(part, a + off, n, b, bn) != 0) {
+                free(part);
+                return 1;
+            }
+            limbs_add_into(r + off, an + bn - off, part, n + bn);
+        }
+        free(part);
+        return 0;
+    }
+
+    // Karatsuba: a = a1*B^h + a0, b = b1*B^h + b0
+    const BigLimb* a0 = a;
+    const BigLimb* a1 = a + h;
+    const BigLimb* b0 = b;
+    const BigLimb* b1 = b + h;
+    size_t a1n = an - h;
+    size_t b1n = bn - h;
+
+    // Scratch: sa, sb (h + 1 each) and their product (2h + 2)
+    BigLimb* scratch = (BigLimb*)malloc((4 * h + 4) * sizeof(BigLimb));
+    if (!scratch) {
+        return 1;
+    }
+    BigLimb* sa = scratch;
+    BigLimb* sb = sa + h + 1;
+    BigLimb* z1 = sb + h + 1;
+
+    sa[h] = limbs_add(sa, a0, h, a1, a1n);
+    sb[h] = limbs_add(sb, b0, h, b1, b1n);
+
+    // z0 = a0*b0 into r[0..2h), z2 = a1*b1 into r[2h..an+bn)
+    if (limbs_mul(r, a0, h, b0, h) != 0 ||
+            limbs_mul(r + 2 * h, a1, a1n, b1, b1n) != 0 ||
+            limbs_mul(z1, sa, h + 1, sb, h + 1) != 0) {
+        free(scratch);
+        return 1;
+    }
+
+    // z1 = (a0 + a1)(b0 + b1) - z0 - z2, then add z1 * B^h
+    size_t z1n = 2 * h + 2;
+    limbs_sub_into(z1, z1n, r, 2 * h);
+    limbs_sub_into(z1, z1n, r + 2 * h, a1n + b1n);
+    while (z1n > 0 && z1[z1n - 1] == 0) {
+        z1n--;
+    }
+    limbs_add_into(r + h, an + bn - h, z1, z1n);
+
+    free(scratch);
+    return 0;
+}
+
+/*
+ * bigint_add_signed()
+ * -------------------
+ * Computes r = a + (bNegative ? -|b| : |b|) with a's sign. Shared by
+ * bigint_add() and bigint_sub(). r may alias a or b.
+ */
+static inline int bigint_add_signed(BigInt* r, const BigInt* a, const BigInt* b,
+        bool bNegative)
+{
+    // Fast path: both magnitudes fit in a 64-bit register
+    if (bigint_fits_u64(a) && bigint_fits_u64(b)) {
+        uint64_t x = bigint_mag_u64(a);
+        uint64_t y = bigint_mag_u64(b);
+        bool aNegative = a->negative;
+        if (aNegative == bNegative) {
+            uint64_t sum;
+            if (!__builtin_add_overflow(x, y, &sum)) {
+                bigint_set_u64(r, sum);
+                r->negative = aNegative && sum != 0;
+                return 0;
+            }
+        } else {
+            bigint_set_u64(r, x >= y ? x - y : y - x);
+            r->negative = (x >= y ? aNegative : bNegative) && x != y;
+            return 0;
+        }
+    }
+
+    const BigInt* big = a;
+    const BigInt* little = b;
+    bool bigNegative = a->negative;
+    bool littleNegative = bNegative;
+    int cmp = limbs_cmp(bigint_limbs_const(a), a->size, bigint_limbs_const(b), b->size);
+    if (cmp < 0) {
+        big = b;
+        little = a;
+        bigNegative = bNegative;
+        littleNegative = a->negative;
+    }
+    size_t bigSize = big->size;
+    size_t littleSize = little->size;
+
+    if (bigint_reserve(r, bigSize + 1) != 0) {
+        return 1;
+    }
+    // Fetch storage after reserving, in case r aliases an operand
+    BigLimb* rl = bigint_limbs(r);
+    const BigLimb* bl = bigint_limbs_const(big);
+    const BigLimb* ll = bigint_limbs_const(little);
+
+    if (bigNegative == littleNegative) {
+        rl[bigSize] = limbs_add(rl, bl, bigSize, ll, littleSize);
+        r->size = bigSize + 1;
+    } else {
+        limbs_sub(rl, bl, bigSize, ll, littleSize);
+        r->size = bigSize;
+    }
+    r->negative = bigNegative;
+    bigint_normalize(r);
+    return 0;
+}
+
+/*
+ * bigint_add()
+ * ------------
+ * Computes r = a + b. r may alias a or b.
+ * Returns: 0 if successful, 1 on allocation failure or size overflow.
+ */
+static inline int bigint_add(BigInt* r, const BigInt* a, const BigInt* b)
+{
+    return bigint_add_signed(r, a, b, b->negative);
+}
+
+/*
+ * bigint_sub()
+ * ------------
+ * Computes r = a - b. r may alias a or b.
+ * Returns: 0 if successful, 1 on allocation failure or size overflow.
+ */
+static inline int bigint_sub(BigInt* r, const BigInt* a, const BigInt* b)
+{
+    return bigint_add_signed(r, a, b, !b->negative && b->size > 0);
+}
+
+/*
+ * bigint_mul()
+ * ------------
+ * Computes r = a * b. r may alias a or b.
+ * Returns: 0 if successful, 1 on allocation failure or size overflow.
+ */
+static inline int bigint_mul(BigInt* r, const BigInt* a, const BigInt* b)
+{
+    bool negative = a->negative != b->negative;
+
+    // Fast path: the product of two 64-bit magnitudes still fits in 64 bits
+    if (bigint_fits_u64(a) && bigint_fits_u64(b)) {
+        uint64_t product;
+        if (!__builtin_mul_overflow(bigint_mag_u64(a), bigint_mag_u64(b), &product)) {
+            bigint_set_u64(r, product);
+            r->negative = negative && product != 0;
+            return 0;
+        }
+    }
+
+    if (a->size == 0 || b->size == 0) {
+        bigint_set_u64(r, 0);
+        return 0;
+    }
+    if (a->size + b->size > BIGINT_MAX_LIMBS) {
+        return 1;
+    }
+
+    BigInt product;
+    bigint_init(&product);
+    if (bigint_reserve(&product, a->size + b->size) != 0 ||
+            limbs_mul(bigint_limbs(&product), bigint_limbs_const(a), a->size,
+                bigint_limbs_const(b), b->size) != 0) {
+        bigint_free(&product);
+        return 1;
+    }
+    product.size = a->size + b->size;
+    product.negative = negative;
+    bigint_normalize(&product);
+
+    bigint_swap(r, &product);
+    bigint_free(&product);
+    return 0;
+}
+
+/*
+ * bigint_mul_small_add()
+ * ----------------------
+ * Computes a = a * m + add in place for single-limb m and add (a >= 0).
+ * Returns: 0 if successful, 1 on allocation failure or size overflow.
+ */
+static inline int bigint_mul_small_add(BigInt* a, BigLimb m, BigLimb add)
+{
+    if (bigint_reserve(a, a->size + 1) != 0) {
+        return 1;
+    }
+    BigLimb* limbs = bigint_limbs(a);
+    limbs[a->size] = limbs_mul_small_add(limbs, limbs, a->size, m, add);
+    a->size++;
+    bigint_normalize(a);
+    return 0;
+}
+
+/*
+ * bigint_div_small()
+ * ------------------
+ * Computes a = a / d in place for a single-limb divisor d != 0.
+ * Returns: The remainder |a| % d.
+ */
+static inline BigLimb bigint_div_small(BigInt* a, BigLimb d)
+{
+    BigLimb* limbs = bigint_limbs(a);
+    BigLimb rem = limbs_div_small(limbs, limbs, a->size, d);
+    bigint_normalize(a);
+    return rem;
+}
+
+/*
+ * limbs_divmod_knuth()
+ * --------------------
+ * Long division of magnitudes (Knuth, TAOCP vol. 2, Algorithm D).
+ * Computes q = u / v (un - vn + 1 limbs) and r = u % v (vn limbs), where
+ * un >= vn >= 2 and v[vn - 1] != 0. q and r must not alias u or v.
+ *
+ * Returns: 0 if successful, 1 if scratch memory could not be allocated.
+ */
+static inline int limbs_divmod_knuth(BigLimb* q, BigLimb* r, const BigLimb* u,
+        size_t un, const BigLimb* v, size_t vn)
+{
+    const BigDLimb base = (BigDLimb)1 << BIGINT_LIMB_BITS;
+
+    // Normalise so the divisor's top limb has its high bit set
+    int shift = 0;
+    BigLimb top = v[vn - 1];
+    while (!(top & 0x80000000u)) {
+        top <<= 1;
+        shift++;
+    }
+
+    BigLimb* scratch = (BigLimb*)malloc((un + 1 + vn) * sizeof(BigLimb));
+    if (!scratch) {
+        return 1;
+    }
+    BigLimb* un_ = scratch;
+    BigLimb* vn_ = scratch + un + 1;
+
+    for (size_t i = vn - 1; i > 0; i--) {
+        vn_[i] = (v[i] << shift) | (shift ? (BigLimb)((BigDLimb)v[i - 1] >> (32 - shift)) : 0);
+    }
+    vn_[0] = v[0] << shift;
+    un_[un] = shift ? (BigLimb)((BigDLimb)u[un - 1] >> (32 - shift)) : 0;
+    for (size_t i = un - 1; i > 0; i--) {
+        un_[i] = (u[i] << shift) | (shift ? (BigLimb)((BigDLimb)u[i - 1] >> (32 - shift)) : 0);
+    }
+    un_[0] = u[0] << shift;
+
+    for (size_t jj = un - vn + 1; jj > 0; jj--) {
+        size_t j = jj - 1;
+
+        // Estimate the quotient digit from the top two limbs
+        BigDLimb numerator = ((BigDLimb)un_[j + vn] << BIGINT_LIMB_BITS) | un_[j + vn - 1];
+        BigDLimb qhat = numerator / vn_[vn - 1];
+        BigDLimb rhat = numerator % vn_[vn - 1];
+        while (qhat >= base ||
+                qhat * vn_[vn - 2] > ((rhat << BIGINT_LIMB_BITS) | un_[j + vn - 2])) {
+            qhat--;
+            rhat += vn_[vn - 1];
+            if (rhat >= base) {
+                break;
+            }
+        }
+
+        // Multiply and subtract qhat * v from the current window
+        int64_t borrow = 0;
+        BigDLimb carry = 0;
+        for (size_t i = 0; i < vn; i++) {
+            BigDLimb p = qhat * vn_[i] + carry;
+            carry = p >> BIGINT_LIMB_BITS;
+            int64_t t = (int64_t)un_[i + j] - borrow - (int64_t)(p & 0xFFFFFFFFu);
+            un_[i + j] = (BigLimb)t;
+            borrow = (t < 0) ? 1 : 0;
+        }
+        int64_t t = (int64_t)un_[j + vn] - borrow - (int64_t)carry;
+        un_[j + vn] = (BigLimb)t;
+
+        // The estimate was one too large: add v back
+        if (t < 0) {
+            qhat--;
+            BigDLimb c = 0;
+            for (size_t i = 0; i < vn; i++) {
+                c += (BigDLimb)un_[i + j] + vn_[i];
+                un_[i + j] = (BigLimb)c;
+                c >>= BIGINT_LIMB_BITS;
+            }
+            un_[j + vn] += (BigLimb)c;
+        }
+        if (q) {
+            q[j] = (BigLimb)qhat;
+        }
+    }
+
+    // Unnormalise the remainder
+    if (r) {
+        for (size_t i = 0; i < vn - 1; i++) {
+            r[i] = (un_[i] >> shift) |
+                (shift ? (BigLimb)((BigDLimb)un_[i + 1] << (32 - shift)) : 0);
+        }
+        r[vn - 1] = un_[vn - 1] >> shift;
+    }
+    free(scratch);
+    return 0;
+}
+
+/*
+ * bigint_divmod()
+ * ---------------
+ * Computes the quotient and remainder of a / b. The quotient is truncated
+ * toward zero and the remainder takes the sign of the dividend, matching C's
+ * integer '/' and '%'. Either q or r may be NULL, and both may alias a or b.
+ *
+ * Returns: 0 if successful, 1 if b is zero or on allocation failure.
+ */
+static inline int bigint_divmod(BigInt* q, BigInt* r, const BigInt* a, const BigInt* b)
+{
+    if (b->size == 0) {
+        return 1;
+    }
+    bool quotientNegative = a->negative != b->negative;
+    bool remainderNegative = a->negative;
+
+    // Fast path: both magnitudes fit in a 64-bit register
+    if (bigint_fits_u64(a) && bigint_fits_u64(b)) {
+        uint64_t x = bigint_mag_u64(a);
+        uint64_t y = bigint_mag_u64(b);
+        if (q) {
+            bigint_set_u64(q, x / y);
+            q->negative = quotientNegative && q->size > 0;
+        }
+        if (r) {
+            bigint_set_u64(r, x % y);
+            r->negative = remainderNegative && r->size > 0;
+        }
+        return 0;
+    }
+
+    const BigLimb* al = bigint_limbs_const(a);
+    const BigLimb* bl = bigint_limbs_const(b);
+    BigInt quotient, remainder;
+    bigint_init(&quotient);
+    bigint_init(&remainder);
+
+    if (limbs_cmp(al, a->size, bl, b->size) < 0) {
+        // |a| < |b|: quotient is zero and remainder is a
+        if (bigint_copy(&remainder, a) != 0) {
+            return 1;
+        }
+    } else if (b->size == 1) {
+        if (bigint_copy(&quotient, a) != 0) {
+            return 1;
+        }
+        BigLimb rem = bigint_div_small(&quotient, bl[0]);
+        bigint_set_u64(&remainder, rem);
+    } else {
+        size_t qn = a->size - b->size + 1;
+        if (bigint_reserve(&quotient, qn) != 0 ||
+                bigint_reserve(&remainder, b->size) != 0 ||
+                limbs_divmod_knuth(bigint_limbs(&quotient), bigint_limbs(&remainder),
+                    al, a->size, bl, b->size) != 0) {
+            bigint_free(&quotient);
+            bigint_free(&remainder);
+            return 1;
+        }
+        quotient.size = qn;
+        remainder.size = b->size;
+        bigint_normalize(&quotient);
+        bigint_normalize(&remainder);
+    }
+
+    quotient.negative = quotientNegative && quotient.size > 0;
+    remainder.negative = remainderNegative && remainder.size > 0;
+    if (q) {
+        bigint_swap(q, &quotient);
+    }
+    if (r) {
+        bigint_swap(r, &remainder);
+    }
+    bigint_free(&quotient);
+    bigint_free(&remainder);
+    return 0;
+}
+
+/*
+ * bigint_pow()
+ * ------------
+ * Computes r = base^exponent by repeated squaring. r may alias base.
+ *
+ * Returns: 0 if successful, 1 if the result would exceed BIGINT_MAX_LIMBS
+ *          or on allocation failure.
+ */
+static inline int bigint_pow(BigInt* r, const BigInt* base, uint64_t exponent)
+{
+    // Bases 0 and +-1 never grow, whatever the exponent
+    if (base->size == 0 || (base->size == 1 && bigint_limbs_const(base)[0] == 1)) {
+        bool negative = base->negative && (exponent & 1);
+        if (exponent == 0) {
+            bigint_set_u64(r, 1);
+            return 0;
+        }
+        if (bigint_copy(r, base) != 0) {
+            return 1;
+        }
+        r->negative = negative;
+        return 0;
+    }
+
+    size_t bits = bigint_bit_length(base);
+    if (exponent > (uint64_t)(BIGINT_MAX_LIMBS * BIGINT_LIMB_BITS) / (bits - 1 ? bits - 1 : 1)) {
+        return 1;
+    }
+
+    BigInt acc, square;
+    bigint_init(&acc);
+    bigint_init(&square);
+    bigint_set_u64(&acc, 1);
+    if (bigint_copy(&square, base) != 0) {
+        return 1;
+    }
+
+    while (exponent > 0) {
+        if ((exponent & 1) && bigint_mul(&acc, &acc, &square) != 0) {
+            break;
+        }
+        exponent >>= 1;
+        if (exponent > 0 && bigint_mul(&square, &square, &square) != 0) {
+            break;
+        }
+    }
+
+    int status = (exponent == 0) ? 0 : 1;
+    if (status == 0) {
+        bigint_swap(r, &acc);
+    }
+    bigint_free(&acc);
+    bigint_free(&square);
+    return status;
+}
+
+
+/*
+ * bigint_shift_limbs()
+ * --------------------
+ * Computes r = a * B^shift (shift > 0) or r = a / B^-shift truncated toward
+ * zero (shift < 0), where B = 2^32. r may alias a.
+ *
+ * Returns: 0 if successful, 1 on allocation failure or size overflow.
+ */
+static inline int bigint_shift_limbs(BigInt* r, const BigInt* a, long shift)
+{
+    bool negative = a->negative;
+    size_t size = a->size;
+
+    if (shift < 0) {
+        size_t drop = (size_t)(-shift);
+        if (drop >= size) {
+            bigint_set_u64(r, 0);
+            return 0;
+        }
+        if (bigint_reserve(r, size - drop) != 0) {
+            return 1;
+        }
+        memmove(bigint_limbs(r), bigint_limbs_const(a) + drop,
+                (size - drop) * sizeof(BigLimb));
+        r->size = size - drop;
+    } else {
+        if (size == 0) {
+            bigint_set_u64(r, 0);
+            return 0;
+        }
+        if (bigint_reserve(r, size + (size_t)shift) != 0) {
+            return 1;
+        }
+        BigLimb* rl = bigint_limbs(r);
+        memmove(rl + shift, bigint_limbs_const(a), size * sizeof(BigLimb));
+        memset(rl, 0, (size_t)shift * sizeof(BigLimb));
+        r->size = size + (size_t)shift;
+    }
+    r->negative = negative;
+    bigint_normalize(r);
+    return 0;
+}
+
+/*
+ * bigint_set_limb_power()
+ * -----------------------
+ * Sets a = B^n, where B = 2^32.
+ *
+ * Returns: 0 if successful, 1 on allocation failure or size overflow.
+ */
+static inline int bigint_set_limb_power(BigInt* a, size_t n)
+{
+    if (bigint_reserve(a, n + 1) != 0) {
+        return 1;
+    }
+    BigLimb* limbs = bigint_limbs(a);
+    memset(limbs, 0, n * sizeof(BigLimb));
+    limbs[n] = 1;
+    a->size = n + 1;
+    a->negative = false;
+    return 0;
+}
+
+/* Divisor size (limbs) at which reciprocals switch from Algorithm D to Newton */
+#define BIGINT_NEWTON_THRESHOLD 64
+
+/*
+ * bigint_reciprocal()
+ * -------------------
+ * Computes mu = floor(B^(2n) / p) for a positive p of n limbs, the
+ * constant used by bigint_divmod_barrett(). Large divisors use a Newton
+ * step seeded from the reciprocal of p's top half, so the cost is a few
+ * multiplications rather than a quadratic long division.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int bigint_reciprocal(BigInt* mu, const BigInt* p)
+{
+    size_t n = p->size;
+    BigInt power;
+    bigint_init(&power);
+    if (bigint_set_limb_power(&power, 2 * n) != 0) {
+        return 1;
+    }
+
+    if (n <= BIGINT_NEWTON_THRESHOLD) {
+        int status = bigint_divmod(mu, NULL, &power, p);
+        bigint_free(&power);
+        return status;
+    }
+
+    // Seed: reciprocal of the top h limbs, scaled back up to n limbs
+    size_t h = (n + 1) / 2 + 2;
+    BigInt m, t, e;
+    bigint_init(&m);
+    bigint_init(&t);
+    bigint_init(&e);
+    int status = bigint_shift_limbs(&t, p, -(long)(n - h));
+    if (status == 0) {
+        status = bigint_reciprocal(&m, &t);
+    }
+    if (status == 0) {
+        status = bigint_shift_limbs(&m, &m, (long)(n - h));
+    }
+
+    // Newton step: m += m * (B^(2n) - p*m) / B^(2n)
+    if (status == 0) {
+        status = bigint_mul(&t, p, &m);
+    }
+    if (status == 0) {
+        status = bigint_sub(&e, &power, &t);
+    }
+    if (status == 0) {
+        status = bigint_mul(&t, &m, &e);
+    }
+    if (status == 0) {
+        status = bigint_shift_limbs(&t, &t, -(long)(2 * n));
+    }
+    if (status == 0) {
+        status = bigint_add(&m, &m, &t);
+    }
+
+    // The estimate is within a few units: fix it against the remainder
+    if (status == 0) {
+        status = bigint_mul(&t, p, &m);
+    }
+    if (status == 0) {
+        status = bigint_sub(&e, &power, &t);
+    }
+    BigInt one;
+    bigint_init(&one);
+    bigint_set_u64(&one, 1);
+    int steps = 0;
+    while (status == 0 && e.negative && steps++ < 64) {
+        status = bigint_add(&e, &e, p);
+        if (status == 0) {
+            status = bigint_sub(&m, &m, &one);
+        }
+    }
+    while (status == 0 && !e.negative && steps++ < 64 &&
+            limbs_cmp(bigint_limbs_const(&e), e.size, bigint_limbs_const(p), p->size) >= 0) {
+        status = bigint_sub(&e, &e, p);
+        if (status == 0) {
+            status = bigint_add(&m, &m, &one);
+        }
+    }
+    if (status == 0 && steps >= 64) {
+        // Should not happen; fall back to an exact long division
+        status = bigint_divmod(&m, NULL, &power, p);
+    }
+
+    if (status == 0) {
+        bigint_swap(mu, &m);
+    }
+    bigint_free(&m);
+    bigint_free(&t);
+    bigint_free(&e);
+    bigint_free(&power);
+    return status;
+}
+
+/*
+ * bigint_divmod_barrett()
+ * -----------------------
+ * Computes q = x / p and r = x % p for 0 <= x < p^2 using Barrett
+ * reduction with mu = floor(B^(2n) / p) from bigint_reciprocal(). q and r
+ * must be distinct from x, p and mu.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int bigint_divmod_barrett(BigInt* q, BigInt* r, const BigInt* x,
+        const BigInt* p, const BigInt* mu)
+{
+    size_t n = p->size;
+    int status = bigint_shift_limbs(q, x, -(long)(n - 1));
+    if (status == 0) {
+        status = bigint_mul(q, q, mu);
+    }
+    if (status == 0) {
+        status = bigint_shift_limbs(q, q, -(long)(n + 1));
+    }
+    if (status == 0) {
+        status = bigint_mul(r, q, p);
+    }
+    if (status == 0) {
+        status = bigint_sub(r, x, r);
+    }
+
+    // The quotient estimate is at most two short
+    BigInt one;
+    bigint_init(&one);
+    bigint_set_u64(&one, 1);
+    while (status == 0 &&
+            limbs_cmp(bigint_limbs_const(r), r->size, bigint_limbs_const(p), p->size) >= 0) {
+        status = bigint_sub(r, r, p);
+        if (status == 0) {
+            status = bigint_add(q, q, &one);
+        }
+    }
+    return status;
+}
+
+/* Size (limbs) below which radix conversion uses the chunked base case */
+#define BIGINT_RADIX_DC_THRESHOLD 48
+/* Number of base^(chunk * 2^k) levels the radix cache can hold */
+#define BIGINT_RADIX_LEVELS 40
+
+/*
+ * BigRadixCache
+ * -------------
+ * Per-base powers used by the divide-and-conquer radix conversions.
+ * powers[k] = base^(digits * 2^k), where digits is the number of base
+ * digits in one limb-sized chunk; inverses[k] is its Barrett reciprocal
+ * (size 0 until first needed for formatting).
+ */
+typedef struct {
+    int digits;                               // Base digits per limb chunk
+    int levels;                               // Number of powers computed
+    BigInt powers[BIGINT_RADIX_LEVELS];       // base^(digits * 2^k)
+    BigInt inverses[BIGINT_RADIX_LEVELS];     // floor(B^(2n) / powers[k])
+} BigRadixCache;
+
+/* Radix caches indexed by base; filled lazily and kept for the process */
+static BigRadixCache bigintRadixCache[37];
+
+/* Guards bigintRadixCache, which is filled lazily by whichever thread needs it */
+static pthread_mutex_t bigintRadixLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * bigint_radix_power()
+ * --------------------
+ * Returns the cached power base^(digits * 2^level), computing and caching
+ * any missing levels by repeated squaring. Safe to call from any thread;
+ * a level never moves once it has been computed.
+ *
+ * Returns: The power, or NULL on allocation failure or size overflow.
+ */
+static inline const BigInt* bigint_radix_power(int base, int level)
+{
+    BigRadixCache* cache = &bigintRadixCache[base];
+    if (level >= BIGINT_RADIX_LEVELS) {
+        return NULL;
+    }
+    pthread_mutex_lock(&bigintRadixLock);
+    if (cache->levels == 0) {
+        BigLimb chunk = RADIX_CHUNKS[base].power32;
+        cache->digits = RADIX_CHUNKS[base].digits32;
+        for (int k = 0; k < BIGINT_RADIX_LEVELS; k++) {
+            bigint_init(&cache->powers[k]);
+            bigint_init(&cache->inverses[k]);
+        }
+        bigint_set_u64(&cache->powers[0], chunk);
+        cache->levels = 1;
+    }
+    const BigInt* power = &cache->powers[level];
+    while (cache->levels <= level) {
+        int k = cache->levels;
+        if (bigint_mul(&cache->powers[k], &cache->powers[k - 1],
+                    &cache->powers[k - 1]) != 0) {
+            power = NULL;
+            break;
+        }
+        cache->levels++;
+    }
+    pthread_mutex_unlock(&bigintRadixLock);
+    return power;
+}
+
+/*
+ * bigint_radix_inverse()
+ * ----------------------
+ * Returns the Barrett reciprocal of bigint_radix_power(base, level),
+ * computing it on first use.
+ *
+ * Returns: The reciprocal, or NULL on allocation failure.
+ */
+static inline const BigInt* bigint_radix_inverse(int base, int level)
+{
+    const BigInt* power = bigint_radix_power(base, level);
+    if (!power) {
+        return NULL;
+    }
+    BigInt* inverse = &bigintRadixCache[base].inverses[level];
+    pthread_mutex_lock(&bigintRadixLock);
+    if (inverse->size == 0 && bigint_reciprocal(inverse, power) != 0) {
+        inverse = NULL;
+    }
+    pthread_mutex_unlock(&bigintRadixLock);
+    return inverse;
+}
+
+/*
+ * bigint_from_str_basecase()
+ * --------------------------
+ * Quadratic parser used for short inputs: accumulates each limb-sized chunk
+ * of digits in a register and folds it in with one multiply-add pass. The
+ * digits must already have been validated.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int bigint_from_str_basecase(BigInt* a, const char* text, size_t len, int base)
+{
+    bigint_set_u64(a, 0);
+
+    int k = RADIX_CHUNKS[base].digits32;
+    size_t i = 0;
+    while (i < len) {
+        // Accumulate up to k digits in a single limb
+        BigLimb chunk = 0;
+        BigLimb scale = 1;
+        for (int j = 0; j < k && i < len; j++, i++) {
+            chunk = chunk * (BigLimb)base + (BigLimb)digit_value(text[i]);
+            scale *= (BigLimb)base;
+        }
+        if (bigint_mul_small_add(a, scale, chunk) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * bigint_from_str_pow2()
+ * ----------------------
+ * Linear-time parser for bases 2, 4, 8, 16 and 32: each digit's bits are
+ * or-ed straight into place, starting from the least significant digit.
+ * The digits must already have been validated.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int bigint_from_str_pow2(BigInt* a, const char* text, size_t len, int shift)
+{
+    size_t limbCount = (len * (size_t)shift + BIGINT_LIMB_BITS - 1) / BIGINT_LIMB_BITS;
+    if (bigint_reserve(a, limbCount + 1) != 0) {
+        return 1;
+    }
+    BigLimb* limbs = bigint_limbs(a);
+    memset(limbs, 0, (limbCount + 1) * sizeof(BigLimb));
+
+    size_t bit = 0;
+    for (size_t i = len; i > 0; i--, bit += (size_t)shift) {
+        BigLimb digit = (BigLimb)digit_value(text[i - 1]);
+        size_t index = bit / BIGINT_LIMB_BITS;
+        unsigned offset = (unsigned)(bit % BIGINT_LIMB_BITS);
+        limbs[index] |= digit << offset;
+        if (offset + (unsigned)shift > BIGINT_LIMB_BITS) {
+            limbs[index + 1] |= digit >> (BIGINT_LIMB_BITS - offset);
+        }
+    }
+    a->size = limbCount + 1;
+    a->negative = false;
+    bigint_normalize(a);
+    return 0;
+}
+
+/*
+ * bigint_from_str_dc()
+ * --------------------
+ * Divide-and-conquer parser: splits the digits so the low half is exactly
+ * digits * 2^k long, parses both halves recursively and joins them as
+ * high * base^(digits * 2^k) + low using the cached power. The digits
+ * must already have been validated.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int bigint_from_str_dc(BigInt* a, const char* text, size_t len, int base)
+{
+    size_t chunkDigits = (size_t)bigintRadixCache[base].digits;
+    if (len <= chunkDigits * BIGINT_RADIX_DC_THRESHOLD) {
+        return bigint_from_str_basecase(a, text, len, base);
+    }
+
+    int level = 0;
+    while ((chunkDigits << (level + 1)) < len) {
+        level++;
+    }
+    size_t lowLen = chunkDigits << level;
+    const BigInt* power = bigint_radix_power(base, level);
+    if (!power) {
+        return 1;
+    }
+
+    BigInt low;
+    bigint_init(&low);
+    int status = bigint_from_str_dc(a, text, len - lowLen, base);
+    if (status == 0) {
+        status = bigint_from_str_dc(&low, text + len - lowLen, lowLen, base);
+    }
+    if (status == 0) {
+        status = bigint_mul(a, a, power);
+    }
+    if (status == 0) {
+        status = bigint_add(a, a, &low);
+    }
+    bigint_free(&low);
+    return status;
+}
+
+/*
+ * bigint_from_str()
+ * -----------------
+ * Parses a non-negative number written in the given base. Long inputs are
+ * converted by divide and conquer over cached powers of the base, which
+ * costs O(M(n) log n) instead of O(n^2).
+ *
+ * a: BigInt to receive the value
+ * text: The digits (need not be null terminated)
+ * len: Number of digits
+ * base: The base of the digits (2-36)
+ *
+ * Returns: 0 if successful, 1 if a character is not a digit of base, the
+ *          value is too large, or on allocation failure.
+ */
+static inline int bigint_from_str(BigInt* a, const char* text, size_t len, int base)
+{
+    if (base < 2 || base > 36) {
+        return 1;
+    }
+    // Reject bad input up front, before any of the expensive work
+    if (digit_run_length(text, len, base) != len) {
+        return 1;
+    }
+    if ((base & (base - 1)) == 0) {
+        return bigint_from_str_pow2(a, text, len, __builtin_ctz((unsigned)base));
+    }
+    if (!bigint_radix_power(base, 0)) {
+        return 1;
+    }
+    return bigint_from_str_dc(a, text, len, base);
+}
+
+/*
+ * bigint_format_basecase()
+ * ------------------------
+ * Writes the digits of a non-negative x so that they end just before end,
+ * peeling one limb-sized chunk per single-limb division. If width is
+ * non-zero exactly width digits are written (x must be below base^width),
+ * otherwise no leading zeros are written.
+ *
+ * Returns: Pointer to the first digit written, or NULL on allocation failure.
+ */
+static inline char* bigint_format_basecase(const BigInt* x, int base, char* end, size_t width)
+{
+    BigInt work;
+    bigint_init(&work);
+    if (bigint_copy(&work, x) != 0) {
+        return NULL;
+    }
+
+    BigLimb power = RADIX_CHUNKS[base].power32;
+    int k = RADIX_CHUNKS[base].digits32;
+    char* p = end;
+    char* stop = end - width;
+    while (work.size > 0) {
+        BigLimb chunk = bigint_div_small(&work, power);
+        for (int j = 0; j < k && (chunk > 0 || work.size > 0); j++) {
+            BigLimb digit = chunk % (BigLimb)base;
+            *--p = (char)(digit < 10 ? '0' + digit : 'A' + (digit - 10));
+            chunk /= (BigLimb)base;
+        }
+    }
+    bigint_free(&work);
+
+    while (width > 0 && p > stop) {
+        *--p = '0';
+    }
+    return p;
+}
+
+/*
+ * bigint_format_pow2()
+ * --------------------
+ * Linear-time formatter for bases 2, 4, 8, 16 and 32: each digit is read
+ * straight out of the limbs with a shift and a mask. x must be non-zero.
+ *
+ * Returns: Pointer to the first digit written.
+ */
+static inline char* bigint_format_pow2(const BigInt* x, int shift, char* end)
+{
+    const BigLimb* limbs = bigint_limbs_const(x);
+    size_t digits = (bigint_bit_length(x) + (size_t)shift - 1) / (size_t)shift;
+    BigLimb mask = ((BigLimb)1 << shift) - 1;
+    char* p = end;
+    size_t bit = 0;
+    for (size_t i = 0; i < digits; i++, bit += (size_t)shift) {
+        size_t index = bit / BIGINT_LIMB_BITS;
+        unsigned offset = (unsigned)(bit % BIGINT_LIMB_BITS);
+        BigLimb value = limbs[index] >> offset;
+        if (offset + (unsigned)shift > BIGINT_LIMB_BITS && index + 1 < x->size) {
+            value |= limbs[index + 1] << (BIGINT_LIMB_BITS - offset);
+        }
+        BigLimb digit = value & mask;
+        *--p = (char)(digit < 10 ? '0' + digit : 'A' + (digit - 10));
+    }
+    return p;
+}
+
+/*
+ * bigint_format_dc()
+ * ------------------
+ * Divide-and-conquer formatter for 0 <= x < powers[level + 1]: splits x by
+ * the cached power base^(digits * 2^level) with a Barrett division and
+ * formats the quotient and the zero-padded remainder recursively. width has
+ * the same meaning as for bigint_format_basecase().
+ *
+ * Returns: Pointer to the first digit written, or NULL on failure.
+ */
+static inline char* bigint_format_dc(const BigInt* x, int base, int level, char* end, size_t width)
+{
+    if (x->size <= BIGINT_RADIX_DC_THRESHOLD || level < 0) {
+        return bigint_format_basecase(x, base, end, width);
+    }
+
+    const BigInt* power = bigint_radix_power(base, level);
+    if (!power) {
+        return NULL;
+    }
+    // Without padding, skip levels the value does not reach
+    if (width == 0 && limbs_cmp(bigint_limbs_const(x), x->size,
+                bigint_limbs_const(power), power->size) < 0) {
+        return bigint_format_dc(x, base, level - 1, end, 0);
+    }
+    const BigInt* inverse = bigint_radix_inverse(base, level);
+    if (!inverse) {
+        return NULL;
+    }
+
+    BigInt q, r;
+    bigint_init(&q);
+    bigint_init(&r);
+    char* p = NULL;
+    size_t lowWidth = (size_t)bigintRadixCache[base].digits << level;
+    if (bigint_divmod_barrett(&q, &r, x, power, inverse) == 0) {
+        p = bigint_format_dc(&r, base, level - 1, end, lowWidth);
+        bigint_free(&r);
+        if (p) {
+            p = bigint_format_dc(&q, base, level - 1, p, width ? width - lowWidth : 0);
+        }
+    }
+    bigint_free(&q);
+    bigint_free(&r);
+    return p;
+}
+
+/*
+ * bigint_to_str_arena()
+ * ---------------------
+ * Converts a BigInt to a string in the specified base, using uppercase
+ * letters for digits 10-35 and a leading '-' for negative values. Long
+ * values are split recursively by cached powers of the base, so the cost
+ * is O(M(n) log n) instead of O(n^2).
+ *
+ * arena: Scratch arena for the string, or NULL to use the heap
+ * a: The number to convert
+ * base: The base to convert to (2-36)
+ *
+ * Returns: A string containing the number, which lives in arena until its
+ *          next reset, or was allocated with malloc() if arena is NULL
+ *          (in which case it is the caller's responsibility to free it).
+ *          Returns NULL on error.
+ */
+static inline char* bigint_to_str_arena(Arena* arena, const BigInt* a, int base)
+{
+    if (base < 2 || base > 36) {
+        return NULL;
+    }
+
+    // Upper bound on digits: one per bit is enough for base 2
+    size_t maxDigits = bigint_bit_length(a) + 1;
+    char* result = (char*)arena_alloc(arena, maxDigits + 2);
+    if (!result) {
+        return NULL;
+    }
+    char* end = result + maxDigits + 1;
+    *end = '\0';
+
+    // Power-of-two bases need no division at all
+    if ((base & (base - 1)) == 0 && a->size > 0) {
+        char* p = bigint_format_pow2(a, __builtin_ctz((unsigned)base), end);
+        if (a->negative) {
+            *--p = '-';
+        }
+        memmove(result, p, (size_t)(end - p) + 1);
+        return result;
+    }
+
+    // Find the smallest level whose square exceeds |a|
+    BigInt magnitude = *a;
+    magnitude.negative = false;
+    int level = -1;
+    if (a->size > BIGINT_RADIX_DC_THRESHOLD) {
+        const BigInt* power;
+        do {
+            level++;
+            power = bigint_radix_power(base, level + 1);
+        } while (power && limbs_cmp(bigint_limbs_const(a), a->size,
+                    bigint_limbs_const(power), power->size) >= 0);
+        if (!power) {
+            arena_release(arena, result);
+            return NULL;
+        }
+    }
+
+    char* p = bigint_format_dc(&magnitude, base, level, end, 0);
+    if (!p) {
+        arena_release(arena, result);
+        return NULL;
+    }
+    if (p == end) {
+        *--p = '0';
+    }
+    if (a->negative) {
+        *--p = '-';
+    }
+
+    memmove(result, p, (size_t)(end - p) + 1);
+    return result;
+}
+
+/*
+ * bigint_to_str()
+ * ---------------
+ * Heap-backed bigint_to_str_arena(): the string is allocated with malloc()
+ * and the caller must free it.
+ */
+static inline char* bigint_to_str(const BigInt* a, int base)
+{
+    return bigint_to_str_arena(NULL, a, base);
+}
+
+#endif /* BIGINT_H */
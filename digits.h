@@ -0,0 +1,312 @@
+#ifndef DIGITS_H
+#define DIGITS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "radix.h"
+
+/*
+ * Digit classification and parsing for long literals. Runs of digits are
+ * validated and converted a whole vector at a time with SSE2, AVX2 or NEON
+ * where the compiler targets them, and one character at a time everywhere
+ * else. Define DIGITS_SCALAR_ONLY to force the portable code.
+ */
+
+#if !defined(DIGITS_SCALAR_ONLY) && defined(__AVX2__)
+#include <immintrin.h>
+#define DIGITS_AVX2
+#define DIGITS_BLOCK 32
+#elif !defined(DIGITS_SCALAR_ONLY) && defined(__SSE2__)
+#include <emmintrin.h>
+#define DIGITS_SSE2
+#define DIGITS_BLOCK 16
+#elif !defined(DIGITS_SCALAR_ONLY) && defined(__ARM_NEON) && \
+        defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define DIGITS_NEON
+#define DIGITS_BLOCK 16
+#else
+#define DIGITS_BLOCK 0
+#endif
+
+/* Digit value of every character, or -1 if it is not a digit of any base */
+static const signed char DIGIT_VALUES[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/*
+ * digit_value()
+ * -------------
+ * Returns the digit value (0-35) of c in bases up to 36, or -1 if c is not
+ * a digit. Letters of either case count from 10.
+ */
+static inline int digit_value(char c)
+{
+    return DIGIT_VALUES[(unsigned char)c];
+}
+
+#if DIGITS_BLOCK
+#if defined(DIGITS_AVX2)
+typedef __m256i DigitBlock;
+#elif defined(DIGITS_SSE2)
+typedef __m128i DigitBlock;
+#else
+typedef uint8x16_t DigitBlock;
+#endif
+
+/*
+ * digits_block_classify()
+ * -----------------------
+ * Maps DIGITS_BLOCK characters starting at s to their digit values (0xFF
+ * for anything that is not a digit) and checks each against base.
+ *
+ * s: At least DIGITS_BLOCK readable characters
+ * base: The base the digits are written in (2-36)
+ * values: Receives the digit value of every character
+ *
+ * Returns: 0 if every character is a digit of base, otherwise a mask with
+ *          DIGITS_MASK_BITS set bits per character that is not, in order.
+ */
+#if defined(DIGITS_AVX2)
+#define DIGITS_MASK_BITS 1
+static inline uint64_t digits_block_classify(const char* s, int base, DigitBlock* values)
+{
+    __m256i c = _mm256_loadu_si256((const __m256i*)s);
+    __m256i dec = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i isDec = _mm256_cmpeq_epi8(_mm256_min_epu8(dec, _mm256_set1_epi8(9)), dec);
+    // Setting bit 5 folds upper case onto lower case
+    __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)),
+                                    _mm256_set1_epi8('a'));
+    __m256i isAlpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(25)), alpha);
+    alpha = _mm256_add_epi8(alpha, _mm256_set1_epi8(10));
+
+    __m256i isDigit = _mm256_or_si256(isDec, isAlpha);
+    __m256i v = _mm256_or_si256(_mm256_and_si256(isDec, dec), _mm256_and_si256(isAlpha, alpha));
+    v = _mm256_or_si256(v, _mm256_xor_si256(isDigit, _mm256_set1_epi8(-1)));
+    *values = v;
+
+    __m256i valid = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8((char)(base - 1))), v);
+    return (uint32_t)~_mm256_movemask_epi8(valid);
+}
+#elif defined(DIGITS_SSE2)
+#define DIGITS_MASK_BITS 1
+static inline uint64_t digits_block_classify(const char* s, int base, DigitBlock* values)
+{
+    __m128i c = _mm_loadu_si128((const __m128i*)s);
+    __m128i dec = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i isDec = _mm_cmpeq_epi8(_mm_min_epu8(dec, _mm_set1_epi8(9)), dec);
+    // Setting bit 5 folds upper case onto lower case
+    __m128i alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(25)), alpha);
+    alpha = _mm_add_epi8(alpha, _mm_set1_epi8(10));
+
+    __m128i isDigit = _mm_or_si128(isDec, isAlpha);
+    __m128i v = _mm_or_si128(_mm_and_si128(isDec, dec), _mm_and_si128(isAlpha, alpha));
+    v = _mm_or_si128(v, _mm_xor_si128(isDigit, _mm_set1_epi8(-1)));
+    *values = v;
+
+    __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8((char)(base - 1))), v);
+    return (uint64_t)(~_mm_movemask_epi8(valid) & 0xFFFF);
+}
+#else
+#define DIGITS_MASK_BITS 4
+static inline uint64_t digits_block_classify(const char* s, int base, DigitBlock* values)
+{
+    uint8x16_t c = vld1q_u8((const uint8_t*)s);
+    uint8x16_t dec = vsubq_u8(c, vdupq_n_u8('0'));
+    uint8x16_t isDec = vcleq_u8(dec, vdupq_n_u8(9));
+    // Setting bit 5 folds upper case onto lower case
+    uint8x16_t alpha = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    uint8x16_t isAlpha = vcleq_u8(alpha, vdupq_n_u8(25));
+    alpha = vaddq_u8(alpha, vdupq_n_u8(10));
+
+    uint8x16_t v = vbslq_u8(isDec, dec, vbslq_u8(isAlpha, alpha, vdupq_n_u8(0xFF)));
+    *values = v;
+
+    // Narrow the comparison to four bits per character to form a mask
+    uint8x16_t invalid = vcgeq_u8(v, vdupq_n_u8((uint8_t)base));
+    uint8x8_t mask = vshrn_n_u16(vreinterpretq_u16_u8(invalid), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(mask), 0);
+}
+#endif
+
+/*
+ * digits_block_value()
+ * --------------------
+ * Combines DIGITS_BLOCK valid digit values into the number they spell.
+ * Neighbouring digits are joined as d0 * base + d1 and neighbouring pairs
+ * as p0 * base^2 + p1 with vector multiply-adds, leaving groups of four
+ * digits that are folded together with base^4.
+ *
+ * Returns: The value of the block modulo 2^64.
+ */
+static inline unsigned long long digits_block_value(const DigitBlock* values, int base,
+                                                    unsigned long long base4)
+{
+    uint64_t groups[DIGITS_BLOCK / 4];
+#if defined(DIGITS_AVX2)
+    __m256i pairWeights = _mm256_set1_epi32((1 << 16) | base);
+    __m256i base2 = _mm256_set1_epi32(base * base);
+    for (int half = 0; half < 2; half++) {
+        __m128i bytes = half ? _mm256_extracti128_si256(*values, 1)
+                             : _mm256_castsi256_si128(*values);
+        __m256i pairs = _mm256_madd_epi16(_mm256_cvtepu8_epi16(bytes), pairWeights);
+        __m256i quads = _mm256_add_epi64(_mm256_mul_epu32(pairs, base2),
+                                         _mm256_srli_epi64(pairs, 32));
+        _mm256_storeu_si256((__m256i*)&groups[half * 4], quads);
+    }
+#elif defined(DIGITS_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i pairWeights = _mm_set1_epi32((1 << 16) | base);
+    __m128i base2 = _mm_set1_epi32(base * base);
+    for (int half = 0; half < 2; half++) {
+        __m128i words = half ? _mm_unpackhi_epi8(*values, zero)
+                             : _mm_unpacklo_epi8(*values, zero);
+        __m128i pairs = _mm_madd_epi16(words, pairWeights);
+        __m128i quads = _mm_add_epi64(_mm_mul_epu32(pairs, base2), _mm_srli_epi64(pairs, 32));
+        _mm_storeu_si128((__m128i*)&groups[half * 2], quads);
+    }
+#else
+    uint16x8_t pairWeights = vreinterpretq_u16_u32(vdupq_n_u32((1u << 16) | (uint32_t)base));
+    uint32x4_t quadWeights =
+        vreinterpretq_u32_u64(vdupq_n_u64((1ULL << 32) | (uint64_t)(base * base)));
+    for (int half = 0; half < 2; half++) {
+        uint16x8_t words = vmovl_u8(half ? vget_high_u8(*values) : vget_low_u8(*values));
+        uint32x4_t pairs = vpaddlq_u16(vmulq_u16(words, pairWeights));
+        uint64x2_t quads = vpaddlq_u32(vmulq_u32(pairs, quadWeights));
+        vst1q_u64(&groups[half * 2], quads);
+    }
+#endif
+    unsigned long long value = groups[0];
+    for (int k = 1; k < DIGITS_BLOCK / 4; k++) {
+        value = value * base4 + groups[k];
+    }
+    return value;
+}
+#endif /* DIGITS_BLOCK */
+
+/*
+ * digit_run_length()
+ * ------------------
+ * Measures the run of valid digits for the given base at the start of s.
+ *
+ * Returns: Number of leading characters of s (at most len) that are digits
+ *          of the base.
+ */
+static inline size_t digit_run_length(const char* s, size_t len, int base)
+{
+    size_t i = 0;
+#if DIGITS_BLOCK
+    while (len - i >= DIGITS_BLOCK) {
+        DigitBlock values;
+        uint64_t invalid = digits_block_classify(s + i, base, &values);
+        if (invalid) {
+            return i + (size_t)(__builtin_ctzll(invalid) / DIGITS_MASK_BITS);
+        }
+        i += DIGITS_BLOCK;
+    }
+#endif
+    while (i < len && (unsigned)digit_value(s[i]) < (unsigned)base) {
+        i++;
+    }
+    return i;
+}
+
+/*
+ * digit_run_parse()
+ * -----------------
+ * Validates and converts the run of digits at the start of s in one pass.
+ * Whole blocks are handled by the vector kernels; the remainder is gathered
+ * RADIX_CHUNKS[base].digits32 digits at a time in a 32-bit accumulator and
+ * folded in with one 64-bit multiply per chunk. Power-of-two bases are
+ * shifted in instead, a block or a digit at a time. Values wider than 64
+ * bits wrap, exactly as digit by digit accumulation would.
+ *
+ * s: The characters to scan
+ * len: Number of characters available
+ * base: The base the digits are written in (2-36)
+ * value: Receives the value of the run modulo 2^64
+ *
+ * Returns: Length of the run, i.e. the index of the first character that
+ *          is not a digit of base, or len.
+ */
+static inline size_t digit_run_parse(const char* s, size_t len, int base,
+                                     unsigned long long* value)
+{
+    unsigned long long result = 0;
+    size_t i = 0;
+    int shift = radix_pow2_shift(base);
+
+#if DIGITS_BLOCK
+    if (len >= DIGITS_BLOCK) {
+        unsigned long long base4 = (unsigned long long)(base * base) * (unsigned long long)(base * base);
+        // A block of base 2^shift digits is shift * DIGITS_BLOCK bits wide
+        unsigned long long scale = 1;
+        if (shift) {
+            scale = shift * DIGITS_BLOCK < 64 ? 1ULL << (shift * DIGITS_BLOCK) : 0;
+        } else {
+            for (int k = 0; k < DIGITS_BLOCK; k++) {
+                scale *= (unsigned long long)base;
+            }
+        }
+        while (len - i >= DIGITS_BLOCK) {
+            DigitBlock values;
+            if (digits_block_classify(s + i, base, &values) != 0) {
+                break;
+            }
+            result = result * scale + digits_block_value(&values, base, base4);
+            i += DIGITS_BLOCK;
+        }
+    }
+#endif
+
+    if (shift) {
+        for (; i < len; i++) {
+            int digit = digit_value(s[i]);
+            if ((unsigned)digit >= (unsigned)base) {
+                break;
+            }
+            result = (result << shift) | (unsigned long long)digit;
+        }
+        *value = result;
+        return i;
+    }
+
+    int chunk = RADIX_CHUNKS[base].digits32;
+    bool more = true;
+    while (more && i < len) {
+        uint32_t acc = 0;
+        unsigned long long scale = 1;
+        for (int k = 0; k < chunk && i < len; k++, i++) {
+            int digit = digit_value(s[i]);
+            if ((unsigned)digit >= (unsigned)base) {
+                more = false;
+                break;
+            }
+            acc = acc * (uint32_t)base + (uint32_t)digit;
+            scale *= (unsigned long long)base;
+        }
+        result = result * scale + acc;
+    }
+
+    *value = result;
+    return i;
+}
+
+#endif /* DIGITS_H */
@@ -0,0 +1,243 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "arena.h"
+
+/*
+ * Bounded store of the most recent calculations, shared by the interactive
+ * calculator and the embeddable engine. Entries live in a ring of a fixed
+ * capacity: once it is full each new entry replaces the oldest. The
+ * strings of every entry are allocated from one arena. Replaced entries
+ * leave their strings behind until the arena holds more dead bytes than
+ * live ones, when the live strings are copied into a fresh arena, so
+ * appends stay O(1) amortised and memory stays bounded.
+ */
+
+#define HISTORY_MIN_ARENA_BYTES (1 << 16) // Arena bytes never worth compacting
+
+/*
+ * HistoryEntry
+ * ------------
+ * One calculation: an expression, its base, and its result already written
+ * out in that base. Both strings are null terminated and live in the
+ * history arena.
+ */
+typedef struct {
+    const char* expression; // The mathematical expression string
+    size_t expressionLen;   // Number of characters in expression
+    int base;               // The base used for the expression
+    const char* result;     // The result digits in base
+    size_t resultLen;       // Number of characters in result
+} HistoryEntry;
+
+/*
+ * HistoryRing
+ * -----------
+ * The ring of entries and the arena behind their strings.
+ */
+typedef struct {
+    HistoryEntry* entries; // Ring of capacity entries, allocated on first use
+    size_t capacity;       // Most entries kept
+    size_t start;          // Index of the oldest entry
+    size_t count;          // Number of entries held
+    Arena arena;           // Strings of the entries, live and dead
+    size_t arenaBytes;     // Bytes allocated from arena since it was fresh
+    size_t liveBytes;      // Bytes of the strings of the entries held
+} HistoryRing;
+
+/*
+ * history_ring_init()
+ * -------------------
+ * Creates an empty ring that keeps at most capacity entries (at least 1).
+ * Nothing is allocated until the first entry is added.
+ */
+static inline void history_ring_init(HistoryRing* ring, size_t capacity)
+{
+    ring->entries = NULL;
+    ring->capacity = capacity;
+    ring->start = 0;
+    ring->count = 0;
+    arena_init(&ring->arena);
+    ring->arenaBytes = 0;
+    ring->liveBytes = 0;
+}
+
+/*
+ * history_ring_free()
+ * -------------------
+ * Releases every entry and string, leaving an empty ring of the same
+ * capacity.
+ */
+static inline void history_ring_free(HistoryRing* ring)
+{
+    free(ring->entries);
+    arena_free(&ring->arena);
+    history_ring_init(ring, ring->capacity);
+}
+
+/*
+ * history_ring_clear()
+ * --------------------
+ * Forgets every entry, keeping the memory for reuse.
+ */
+static inline void history_ring_clear(HistoryRing* ring)
+{
+    ring->start = 0;
+    ring->count = 0;
+    arena_reset(&ring->arena);
+    ring->arenaBytes = 0;
+    ring->liveBytes = 0;
+}
+
+/*
+ * history_ring_entry()
+ * --------------------
+ * Returns entry number i (0 is the oldest), or NULL if there is no such
+ * entry.
+ */
+static inline const HistoryEntry* history_ring_entry(const HistoryRing* ring, size_t i)
+{
+    if (i >= ring->count) {
+        return NULL;
+    }
+    return &ring->entries[(ring->start + i) % ring->capacity];
+}
+
+/*
+ * history_ring_compact()
+ * ----------------------
+ * Copies the strings of every entry held into a fresh arena and frees the
+ * old one, dropping the strings of replaced entries. If memory runs out
+ * the old arena is kept as it is.
+ */
+static inline void history_ring_compact(HistoryRing* ring)
+{
+    Arena fresh;
+    arena_init(&fresh);
+    char** texts = (char**)arena_alloc(&fresh, sizeof(char*) * ring->count);
+    if (!texts && ring->count > 0) {
+        return;
+    }
+    // Everything is copied before any entry is changed
+    for (size_t i = 0; i < ring->count; i++) {
+        const HistoryEntry* entry = history_ring_entry(ring, i);
+        size_t bytes = entry->expressionLen + entry->resultLen + 2;
+        texts[i] = (char*)arena_alloc(&fresh, bytes);
+        if (!texts[i]) {
+            arena_free(&fresh);
+            return;
+        }
+        memcpy(texts[i], entry->expression, bytes);
+    }
+    for (size_t i = 0; i < ring->count; i++) {
+        HistoryEntry* entry = &ring->entries[(ring->start + i) % ring->capacity];
+        entry->expression = texts[i];
+        entry->result = texts[i] + entry->expressionLen + 1;
+    }
+    arena_free(&ring->arena);
+    ring->arena = fresh;
+    ring->arenaBytes = ring->liveBytes + sizeof(char*) * ring->count;
+}
+
+/*
+ * history_ring_push()
+ * -------------------
+ * Adds a new entry, replacing the oldest entry once the ring is full. The
+ * expression and result are copied together into one arena allocation.
+ *
+ * ring: The ring to add to
+ * expression: The mathematical expression (need not be null terminated)
+ * len: Number of characters in the expression
+ * base: The base used for the expression
+ * result: The result digits in base (need not be null terminated)
+ * resultLen: Number of characters in result
+ *
+ * Returns: false if memory allocation fails (the ring is then unchanged)
+ */
+static inline bool history_ring_push(HistoryRing* ring, const char* expression, size_t len,
+        int base, const char* result, size_t resultLen)
+{
+    if (!ring->entries) {
+        ring->entries = (HistoryEntry*)malloc(sizeof(HistoryEntry) * ring->capacity);
+        if (!ring->entries) {
+            return false;
+        }
+    }
+
+    // Dead strings are dropped once they outweigh the live ones
+    size_t bytes = len + resultLen + 2;
+    if (ring->arenaBytes > HISTORY_MIN_ARENA_BYTES &&
+            ring->arenaBytes > 2 * ring->liveBytes) {
+        history_ring_compact(ring);
+    }
+    char* text = (char*)arena_alloc(&ring->arena, bytes);
+    if (!text) {
+        return false;
+    }
+    ring->arenaBytes += bytes;
+
+    // A full ring gives up its oldest entry
+    HistoryEntry* entry;
+    if (ring->count == ring->capacity) {
+        entry = &ring->entries[ring->start];
+        ring->liveBytes -= entry->expressionLen + entry->resultLen + 2;
+        ring->start = (ring->start + 1) % ring->capacity;
+    } else {
+        entry = &ring->entries[(ring->start + ring->count) % ring->capacity];
+        ring->count++;
+    }
+
+    memcpy(text, expression, len);
+    text[len] = '\0';
+    memcpy(text + len + 1, result, resultLen);
+    text[len + 1 + resultLen] = '\0';
+    entry->expression = text;
+    entry->expressionLen = len;
+    entry->base = base;
+    entry->result = text + len + 1;
+    entry->resultLen = resultLen;
+    ring->liveBytes += bytes;
+    return true;
+}
+
+/*
+ * history_ring_resize()
+ * ---------------------
+ * Changes how many entries the ring keeps (at least 1). Shrinking keeps
+ * the newest entries; the strings of the dropped ones are reclaimed by the
+ * next compaction.
+ *
+ * Returns: false if memory allocation fails (the ring is then unchanged)
+ */
+static inline bool history_ring_resize(HistoryRing* ring, size_t capacity)
+{
+    if (!ring->entries) {
+        ring->capacity = capacity;
+        return true;
+    }
+    HistoryEntry* entries = (HistoryEntry*)malloc(sizeof(HistoryEntry) * capacity);
+    if (!entries) {
+        return false;
+    }
+
+    size_t kept = ring->count < capacity ? ring->count : capacity;
+    for (size_t i = 0; i < kept; i++) {
+        entries[i] = *history_ring_entry(ring, ring->count - kept + i);
+    }
+    for (size_t i = 0; i < ring->count - kept; i++) {
+        const HistoryEntry* entry = history_ring_entry(ring, i);
+        ring->liveBytes -= entry->expressionLen + entry->resultLen + 2;
+    }
+    free(ring->entries);
+    ring->entries = entries;
+    ring->capacity = capacity;
+    ring->start = 0;
+    ring->count = kept;
+    return true;
+}
+
+#endif /* HISTORY_H */
@@ -0,0 +1,75 @@
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <stdint.h>
+
+/*
+ * RadixChunk
+ * ----------
+ * Largest run of digits of a base that fits in a 64-bit or a 32-bit word,
+ * together with the matching power of the base. Conversions use these to
+ * move a whole chunk of digits per multiply or divide.
+ */
+typedef struct {
+    int digits64;     // Largest k with base^k <= UINT64_MAX
+    uint64_t power64; // base^digits64
+    int digits32;     // Largest k with base^k <= UINT32_MAX
+    uint32_t power32; // base^digits32
+} RadixChunk;
+
+/* Chunk sizes indexed by base (2-36); entries 0 and 1 are unused */
+static const RadixChunk RADIX_CHUNKS[37] = {
+    { 0,                     0ULL,  0,          0U}, // base 0 (unused)
+    { 0,                     0ULL,  0,          0U}, // base 1 (unused)
+    {63,  9223372036854775808ULL, 31, 2147483648U}, // base 2
+    {40, 12157665459056928801ULL, 20, 3486784401U}, // base 3
+    {31,  4611686018427387904ULL, 15, 1073741824U}, // base 4
+    {27,  7450580596923828125ULL, 13, 1220703125U}, // base 5
+    {24,  4738381338321616896ULL, 12, 2176782336U}, // base 6
+    {22,  3909821048582988049ULL, 11, 1977326743U}, // base 7
+    {21,  9223372036854775808ULL, 10, 1073741824U}, // base 8
+    {20, 12157665459056928801ULL, 10, 3486784401U}, // base 9
+    {19, 10000000000000000000ULL,  9, 1000000000U}, // base 10
+    {18,  5559917313492231481ULL,  9, 2357947691U}, // base 11
+    {17,  2218611106740436992ULL,  8,  429981696U}, // base 12
+    {17,  8650415919381337933ULL,  8,  815730721U}, // base 13
+    {16,  2177953337809371136ULL,  8, 1475789056U}, // base 14
+    {16,  6568408355712890625ULL,  8, 2562890625U}, // base 15
+    {15,  1152921504606846976ULL,  7,  268435456U}, // base 16
+    {15,  2862423051509815793ULL,  7,  410338673U}, // base 17
+    {15,  6746640616477458432ULL,  7,  612220032U}, // base 18
+    {15, 15181127029874798299ULL,  7,  893871739U}, // base 19
+    {14,  1638400000000000000ULL,  7, 1280000000U}, // base 20
+    {14,  3243919932521508681ULL,  7, 1801088541U}, // base 21
+    {14,  6221821273427820544ULL,  7, 2494357888U}, // base 22
+    {14, 11592836324538749809ULL,  7, 3404825447U}, // base 23
+    {13,   876488338465357824ULL,  6,  191102976U}, // base 24
+    {13,  1490116119384765625ULL,  6,  244140625U}, // base 25
+    {13,  2481152873203736576ULL,  6,  308915776U}, // base 26
+    {13,  4052555153018976267ULL,  6,  387420489U}, // base 27
+    {13,  6502111422497947648ULL,  6,  481890304U}, // base 28
+    {13, 10260628712958602189ULL,  6,  594823321U}, // base 29
+    {13, 15943230000000000000ULL,  6,  729000000U}, // base 30
+    {12,   787662783788549761ULL,  6,  887503681U}, // base 31
+    {12,  1152921504606846976ULL,  6, 1073741824U}, // base 32
+    {12,  1667889514952984961ULL,  6, 1291467969U}, // base 33
+    {12,  2386420683693101056ULL,  6, 1544804416U}, // base 34
+    {12,  3379220508056640625ULL,  6, 1838265625U}, // base 35
+    {12,  4738381338321616896ULL,  6, 2176782336U}, // base 36
+};
+
+/*
+ * radix_pow2_shift()
+ * ------------------
+ * Returns log2(base) if base is a power of two (2, 4, 8, 16 or 32),
+ * or 0 for any other base.
+ */
+static inline int radix_pow2_shift(int base)
+{
+    if (base < 2 || (base & (base - 1)) != 0) {
+        return 0;
+    }
+    return __builtin_ctz((unsigned)base);
+}
+
+#endif /* RADIX_H */
@@ -0,0 +1,422 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/*
+ * Bounded LRU cache of evaluated expressions. Entries are keyed on the
+ * input base and the normalised expression text, and hold the evaluation
+ * status, the value and, once rendered, the digits of the value in every
+ * base the caller displays. The table is open addressed with linear
+ * probing and backward-shift deletion, and the entries form a doubly
+ * linked list in recency order, so lookups, insertions and evictions are
+ * all O(1) and a full cache recycles its entries without calling malloc().
+ *
+ * A cache is not thread safe: every thread that evaluates expressions
+ * owns its own shard.
+ */
+
+#define RESULT_CACHE_MAX_KEY 256     // Longer expressions are not cached
+#define RESULT_CACHE_MAX_RENDERS 40  // Digit strings held per entry
+#define RESULT_CACHE_NONE UINT32_MAX // End of the recency list
+
+/*
+ * ResultCacheEntry
+ * ----------------
+ * One cached expression. data holds the key followed by every rendered
+ * digit string; renderEnds[i] is the offset just past digit string i.
+ */
+typedef struct {
+    uint64_t hash;                               // Hash of base and key
+    int base;                                    // Input base of the key
+    int status;                                  // 0 if it evaluated, else 1 + EvalFailure
+    unsigned long long value;                    // The result when status is 0
+    uint32_t prev;                               // More recently used entry
+    uint32_t next;                               // Less recently used entry
+    size_t keyLen;                               // Bytes of key at data (0 if unused)
+    char* data;                                  // Key, then digit strings
+    size_t dataLen;                              // Bytes in use
+    size_t dataCapacity;                         // Bytes allocated
+    int renderCount;                             // Digit strings rendered
+    uint16_t renderEnds[RESULT_CACHE_MAX_RENDERS]; // End of each digit string
+} ResultCacheEntry;
+
+/*
+ * ResultCacheStats
+ * ----------------
+ * Counters of a cache, or of every shard of one.
+ */
+typedef struct {
+    size_t hits;      // Lookups answered from the cache
+    size_t misses;    // Lookups that had to evaluate
+    size_t evictions; // Entries recycled to make room
+} ResultCacheStats;
+
+/*
+ * ResultCache
+ * -----------
+ * The entries, and a table of slots each holding an entry index plus one
+ * (0 for an empty slot). The table has at least twice as many slots as
+ * there are entries, so probe sequences stay short.
+ */
+typedef struct {
+    ResultCacheEntry* entries; // Entry storage
+    uint32_t capacity;         // Entries allocated
+    uint32_t count;            // Entries in use
+    uint32_t* slots;           // Hash table of entry indices plus one
+    uint32_t slotMask;         // Number of slots minus one
+    uint32_t head;             // Most recently used entry
+    uint32_t tail;             // Least recently used entry
+    ResultCacheStats stats;    // Counters
+} ResultCache;
+
+/*
+ * result_cache_init()
+ * -------------------
+ * Initialises a cache holding up to capacity entries (at least one).
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int result_cache_init(ResultCache* c, size_t capacity)
+{
+    if (capacity == 0 || capacity > (UINT32_MAX >> 2)) {
+        return 1;
+    }
+    size_t slotCount = 1;
+    while (slotCount < capacity * 2) {
+        slotCount <<= 1;
+    }
+    c->entries = (ResultCacheEntry*)calloc(capacity, sizeof(ResultCacheEntry));
+    c->slots = (uint32_t*)calloc(slotCount, sizeof(uint32_t));
+    if (!c->entries || !c->slots) {
+        free(c->entries);
+        free(c->slots);
+        return 1;
+    }
+    c->capacity = (uint32_t)capacity;
+    c->count = 0;
+    c->slotMask = (uint32_t)(slotCount - 1);
+    c->head = RESULT_CACHE_NONE;
+    c->tail = RESULT_CACHE_NONE;
+    memset(&c->stats, 0, sizeof(c->stats));
+    return 0;
+}
+
+/*
+ * result_cache_free()
+ * -------------------
+ * Frees every entry and the table.
+ */
+static inline void result_cache_free(ResultCache* c)
+{
+    for (uint32_t i = 0; i < c->count; i++) {
+        free(c->entries[i].data);
+    }
+    free(c->entries);
+    free(c->slots);
+    c->entries = NULL;
+    c->slots = NULL;
+    c->capacity = 0;
+    c->count = 0;
+}
+
+/*
+ * result_cache_normalize()
+ * ------------------------
+ * Writes the cache key of an expression: letters upper-cased and
+ * whitespace dropped, except for a single space between two characters
+ * that could otherwise run together into one number. Expressions with the
+ * same key tokenize identically.
+ *
+ * expression: The expression (need not be null terminated)
+ * len: Number of characters in expression
+ * key: Receives the key (RESULT_CACHE_MAX_KEY bytes)
+ *
+ * Returns: The length of the key, or 0 if the expression is empty or too
+ *          long to be cached.
+ */
+static inline size_t result_cache_normalize(const char* expression, size_t len, char* key)
+{
+    size_t keyLen = 0;
+    bool pendingSpace = false;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)expression[i];
+        if (isspace(c)) {
+            pendingSpace = keyLen > 0;
+            continue;
+        }
+        if (pendingSpace && isalnum(c) && isalnum((unsigned char)key[keyLen - 1])) {
+            if (keyLen == RESULT_CACHE_MAX_KEY) {
+                return 0;
+            }
+            key[keyLen++] = ' ';
+        }
+        pendingSpace = false;
+        if (keyLen == RESULT_CACHE_MAX_KEY) {
+            return 0;
+        }
+        key[keyLen++] = (char)toupper(c);
+    }
+    return keyLen;
+}
+
+/*
+ * result_cache_hash()
+ * -------------------
+ * Non-cryptographic 64-bit hash of a base and key, taking eight bytes per
+ * multiply and finishing with the SplitMix64 avalanche.
+ */
+static inline uint64_t result_cache_hash(int base, const char* key, size_t len)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ ((uint64_t)base << 56) ^ (uint64_t)len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, key + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, key + i, len - i);
+    h ^= tail;
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static inline void result_cache_unlink(ResultCache* c, uint32_t index)
+{
+    ResultCacheEntry* e = &c->entries[index];
+    if (e->prev != RESULT_CACHE_NONE) {
+        c->entries[e->prev].next = e->next;
+    } else {
+        c->head = e->next;
+    }
+    if (e->next != RESULT_CACHE_NONE) {
+        c->entries[e->next].prev = e->prev;
+    } else {
+        c->tail = e->prev;
+    }
+}
+
+static inline void result_cache_push_front(ResultCache* c, uint32_t index)
+{
+    ResultCacheEntry* e = &c->entries[index];
+    e->prev = RESULT_CACHE_NONE;
+    e->next = c->head;
+    if (c->head != RESULT_CACHE_NONE) {
+        c->entries[c->head].prev = index;
+    } else {
+        c->tail = index;
+    }
+    c->head = index;
+}
+
+/*
+ * result_cache_remove_slot()
+ * --------------------------
+ * Empties the slot holding entry index, shifting later members of its
+ * probe sequence back so that no lookup stops early at the hole.
+ */
+static inline void result_cache_remove_slot(ResultCache* c, uint32_t index)
+{
+    uint32_t hole = (uint32_t)c->entries[index].hash & c->slotMask;
+    while (c->slots[hole] != index + 1) {
+        hole = (hole + 1) & c->slotMask;
+    }
+    uint32_t j = hole;
+    while (1) {
+        j = (j + 1) & c->slotMask;
+        if (!c->slots[j]) {
+            break;
+        }
+        uint32_t home = (uint32_t)c->entries[c->slots[j] - 1].hash & c->slotMask;
+        // Move the entry at j into the hole unless its home lies in (hole, j]
+        bool stays = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            c->slots[hole] = c->slots[j];
+            hole = j;
+        }
+    }
+    c->slots[hole] = 0;
+}
+
+/*
+ * result_cache_lookup()
+ * ---------------------
+ * Finds the entry for a key and marks it most recently used.
+ *
+ * base: Input base of the expression
+ * key, len: Key from result_cache_normalize()
+ * hash: result_cache_hash() of base and key
+ *
+ * Returns: The entry, valid until the next insertion, or NULL on a miss.
+ */
+static inline ResultCacheEntry* result_cache_lookup(ResultCache* c, int base,
+        const char* key, size_t len, uint64_t hash)
+{
+    uint32_t slot = (uint32_t)hash & c->slotMask;
+    while (c->slots[slot]) {
+        uint32_t index = c->slots[slot] - 1;
+        ResultCacheEntry* e = &c->entries[index];
+        if (e->hash == hash && e->base == base && e->keyLen == len &&
+                memcmp(e->data, key, len) == 0) {
+            if (c->head != index) {
+                result_cache_unlink(c, index);
+                result_cache_push_front(c, index);
+            }
+            c->stats.hits++;
+            return e;
+        }
+        slot = (slot + 1) & c->slotMask;
+    }
+    c->stats.misses++;
+    return NULL;
+}
+
+/*
+ * result_cache_reserve()
+ * ----------------------
+ * Makes room for n more bytes of entry data.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int result_cache_reserve(ResultCacheEntry* e, size_t n)
+{
+    if (e->dataCapacity - e->dataLen >= n) {
+        return 0;
+    }
+    size_t capacity = e->dataCapacity ? e->dataCapacity : 64;
+    while (capacity - e->dataLen < n) {
+        capacity *= 2;
+    }
+    char* grown = (char*)realloc(e->data, capacity);
+    if (!grown) {
+        return 1;
+    }
+    e->data = grown;
+    e->dataCapacity = capacity;
+    return 0;
+}
+
+/*
+ * result_cache_insert()
+ * ---------------------
+ * Adds an entry for a key that result_cache_lookup() just missed, with no
+ * digits rendered yet, recycling the least recently used entry when the
+ * cache is full.
+ *
+ * base, key, len, hash: As for result_cache_lookup()
+ * status: 0 if the expression evaluated, otherwise 1 plus why it failed
+ *         (an EvalFailure)
+ * value: The result when status is 0
+ *
+ * Returns: The entry, valid until the next insertion, or NULL on allocation
+ *          failure.
+ */
+static inline ResultCacheEntry* result_cache_insert(ResultCache* c, int base,
+        const char* key, size_t len, uint64_t hash, int status,
+        unsigned long long value)
+{
+    uint32_t index;
+    if (c->count < c->capacity) {
+        index = c->count++;
+    } else {
+        index = c->tail;
+        if (c->entries[index].keyLen > 0) {
+            result_cache_remove_slot(c, index);
+        }
+        result_cache_unlink(c, index);
+        c->stats.evictions++;
+    }
+
+    ResultCacheEntry* e = &c->entries[index];
+    e->dataLen = 0;
+    if (result_cache_reserve(e, len) != 0) {
+        // Keep the entry out of the table, as the next one to recycle
+        e->keyLen = 0;
+        e->prev = c->tail;
+        e->next = RESULT_CACHE_NONE;
+        if (c->tail != RESULT_CACHE_NONE) {
+            c->entries[c->tail].next = index;
+        } else {
+            c->head = index;
+        }
+        c->tail = index;
+        return NULL;
+    }
+    memcpy(e->data, key, len);
+    e->dataLen = len;
+    e->keyLen = len;
+    e->hash = hash;
+    e->base = base;
+    e->status = status;
+    e->value = value;
+    e->renderCount = 0;
+
+    uint32_t slot = (uint32_t)hash & c->slotMask;
+    while (c->slots[slot]) {
+        slot = (slot + 1) & c->slotMask;
+    }
+    c->slots[slot] = index + 1;
+    result_cache_push_front(c, index);
+    return e;
+}
+
+/*
+ * result_cache_add_digits()
+ * -------------------------
+ * Appends the next rendered digit string to an entry.
+ *
+ * Returns: 0 if successful, 1 if the entry is full or out of memory (the
+ *          string is then simply not cached).
+ */
+static inline int result_cache_add_digits(ResultCacheEntry* e, const char* digits, size_t len)
+{
+    if (e->renderCount == RESULT_CACHE_MAX_RENDERS ||
+            e->dataLen + len > UINT16_MAX || result_cache_reserve(e, len) != 0) {
+        return 1;
+    }
+    memcpy(e->data + e->dataLen, digits, len);
+    e->dataLen += len;
+    e->renderEnds[e->renderCount++] = (uint16_t)e->dataLen;
+    return 0;
+}
+
+/*
+ * result_cache_digits()
+ * ---------------------
+ * Returns digit string i of an entry and stores its length in len, or
+ * returns NULL if it has not been rendered.
+ */
+static inline const char* result_cache_digits(const ResultCacheEntry* e, int i, size_t* len)
+{
+    if (i >= e->renderCount) {
+        return NULL;
+    }
+    size_t start = i == 0 ? e->keyLen : e->renderEnds[i - 1];
+    *len = e->renderEnds[i] - start;
+    return e->data + start;
+}
+
+/*
+ * result_cache_stats_add()
+ * ------------------------
+ * Adds the counters of one shard to a running total.
+ */
+static inline void result_cache_stats_add(ResultCacheStats* total, const ResultCacheStats* stats)
+{
+    total->hits += stats->hits;
+    total->misses += stats->misses;
+    total->evictions += stats->evictions;
+}
+
+#endif /* RESULT_CACHE_H */
@@ -0,0 +1,188 @@
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include <semaphore.h>
+
+/*
+ * Bounded multi-producer, multi-consumer queue of pointers, used to hand
+ * batches of work between pipeline stages. Producers and consumers take
+ * tickets with an atomic increment and meet at the ring cell the ticket
+ * names; a sequence number per cell says whose turn it is, so there is
+ * no lock on the fast path. Two counting semaphores, one for free cells
+ * and one for queued items, make a push wait while the queue is full and
+ * a pop wait while it is empty, which gives each stage backpressure
+ * without spinning.
+ */
+
+/*
+ * RingCell
+ * --------
+ * One slot of the ring. A producer holding ticket t may fill the cell when
+ * sequence is t, and a consumer holding ticket t may empty it when
+ * sequence is t + 1.
+ */
+typedef struct {
+    size_t sequence; // Ticket that may use the cell next, as above
+    void* item;      // The queued pointer
+} RingCell;
+
+/*
+ * RingQueue
+ * ---------
+ * The ring, its tickets and its semaphores. The capacity is a power of two
+ * so a ticket maps to its cell with a mask.
+ */
+typedef struct {
+    RingCell* cells;   // The ring
+    size_t mask;       // Number of cells minus one
+    size_t pushTicket; // Next ticket for a producer
+    size_t popTicket;  // Next ticket for a consumer
+    sem_t freeCells;   // Cells no producer has claimed
+    sem_t items;       // Items no consumer has claimed
+} RingQueue;
+
+/*
+ * ring_queue_init()
+ * -----------------
+ * Creates an empty queue holding at least capacity items.
+ *
+ * Returns: false if memory allocation fails, leaving a queue that
+ *          ring_queue_free() accepts
+ */
+static inline bool ring_queue_init(RingQueue* q, size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    q->cells = (RingCell*)malloc(size * sizeof(RingCell));
+    if (!q->cells) {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++) {
+        q->cells[i].sequence = i;
+        q->cells[i].item = NULL;
+    }
+    q->mask = size - 1;
+    q->pushTicket = 0;
+    q->popTicket = 0;
+    sem_init(&q->freeCells, 0, (unsigned)size);
+    sem_init(&q->items, 0, 0);
+    return true;
+}
+
+/*
+ * ring_queue_free()
+ * -----------------
+ * Releases a queue that no thread is using any more.
+ */
+static inline void ring_queue_free(RingQueue* q)
+{
+    if (!q->cells) {
+        return;
+    }
+    sem_destroy(&q->freeCells);
+    sem_destroy(&q->items);
+    free(q->cells);
+    q->cells = NULL;
+}
+
+/*
+ * ring_queue_wait()
+ * -----------------
+ * Takes one unit of a semaphore, waiting for it unless nowait is set.
+ *
+ * Returns: false if nowait is set and the semaphore was zero
+ */
+static inline bool ring_queue_wait(sem_t* sem, bool nowait)
+{
+    while ((nowait ? sem_trywait(sem) : sem_wait(sem)) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * ring_queue_turn()
+ * -----------------
+ * Waits until a cell's sequence reaches ticket. The semaphores guarantee
+ * the cell is about to be ready; it only lags when the thread with the
+ * previous turn was preempted between claiming and finishing it.
+ */
+static inline void ring_queue_turn(const RingCell* cell, size_t ticket)
+{
+    while (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != ticket) {
+        sched_yield();
+    }
+}
+
+/*
+ * ring_queue_push()
+ * -----------------
+ * Appends item, waiting while the queue is full.
+ */
+static inline void ring_queue_push(RingQueue* q, void* item)
+{
+    ring_queue_wait(&q->freeCells, false);
+    size_t ticket = __atomic_fetch_add(&q->pushTicket, 1, __ATOMIC_RELAXED);
+    RingCell* cell = &q->cells[ticket & q->mask];
+    ring_queue_turn(cell, ticket);
+    cell->item = item;
+    __atomic_store_n(&cell->sequence, ticket + 1, __ATOMIC_RELEASE);
+    sem_post(&q->items);
+}
+
+/*
+ * ring_queue_take()
+ * -----------------
+ * Removes the oldest item, waiting while the queue is empty unless nowait
+ * is set.
+ *
+ * Returns: false if nowait is set and the queue was empty
+ */
+static inline bool ring_queue_take(RingQueue* q, void** item, bool nowait)
+{
+    if (!ring_queue_wait(&q->items, nowait)) {
+        return false;
+    }
+    size_t ticket = __atomic_fetch_add(&q->popTicket, 1, __ATOMIC_RELAXED);
+    RingCell* cell = &q->cells[ticket & q->mask];
+    ring_queue_turn(cell, ticket + 1);
+    *item = cell->item;
+    __atomic_store_n(&cell->sequence, ticket + q->mask + 1, __ATOMIC_RELEASE);
+    sem_post(&q->freeCells);
+    return true;
+}
+
+/*
+ * ring_queue_pop()
+ * ----------------
+ * Returns: The oldest item, waiting while the queue is empty.
+ */
+static inline void* ring_queue_pop(RingQueue* q)
+{
+    void* item = NULL;
+    ring_queue_take(q, &item, false);
+    return item;
+}
+
+/*
+ * ring_queue_try_pop()
+ * --------------------
+ * Removes the oldest item if there is one.
+ *
+ * Returns: false if the queue was empty
+ */
+static inline bool ring_queue_try_pop(RingQueue* q, void** item)
+{
+    return ring_queue_take(q, item, true);
+}
+
+#endif /* RING_QUEUE_H */
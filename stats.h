@@ -0,0 +1,360 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "arena.h"
+
+/*
+ * Hot path instrumentation behind --stats. It is only compiled in when
+ * building with -DUJB_STATS (make STATS=1); otherwise every macro below
+ * expands to nothing, Stats is an empty shell and the functions are empty,
+ * so the evaluators carry no trace of it.
+ *
+ * Each thread that evaluates expressions owns a Stats and attaches it with
+ * stats_attach(), so counters and histograms are updated without atomics;
+ * the owner sums them with stats_add() once the thread is done. Nothing is
+ * recorded on a thread without an attached Stats, which is the default.
+ */
+
+/*
+ * EvalFailure
+ * -----------
+ * Why an expression was rejected. The evaluators still return 1 for any
+ * failure; EVAL_FAIL() notes the reason on the way out. The last three are
+ * also found by expression_precheck() before anything is parsed.
+ */
+typedef enum {
+    EVAL_FAILURE_CONVERSION,     // A literal or the syntax could not be read
+    EVAL_FAILURE_DIVIDE_BY_ZERO, // Division, modulo or 0 to a negative power
+    EVAL_FAILURE_OUT_OF_RANGE,   // Negative, or too large for the precision
+    EVAL_FAILURE_CHARACTER,      // Neither a digit of the base, an operator nor space
+    EVAL_FAILURE_PARENTHESES,    // Parentheses that do not pair up
+    EVAL_FAILURE_EMPTY,          // Nothing but whitespace
+    EVAL_FAILURES
+} EvalFailure;
+
+/*
+ * StatsStage
+ * ----------
+ * The stages an expression passes through, each with its own histogram.
+ */
+typedef enum {
+    STATS_READ,     // Reading a line, chunk or request from the input
+    STATS_TOKENIZE, // Splitting an expression into tokens
+    STATS_EVALUATE, // Compiling and evaluating the tokens
+    STATS_FORMAT,   // Rendering digits, one sample per base or all-bases pass
+    STATS_WRITE,    // Writing buffered output
+    STATS_STAGES
+} StatsStage;
+
+#ifdef UJB_STATS
+
+#include <time.h>
+
+#define STATS_SUB_BUCKETS 4                   // Histogram buckets per power of two
+#define STATS_BUCKETS (64 * STATS_SUB_BUCKETS) // Covers every uint64_t nanosecond count
+
+/*
+ * StatsHistogram
+ * --------------
+ * Log-linear latency histogram: every power of two of nanoseconds is split
+ * into STATS_SUB_BUCKETS equal buckets, so a percentile read from the
+ * middle of its bucket is within 12.5% of the true value. Percentiles are
+ * capped at the largest sample, so a stage with a single sample reports
+ * that sample rather than the middle of its bucket.
+ */
+typedef struct {
+    uint64_t count;                   // Samples recorded
+    uint64_t totalNs;                 // Sum of every sample
+    uint64_t maxNs;                   // Largest sample
+    uint64_t buckets[STATS_BUCKETS];  // Samples per bucket
+} StatsHistogram;
+
+/*
+ * Stats
+ * -----
+ * Counters and stage histograms of one thread, or the sum of several.
+ */
+typedef struct {
+    StatsHistogram stages[STATS_STAGES]; // Latency of each stage
+    uint64_t expressions;                // Expressions evaluated or looked up
+    uint64_t cacheHits;                  // Expressions answered by the cache
+    uint64_t rejections[EVAL_FAILURES];  // Rejected expressions by reason
+    ArenaStats arena;                    // Scratch arena counters
+} Stats;
+
+static __thread Stats* statsThread;     // Stats of the calling thread, or NULL
+static __thread EvalFailure evalFailure; // Reason for the latest failure
+
+/* Returns 1 after noting why the current expression failed */
+#define EVAL_FAIL(reason) (evalFailure = (reason), 1)
+/* Forgets the reason for the previous failure; unknown reasons are conversions */
+#define EVAL_FAIL_RESET() (evalFailure = EVAL_FAILURE_CONVERSION)
+/* Declares name holding the time a stage starts at */
+#define STATS_CLOCK(name) uint64_t name = stats_clock()
+/* Records the time since name for stage, and restarts name for the next stage */
+#define STATS_LAP(stage, name) stats_lap((stage), &(name))
+/* Restarts name without recording anything */
+#define STATS_RESTART(name) ((name) = stats_clock())
+/* Adds one to a counter of the calling thread's Stats */
+#define STATS_COUNT(counter) \
+    do { if (statsThread) { statsThread->counter++; } } while (0)
+
+/*
+ * stats_clock()
+ * -------------
+ * Returns: Monotonic nanoseconds, or 0 when nothing is being recorded.
+ */
+static inline uint64_t stats_clock(void)
+{
+    if (!statsThread) {
+        return 0;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/*
+ * stats_bucket()
+ * --------------
+ * Returns: The histogram bucket of a sample of ns nanoseconds.
+ */
+static inline size_t stats_bucket(uint64_t ns)
+{
+    if (ns < STATS_SUB_BUCKETS) {
+        return (size_t)ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    size_t sub = (size_t)(ns >> (exponent - 2)) & (STATS_SUB_BUCKETS - 1);
+    return (size_t)(exponent - 1) * STATS_SUB_BUCKETS + sub;
+}
+
+/*
+ * stats_bucket_middle()
+ * ---------------------
+ * Returns: The sample in the middle of the given bucket.
+ */
+static inline uint64_t stats_bucket_middle(size_t bucket)
+{
+    if (bucket < STATS_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = (int)(bucket / STATS_SUB_BUCKETS) - 1;
+    uint64_t sub = bucket % STATS_SUB_BUCKETS;
+    return ((STATS_SUB_BUCKETS + sub) << shift) + ((uint64_t)1 << shift) / 2;
+}
+
+/*
+ * stats_lap()
+ * -----------
+ * Records the time since *since as a sample of stage, then moves *since on
+ * to now so that consecutive stages can share one clock.
+ */
+static inline void stats_lap(StatsStage stage, uint64_t* since)
+{
+    if (!statsThread) {
+        return;
+    }
+    uint64_t now = stats_clock();
+    uint64_t ns = now - *since;
+    StatsHistogram* h = &statsThread->stages[stage];
+    h->count++;
+    h->totalNs += ns;
+    if (ns > h->maxNs) {
+        h->maxNs = ns;
+    }
+    h->buckets[stats_bucket(ns)]++;
+    *since = now;
+}
+
+/*
+ * stats_init()
+ * ------------
+ * Zeroes every counter and histogram.
+ */
+static inline void stats_init(Stats* s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+/*
+ * stats_attach()
+ * --------------
+ * Makes s the Stats of the calling thread, or stops recording if s is NULL.
+ */
+static inline void stats_attach(Stats* s)
+{
+    statsThread = s;
+}
+
+/*
+ * stats_reject()
+ * --------------
+ * Counts a rejected expression on the calling thread.
+ */
+static inline void stats_reject(EvalFailure reason)
+{
+    if (statsThread) {
+        statsThread->rejections[reason]++;
+    }
+}
+
+/*
+ * eval_failure()
+ * --------------
+ * Returns: Why the latest expression evaluated on this thread failed.
+ */
+static inline EvalFailure eval_failure(void)
+{
+    return evalFailure;
+}
+
+/*
+ * stats_count_arena()
+ * -------------------
+ * Adds the counters of a scratch arena that is done.
+ */
+static inline void stats_count_arena(Stats* s, const ArenaStats* arena)
+{
+    arena_stats_add(&s->arena, arena);
+}
+
+/*
+ * stats_add()
+ * -----------
+ * Adds every counter and histogram of s to total.
+ */
+static inline void stats_add(Stats* total, const Stats* s)
+{
+    for (int stage = 0; stage < STATS_STAGES; stage++) {
+        StatsHistogram* to = &total->stages[stage];
+        const StatsHistogram* from = &s->stages[stage];
+        to->count += from->count;
+        to->totalNs += from->totalNs;
+        if (from->maxNs > to->maxNs) {
+            to->maxNs = from->maxNs;
+        }
+        for (size_t i = 0; i < STATS_BUCKETS; i++) {
+            to->buckets[i] += from->buckets[i];
+        }
+    }
+    total->expressions += s->expressions;
+    total->cacheHits += s->cacheHits;
+    for (int reason = 0; reason < EVAL_FAILURES; reason++) {
+        total->rejections[reason] += s->rejections[reason];
+    }
+    arena_stats_add(&total->arena, &s->arena);
+}
+
+/*
+ * stats_percentile()
+ * ------------------
+ * Returns: The middle of the bucket holding the given fraction of the
+ *          samples of h, but no more than its largest sample, or 0 if it
+ *          has none.
+ */
+static inline uint64_t stats_percentile(const StatsHistogram* h, double fraction)
+{
+    uint64_t rank = (uint64_t)(fraction * (double)h->count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < STATS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            uint64_t middle = stats_bucket_middle(i);
+            return middle < h->maxNs ? middle : h->maxNs;
+        }
+    }
+    return 0;
+}
+
+/*
+ * stats_format_ns()
+ * -----------------
+ * Writes a duration with a unit that keeps it short, e.g. "850ns" or "1.2ms".
+ */
+static inline void stats_format_ns(char* text, size_t size, uint64_t ns)
+{
+    static const char* const units[] = {"ns", "us", "ms", "s"};
+    double value = (double)ns;
+    size_t unit = 0;
+    while (value >= 1000.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1000.0;
+        unit++;
+    }
+    snprintf(text, size, unit ? "%.1f%s" : "%.0f%s", value, units[unit]);
+}
+
+/*
+ * stats_report()
+ * --------------
+ * Prints the counters and the p50/p99 latency of every stage to stream.
+ * A stage without samples, such as reading typed input, shows n/a.
+ */
+static inline void stats_report(const Stats* s, FILE* stream)
+{
+    static const char* const stageNames[STATS_STAGES] = {
+        "read", "tokenize", "evaluate", "format", "write"
+    };
+    uint64_t rejected = 0;
+    for (int reason = 0; reason < EVAL_FAILURES; reason++) {
+        rejected += s->rejections[reason];
+    }
+    fprintf(stream, "Stats: %llu expressions, %llu cache hits\n",
+            (unsigned long long)s->expressions, (unsigned long long)s->cacheHits);
+    fprintf(stream, "Stats: arena: %zu allocations, %zu heap allocations, %zu resets, "
+            "%zu bytes reserved\n",
+            s->arena.allocations, s->arena.heapAllocations, s->arena.resets,
+            s->arena.reservedBytes);
+    fprintf(stream, "Stats: %llu rejected: %llu conversion, %llu divide by zero, "
+            "%llu out of range, %llu bad character, %llu unbalanced, %llu empty\n",
+            (unsigned long long)rejected,
+            (unsigned long long)s->rejections[EVAL_FAILURE_CONVERSION],
+            (unsigned long long)s->rejections[EVAL_FAILURE_DIVIDE_BY_ZERO],
+            (unsigned long long)s->rejections[EVAL_FAILURE_OUT_OF_RANGE],
+            (unsigned long long)s->rejections[EVAL_FAILURE_CHARACTER],
+            (unsigned long long)s->rejections[EVAL_FAILURE_PARENTHESES],
+            (unsigned long long)s->rejections[EVAL_FAILURE_EMPTY]);
+    for (int stage = 0; stage < STATS_STAGES; stage++) {
+        const StatsHistogram* h = &s->stages[stage];
+        char p50[16] = "n/a", p99[16] = "n/a", total[16] = "n/a";
+        if (h->count) {
+            stats_format_ns(p50, sizeof(p50), stats_percentile(h, 0.50));
+            stats_format_ns(p99, sizeof(p99), stats_percentile(h, 0.99));
+            stats_format_ns(total, sizeof(total), h->totalNs);
+        }
+        fprintf(stream, "Stats: %-8s %12llu samples  p50 %8s  p99 %8s  total %8s\n",
+                stageNames[stage], (unsigned long long)h->count, p50, p99, total);
+    }
+}
+
+#else
+
+typedef struct {
+    char unused; // Nothing is recorded without UJB_STATS
+} Stats;
+
+#define EVAL_FAIL(reason) 1
+#define EVAL_FAIL_RESET() ((void)0)
+#define STATS_CLOCK(name)
+#define STATS_LAP(stage, name) ((void)0)
+#define STATS_RESTART(name) ((void)0)
+#define STATS_COUNT(counter) ((void)0)
+
+static inline void stats_init(Stats* s) { (void)s; }
+static inline void stats_attach(Stats* s) { (void)s; }
+static inline void stats_reject(EvalFailure reason) { (void)reason; }
+static inline EvalFailure eval_failure(void) { return EVAL_FAILURE_CONVERSION; }
+static inline void stats_count_arena(Stats* s, const ArenaStats* arena)
+{
+    (void)s;
+    (void)arena;
+}
+static inline void stats_add(Stats* total, const Stats* s) { (void)total; (void)s; }
+static inline void stats_report(const Stats* s, FILE* stream) { (void)s; (void)stream; }
+
+#endif /* UJB_STATS */
+
+#endif /* STATS_H */
@@ -0,0 +1,756 @@
+#ifndef UJB_ENGINE_H
+#define UJB_ENGINE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "uqbasejump.h"
+#include "batch.h"
+#include "history.h"
+
+/*
+ * Embeddable calculator engine. A ujb_engine holds everything the command
+ * line program keeps in its Config: the input base, the output bases, the
+ * precision and the history, together with the arenas that back every
+ * string it returns. Engines share no mutable state, so any number of
+ * threads can evaluate at the same time as long as each uses its own
+ * engine.
+ *
+ * Strings handed out in a ujb_result live in the engine's scratch arena
+ * and stay valid until the next evaluate, format or run call on the same
+ * engine. The history keeps the newest UJB_DEFAULT_HISTORY_ENTRIES
+ * evaluations (see ujb_engine_set_history_size()) in the same bounded ring
+ * as the interactive calculator; an entry's strings stay valid until it is
+ * replaced, the history is cleared or resized, or the engine is
+ * destroyed.
+ *
+ * An expression evaluated many times with different literals can be
+ * compiled once into a ujb_program with ujb_engine_compile(), given new
+ * literals with ujb_program_rebind() and run with ujb_engine_run(), which
+ * skips parsing altogether.
+ *
+ * C++ code can use the ujb::Engine and ujb::Program wrappers at the end of
+ * this file.
+ */
+
+#define UJB_MAX_OUTPUT_BASES 35 // One output base per supported base
+#define UJB_DEFAULT_HISTORY_ENTRIES 1000 // Evaluations a history keeps
+
+/*
+ * ujb_digits
+ * ----------
+ * A number written out in one base.
+ */
+typedef struct {
+    int base;           // The base of the digits (2-36)
+    const char* digits; // Null terminated digits, owned by the engine
+    size_t length;      // Number of characters in digits
+} ujb_digits;
+
+/*
+ * ujb_result
+ * ----------
+ * Outcome of one evaluation: the result in the input base and in every
+ * output base, in the order the output bases were set.
+ */
+typedef struct {
+    int status;              // 0 if successful, 1 if it could not be evaluated
+    ujb_digits value;        // The result in the input base
+    const ujb_digits* bases; // The result in each output base
+    size_t baseCount;        // Number of entries in bases
+} ujb_result;
+
+/*
+ * ujb_history_entry
+ * -----------------
+ * One successfully evaluated expression: expression (with expressionLen),
+ * the input base it was written in, and result (with resultLen) in the
+ * same base.
+ */
+typedef HistoryEntry ujb_history_entry;
+
+/*
+ * ujb_program
+ * -----------
+ * An expression compiled with rebindable literals. The code lives on the
+ * heap, so a program outlives every call on the engine that compiled it
+ * and can be run by any engine. Initialise it with ujb_program_init() and
+ * release it with ujb_program_free().
+ */
+typedef struct {
+    ExprProgram code; // Bytecode with one slot per literal
+    int inputBase;    // Base the literals are written in
+} ujb_program;
+
+/*
+ * ujb_engine
+ * ----------
+ * Settings and state of one calculator instance. Use the functions below
+ * rather than touching the fields directly.
+ */
+typedef struct {
+    int inputBase;                         // Base expressions are written in
+    int outputBases[UJB_MAX_OUTPUT_BASES]; // Bases results are shown in
+    size_t outputBaseCount;                // Number of output bases
+    Precision precision;                   // Arithmetic used to evaluate
+    bool recordHistory;                    // Whether evaluations are recorded
+    HistoryRing history;                   // The newest recorded evaluations
+    Arena scratch;                         // Strings of the latest results
+} ujb_engine;
+
+/*
+ * ujb_engine_create()
+ * -------------------
+ * Creates an engine with the command line defaults: input base 10, output
+ * bases 2, 10 and 16 and double precision. History recording starts off,
+ * so an engine that is never asked for its history keeps no memory per
+ * call; turn it on with ujb_engine_set_history().
+ *
+ * Returns: The new engine, or NULL on allocation failure. It must be
+ *          released with ujb_engine_destroy().
+ */
+static inline ujb_engine* ujb_engine_create(void)
+{
+    ujb_engine* e = (ujb_engine*)malloc(sizeof(ujb_engine));
+    if (!e) {
+        return NULL;
+    }
+
+    e->inputBase = 10;
+    e->outputBases[0] = 2;
+    e->outputBases[1] = 10;
+    e->outputBases[2] = 16;
+    e->outputBaseCount = 3;
+    e->precision = PRECISION_DOUBLE;
+    e->recordHistory = false;
+    history_ring_init(&e->history, UJB_DEFAULT_HISTORY_ENTRIES);
+    arena_init(&e->scratch);
+    return e;
+}
+
+/*
+ * ujb_engine_destroy()
+ * --------------------
+ * Releases an engine and every string it handed out. e may be NULL.
+ */
+static inline void ujb_engine_destroy(ujb_engine* e)
+{
+    if (!e) {
+        return;
+    }
+    history_ring_free(&e->history);
+    arena_free(&e->scratch);
+    free(e);
+}
+
+/*
+ * ujb_engine_set_input_base()
+ * ---------------------------
+ * Sets the base expressions are written in.
+ *
+ * Returns: 0 if successful, 1 if base is not in 2-36.
+ */
+static inline int ujb_engine_set_input_base(ujb_engine* e, int base)
+{
+    if (base < 2 || base > 36) {
+        return 1;
+    }
+    e->inputBase = base;
+    return 0;
+}
+
+/*
+ * ujb_engine_set_output_bases()
+ * -----------------------------
+ * Sets the bases every result is shown in, in display order.
+ *
+ * bases: The output bases (2-36, each at most once)
+ * count: Number of entries in bases (1 to UJB_MAX_OUTPUT_BASES)
+ *
+ * Returns: 0 if successful, 1 if the list is empty, too long, or holds an
+ *          invalid or repeated base (the old bases are then kept).
+ */
+static inline int ujb_engine_set_output_bases(ujb_engine* e, const int* bases, size_t count)
+{
+    if (!bases || count == 0 || count > UJB_MAX_OUTPUT_BASES) {
+        return 1;
+    }
+
+    bool seen[37] = {false};
+    for (size_t i = 0; i < count; i++) {
+        if (bases[i] < 2 || bases[i] > 36 || seen[bases[i]]) {
+            return 1;
+        }
+        seen[bases[i]] = true;
+    }
+
+    memcpy(e->outputBases, bases, count * sizeof(int));
+    e->outputBaseCount = count;
+    return 0;
+}
+
+/*
+ * ujb_engine_set_precision()
+ * --------------------------
+ * Chooses between double arithmetic (results below 2^53), checked 64-bit
+ * integers that fall back to arbitrary precision on overflow, and
+ * arbitrary precision integers.
+ *
+ * Returns: 0 if successful, 1 if precision is not PRECISION_DOUBLE,
+ *          PRECISION_INT or PRECISION_BIG (the old precision is then kept).
+ */
+static inline int ujb_engine_set_precision(ujb_engine* e, Precision precision)
+{
+    if (precision != PRECISION_DOUBLE && precision != PRECISION_INT &&
+            precision != PRECISION_BIG) {
+        return 1;
+    }
+    e->precision = precision;
+    return 0;
+}
+
+/*
+ * ujb_engine_set_history()
+ * ------------------------
+ * Turns recording of evaluated expressions on or off. Recording is off
+ * when an engine is created.
+ */
+static inline void ujb_engine_set_history(ujb_engine* e, bool record)
+{
+    e->recordHistory = record;
+}
+
+/*
+ * ujb_engine_set_history_size()
+ * -----------------------------
+ * Sets how many of the newest evaluations the history keeps, replacing
+ * the oldest once it is full. Shrinking the history drops its oldest
+ * entries.
+ *
+ * Returns: 0 if successful, 1 if entries is 0 or on allocation failure
+ *          (the old size is then kept).
+ */
+static inline int ujb_engine_set_history_size(ujb_engine* e, size_t entries)
+{
+    if (entries == 0 || entries > SIZE_MAX / sizeof(ujb_history_entry)) {
+        return 1;
+    }
+    return history_ring_resize(&e->history, entries) ? 0 : 1;
+}
+
+/*
+ * ujb_engine_history_count()
+ * --------------------------
+ * Returns the number of recorded evaluations.
+ */
+static inline size_t ujb_engine_history_count(const ujb_engine* e)
+{
+    return e->history.count;
+}
+
+/*
+ * ujb_engine_history_entry()
+ * --------------------------
+ * Returns recorded evaluation number i (0 is the oldest), or NULL if there
+ * is no such entry.
+ */
+static inline const ujb_history_entry* ujb_engine_history_entry(const ujb_engine* e, size_t i)
+{
+    return history_ring_entry(&e->history, i);
+}
+
+/*
+ * ujb_engine_clear_history()
+ * --------------------------
+ * Forgets every recorded evaluation, keeping the memory for reuse.
+ */
+static inline void ujb_engine_clear_history(ujb_engine* e)
+{
+    history_ring_clear(&e->history);
+}
+
+/*
+ * ujb_engine_record()
+ * -------------------
+ * Appends an evaluation to the history, replacing the oldest entry once
+ * the history is full.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int ujb_engine_record(ujb_engine* e, const char* expression, size_t len,
+        const ujb_digits* value)
+{
+    return history_ring_push(&e->history, expression, len, value->base, value->digits,
+            value->length) ? 0 : 1;
+}
+
+/*
+ * ujb_engine_format_u64()
+ * -----------------------
+ * Writes value in the input base and every output base into the scratch
+ * arena, without resetting it first. All of the bases are rendered in one
+ * pass by format_all_bases() and share a single allocation.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int ujb_engine_format_u64(ujb_engine* e, unsigned long long value,
+        ujb_result* result)
+{
+    ujb_digits* bases = (ujb_digits*)arena_alloc(&e->scratch,
+            e->outputBaseCount * sizeof(ujb_digits));
+    if (!bases) {
+        return 1;
+    }
+
+    // The input base goes last, after the output bases
+    int order[UJB_MAX_OUTPUT_BASES + 1];
+    size_t ends[UJB_MAX_OUTPUT_BASES + 1];
+    char block[(UJB_MAX_OUTPUT_BASES + 1) * FORMAT_DIGITS_BYTES];
+    size_t count = e->outputBaseCount + 1;
+    memcpy(order, e->outputBases, e->outputBaseCount * sizeof(int));
+    order[e->outputBaseCount] = e->inputBase;
+    size_t used = format_all_bases(value, order, count, block, ends);
+
+    // One terminator after every digit string
+    char* digits = (char*)arena_alloc(&e->scratch, used + count);
+    if (!digits) {
+        return 1;
+    }
+    size_t from = 0;
+    for (size_t i = 0; i < count; i++) {
+        ujb_digits* d = i < e->outputBaseCount ? &bases[i] : &result->value;
+        d->base = order[i];
+        d->length = ends[i] - from;
+        memcpy(digits, block + from, d->length);
+        digits[d->length] = '\0';
+        d->digits = digits;
+        digits += d->length + 1;
+        from = ends[i];
+    }
+
+    result->bases = bases;
+    result->baseCount = e->outputBaseCount;
+    return 0;
+}
+
+/*
+ * ujb_engine_format_big()
+ * -----------------------
+ * Arbitrary-precision counterpart of ujb_engine_format_u64().
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int ujb_engine_format_big(ujb_engine* e, const BigInt* value,
+        ujb_result* result)
+{
+    ujb_digits* bases = (ujb_digits*)arena_alloc(&e->scratch,
+            e->outputBaseCount * sizeof(ujb_digits));
+    if (!bases) {
+        return 1;
+    }
+
+    for (size_t i = 0; i <= e->outputBaseCount; i++) {
+        ujb_digits* d = i < e->outputBaseCount ? &bases[i] : &result->value;
+        d->base = i < e->outputBaseCount ? e->outputBases[i] : e->inputBase;
+        char* digits = bigint_to_str_arena(&e->scratch, value, d->base);
+        if (!digits) {
+            return 1;
+        }
+        d->digits = digits;
+        d->length = strlen(digits);
+    }
+
+    result->bases = bases;
+    result->baseCount = e->outputBaseCount;
+    return 0;
+}
+
+/*
+ * ujb_engine_evaluate_into()
+ * --------------------------
+ * Evaluates one expression and formats its result into the scratch arena,
+ * without resetting it first, and records it in the history.
+ *
+ * Returns: result->status.
+ */
+static inline int ujb_engine_evaluate_into(ujb_engine* e, const char* expression,
+        size_t len, ujb_result* result)
+{
+    memset(result, 0, sizeof(*result));
+    int status;
+
+    if (e->precision == PRECISION_BIG) {
+        BigInt value;
+        bigint_init(&value);
+        status = evaluate_expression_big_arena(&e->scratch, expression, len, e->inputBase, &value);
+        if (status == 0) {
+            status = ujb_engine_format_big(e, &value, result);
+        }
+        bigint_free(&value);
+    } else if (e->precision == PRECISION_INT) {
+        BigInt wide;
+        bigint_init(&wide);
+        unsigned long long value;
+        status = evaluate_expression_int_arena(&e->scratch, expression, len, e->inputBase,
+                &value, &wide);
+        if (status == 0) {
+            status = ujb_engine_format_u64(e, value, result);
+        } else if (status == EVAL_WIDE) {
+            status = ujb_engine_format_big(e, &wide, result);
+        }
+        bigint_free(&wide);
+    } else {
+        unsigned long long value;
+        status = evaluate_expression_in_base_arena(&e->scratch, expression, len, e->inputBase,
+                &value);
+        if (status == 0) {
+            status = ujb_engine_format_u64(e, value, result);
+        }
+    }
+
+    if (status == 0 && e->recordHistory) {
+        status = ujb_engine_record(e, expression, len, &result->value);
+    }
+    if (status != 0) {
+        memset(result, 0, sizeof(*result));
+        result->status = 1;
+    }
+    return result->status;
+}
+
+/*
+ * ujb_engine_evaluate()
+ * ---------------------
+ * Evaluates an expression written in the input base and formats the
+ * result in the input base and every output base.
+ *
+ * e: The engine
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * result: Receives the result (strings valid until the next call on e)
+ *
+ * Returns: 0 if successful, 1 if the expression could not be evaluated
+ *          or on allocation failure.
+ */
+static inline int ujb_engine_evaluate(ujb_engine* e, const char* expression, size_t len,
+        ujb_result* result)
+{
+    if (!e || !expression || !result) {
+        return 1;
+    }
+    arena_reset(&e->scratch);
+    return ujb_engine_evaluate_into(e, expression, len, result);
+}
+
+/*
+ * ujb_engine_evaluate_batch()
+ * ---------------------------
+ * Evaluates several expressions in order. Every result stays valid until
+ * the next call on e, so the whole batch can be read at once.
+ *
+ * e: The engine
+ * expressions: The expressions
+ * lengths: Length of each expression, or NULL if they are null terminated
+ * count: Number of expressions
+ * results: Array of count entries to receive the results
+ *
+ * Returns: The number of expressions evaluated successfully; look at each
+ *          result's status to find the ones that failed.
+ */
+static inline size_t ujb_engine_evaluate_batch(ujb_engine* e, const char* const* expressions,
+        const size_t* lengths, size_t count, ujb_result* results)
+{
+    if (!e || !expressions || !results) {
+        return 0;
+    }
+    arena_reset(&e->scratch);
+
+    size_t successes = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!expressions[i]) {
+            memset(&results[i], 0, sizeof(results[i]));
+            results[i].status = 1;
+            continue;
+        }
+        size_t len = lengths ? lengths[i] : strlen(expressions[i]);
+        if (ujb_engine_evaluate_into(e, expressions[i], len, &results[i]) == 0) {
+            successes++;
+        }
+    }
+    return successes;
+}
+
+/*
+ * ujb_engine_format_all_bases()
+ * -----------------------------
+ * Formats a value in the input base and every output base, as the
+ * interactive calculator does for the literal being typed. Nothing is
+ * added to the history.
+ *
+ * Returns: 0 if successful, 1 on allocation failure.
+ */
+static inline int ujb_engine_format_all_bases(ujb_engine* e, unsigned long long value,
+        ujb_result* result)
+{
+    if (!e || !result) {
+        return 1;
+    }
+    arena_reset(&e->scratch);
+    memset(result, 0, sizeof(*result));
+    if (ujb_engine_format_u64(e, value, result) != 0) {
+        memset(result, 0, sizeof(*result));
+        result->status = 1;
+    }
+    return result->status;
+}
+
+/*
+ * ujb_program_init()
+ * ------------------
+ * Initialises an empty program.
+ */
+static inline void ujb_program_init(ujb_program* program)
+{
+    expr_program_init(&program->code);
+    program->inputBase = 10;
+}
+
+/*
+ * ujb_program_free()
+ * ------------------
+ * Releases the code of a program and leaves it empty.
+ */
+static inline void ujb_program_free(ujb_program* program)
+{
+    expr_program_free(&program->code);
+}
+
+/*
+ * ujb_engine_compile()
+ * --------------------
+ * Compiles an expression written in the input base into a program whose
+ * literals can be replaced by ujb_program_rebind(). Programs run in double
+ * precision whatever the engine's precision.
+ *
+ * e: The engine
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * program: Initialised program to receive the code (any old code is freed)
+ *
+ * Returns: 0 if successful, 1 if the expression is malformed, a constant
+ *          subexpression divides by zero, or on allocation failure.
+ */
+static inline int ujb_engine_compile(ujb_engine* e, const char* expression, size_t len,
+        ujb_program* program)
+{
+    if (!e || !expression || !program) {
+        return 1;
+    }
+    program->inputBase = e->inputBase;
+    return compile_expression(expression, len, e->inputBase, true, &program->code);
+}
+
+/*
+ * ujb_program_rebind()
+ * --------------------
+ * Binds the literals of a new expression to a compiled program. The
+ * expression must be written in the base the program was compiled in and
+ * have the same shape: the same operators and parentheses in the same
+ * order, with only the literals changed.
+ *
+ * Returns: 0 if successful, 1 if the program is empty, the expression
+ *          could not be converted, or its shape differs (the old literals
+ *          are then kept).
+ */
+static inline int ujb_program_rebind(ujb_program* program, const char* expression, size_t len)
+{
+    if (!program || !expression) {
+        return 1;
+    }
+    return rebind_expr_program(&program->code, expression, len, program->inputBase);
+}
+
+/*
+ * ujb_engine_run()
+ * ----------------
+ * Runs a program with its current literals and formats the result in the
+ * input base and every output base, as ujb_engine_evaluate() does. Nothing
+ * is added to the history, since the program does not keep the text of
+ * its expression.
+ *
+ * Returns: 0 if successful, 1 if the program is empty, divides by zero,
+ *          its result is out of range, or on allocation failure.
+ */
+static inline int ujb_engine_run(ujb_engine* e, const ujb_program* program,
+        ujb_result* result)
+{
+    if (!e || !program || !result) {
+        return 1;
+    }
+    arena_reset(&e->scratch);
+    memset(result, 0, sizeof(*result));
+    unsigned long long value;
+    if (run_expr_program(&program->code, NULL, &value) != 0 ||
+            ujb_engine_format_u64(e, value, result) != 0) {
+        memset(result, 0, sizeof(*result));
+        result->status = 1;
+    }
+    return result->status;
+}
+
+#ifdef __cplusplus
+#include <new>
+#include <string>
+#include <vector>
+
+namespace ujb {
+
+/*
+ * Program
+ * -------
+ * Owning C++ wrapper around a ujb_program.
+ */
+class Program {
+public:
+    Program() { ujb_program_init(&program_); }
+
+    ~Program() { ujb_program_free(&program_); }
+
+    Program(Program&& other) noexcept : program_(other.program_)
+    {
+        ujb_program_init(&other.program_);
+    }
+
+    Program& operator=(Program&& other) noexcept
+    {
+        if (this != &other) {
+            ujb_program_free(&program_);
+            program_ = other.program_;
+            ujb_program_init(&other.program_);
+        }
+        return *this;
+    }
+
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    bool rebind(const std::string& expression)
+    {
+        return ujb_program_rebind(&program_, expression.data(), expression.size()) == 0;
+    }
+
+    ujb_program* get() { return &program_; }
+    const ujb_program* get() const { return &program_; }
+
+private:
+    ujb_program program_;
+};
+
+/*
+ * Engine
+ * ------
+ * Owning C++ wrapper around a ujb_engine. Like the C engine it may be used
+ * from one thread at a time; give each thread its own Engine.
+ */
+class Engine {
+public:
+    Engine() : engine_(ujb_engine_create())
+    {
+        if (!engine_) {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~Engine() { ujb_engine_destroy(engine_); }
+
+    Engine(Engine&& other) noexcept : engine_(other.engine_) { other.engine_ = nullptr; }
+
+    Engine& operator=(Engine&& other) noexcept
+    {
+        if (this != &other) {
+            ujb_engine_destroy(engine_);
+            engine_ = other.engine_;
+            other.engine_ = nullptr;
+        }
+        return *this;
+    }
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    bool setInputBase(int base) { return ujb_engine_set_input_base(engine_, base) == 0; }
+
+    bool setOutputBases(const std::vector<int>& bases)
+    {
+        return ujb_engine_set_output_bases(engine_, bases.data(), bases.size()) == 0;
+    }
+
+    bool setPrecision(Precision precision)
+    {
+        return ujb_engine_set_precision(engine_, precision) == 0;
+    }
+
+    void setHistory(bool record) { ujb_engine_set_history(engine_, record); }
+
+    bool setHistorySize(size_t entries)
+    {
+        return ujb_engine_set_history_size(engine_, entries) == 0;
+    }
+
+    // Results stay valid until the next evaluate, format or run call
+    bool evaluate(const std::string& expression, ujb_result& result)
+    {
+        return ujb_engine_evaluate(engine_, expression.data(), expression.size(), &result) == 0;
+    }
+
+    size_t evaluateBatch(const std::vector<std::string>& expressions,
+            std::vector<ujb_result>& results)
+    {
+        std::vector<const char*> texts(expressions.size());
+        std::vector<size_t> lengths(expressions.size());
+        for (size_t i = 0; i < expressions.size(); i++) {
+            texts[i] = expressions[i].data();
+            lengths[i] = expressions[i].size();
+        }
+        results.resize(expressions.size());
+        return ujb_engine_evaluate_batch(engine_, texts.data(), lengths.data(),
+                expressions.size(), results.data());
+    }
+
+    bool formatAllBases(unsigned long long value, ujb_result& result)
+    {
+        return ujb_engine_format_all_bases(engine_, value, &result) == 0;
+    }
+
+    bool compile(const std::string& expression, Program& program)
+    {
+        return ujb_engine_compile(engine_, expression.data(), expression.size(),
+                program.get()) == 0;
+    }
+
+    // Results stay valid until the next evaluate, format or run call
+    bool run(const Program& program, ujb_result& result)
+    {
+        return ujb_engine_run(engine_, program.get(), &result) == 0;
+    }
+
+    size_t historyCount() const { return ujb_engine_history_count(engine_); }
+
+    const ujb_history_entry* history(size_t i) const
+    {
+        return ujb_engine_history_entry(engine_, i);
+    }
+
+    void clearHistory() { ujb_engine_clear_history(engine_); }
+
+    ujb_engine* get() { return engine_; }
+
+private:
+    ujb_engine* engine_;
+};
+
+} // namespace ujb
+#endif /* __cplusplus */
+
+#endif /* UJB_ENGINE_H */
@@ -1,17 +1,72 @@
+#define _GNU_SOURCE // accept4()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
 #include "uqbasejump.h"
+#include "result_cache.h"
+#include "ring_queue.h"
+#include "history.h"
 
 /* Program constants */
 #define MAX_BASE 36               // Maximum supported base
 #define MIN_BASE 2                // Minimum supported base
-#define MAX_INPUT 64              // Maximum input buffer size
+#define INPUT_INLINE_BYTES 64     // Input literal length held without allocating
+#define INITIAL_CAPACITY 64       // First capacity of growable buffers
 #define MAX_CMD_INPUT 128         // Maximum command buffer size
 #define DEFAULT_NUMBER_OF_BASES 3 // Default output bases count
 #define END_OF_TRANSMISSION 4     // ASCII code for EOT character
+#define MAX_JOBS 256              // Maximum number of --jobs worker threads
+#define MAX_CACHE_ENTRIES 1000000 // Maximum --cache entries per thread
+#define DEFAULT_HISTORY_ENTRIES 1000 // History kept without --history-size
+#define MAX_HISTORY_ENTRIES 1000000  // Maximum --history-size entries
+#define HISTORY_LOG_MAGIC "UJBHIST1" // First bytes of a --history-file log
+#define HISTORY_LOG_MAGIC_BYTES 8    // Length of HISTORY_LOG_MAGIC
+#define FILE_READ_BYTES (1 << 20) // Streamed input read at a time
+#define FILE_CHUNK_BYTES (1 << 20) // Input bytes handed to a worker at a time
+#define OUTPUT_BUFFER_BYTES (1 << 18) // Buffered output written at a time
+#define OUTPUT_IOV_BATCH 64       // Buffers gathered into one writev()
+#define SERVE_TCP_PREFIX "tcp:"   // --serve address prefix selecting TCP
+#define SERVE_DEFAULT_HOST "127.0.0.1" // TCP host when only a port is given
+#define SERVE_BACKLOG 128         // Pending connections queued by listen()
+#define SERVE_MAX_EVENTS 64       // Events taken per epoll_wait()
+#define SERVE_READ_BYTES 65536    // Bytes read from a client at a time
+#define SERVE_MAX_LINE (1 << 20)  // Longest request line accepted
+#define SERVE_MAX_JOBS 16         // Jobs per client before reading pauses
+#define SERVE_MAX_REPLY_BYTES (1 << 22) // Unsent reply before reading pauses
+#define SERVE_ERROR_RECORD "ERR Cannot evaluate the expression\n"
+#define KEY_READ_BYTES 4096       // Interactive input read at a time
+#define PASTE_START "\033[200~"   // Sent by the terminal before a paste
+#define PASTE_END "\033[201~"     // Sent by the terminal after a paste
+#define PASTE_MARKER_BYTES 6      // Length of PASTE_START and PASTE_END
+#define PASTE_MARKER_WAIT_MS 50   // Wait for the rest of a split PASTE_START
+#ifdef UJB_STATS
+#define STATS_USAGE " [--stats]"  // --stats only exists in -DUJB_STATS builds
+#else
+#define STATS_USAGE ""
+#endif
 
 /* DefaultBase enumeration
  * ----------------------
@@ -32,7 +87,8 @@ enum Key
 {
     BACK_SPACE = 127, // ASCII backspace character
     ESC = 27,         // ASCII escape character
-    ENTER = '\n'      // ASCII newline character
+    ENTER = '\n',     // ASCII newline character
+    PASTE_BLOCK = -2  // A pasted block of lines (not a character)
 };
 
 /* Exit enumeration
@@ -42,19 +98,169 @@ enum Key
 enum Exit
 {
     EXIT_INV_COMM_ARGS = 17, // Invalid command line arguments
-    EXIT_OPEN_FILE = 13      // Unable to open file
+    EXIT_OPEN_FILE = 13,     // Unable to open file
+    EXIT_SERVE = 19          // Unable to set up --serve mode
 };
 
-/* HistoryEntry struct
+/* OutputFormat enumeration
+ * -------------------------
+ * Defines the record formats selected with --format.
+ */
+enum OutputFormat
+{
+    FORMAT_TEXT,         // Prose for file mode, OK/ERR lines for --serve
+    FORMAT_JSONL,        // One JSON object per line
+    FORMAT_TSV,          // One tab separated line
+    FORMAT_BINARY,       // Fixed layout binary record
+    FORMAT_BINARY_DIGITS // Binary record with digits for every output base
+};
+
+/* RecordStatus enumeration
+ * ------------------------
+ * Defines the status byte that starts every binary record.
+ */
+enum RecordStatus
+{
+    RECORD_ERROR = 0, // The expression cannot be evaluated
+    RECORD_U64 = 1,   // A 64-bit value follows
+    RECORD_BIG = 2    // A length-prefixed bignum magnitude follows
+};
+
+/* HistoryRecord struct
+ * --------------------
+ * Header of one record of a --history-file log, in native byte order and
+ * packed with no padding. The expression follows it, then the result
+ * digits when the result does not fit in value, then a copy of length so
+ * that the log can be walked backwards from its end.
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t length;        // Bytes in the whole record, both lengths included
+    uint8_t base;           // The base used for the expression
+    uint64_t value;         // The calculated result, when digitsLen is 0
+    uint32_t expressionLen; // Bytes of expression after the header
+    uint32_t digitsLen;     // Bytes of result digits after the expression
+} HistoryRecord;
+
+/* History struct
+ * --------------
+ * The most recent calculations, kept in a bounded ring (see history.h) of
+ * --history-size entries, and the --history-file log they are saved to.
+ */
+typedef struct
+{
+    HistoryRing ring;    // The calculations shown by :h
+    const char *logPath; // --history-file log, or NULL
+    int logFd;           // The log opened for appending, or -1
+} History;
+
+/* OutputSegment struct
+ * --------------------
+ * A run of buffered output bytes that are all bound for the same stream.
+ */
+typedef struct
+{
+    FILE *stream; // stdout or stderr
+    size_t end;   // Offset in the buffer just past the segment
+} OutputSegment;
+
+/* OutputBuffer struct
+ * -------------------
+ * Collects the text printed for one or more expressions so that it can be
+ * produced on any thread and written out later, in order, with stdout and
+ * stderr interleaved exactly as if it had been printed directly.
+ */
+typedef struct
+{
+    char *data;                // Buffered text of every segment
+    size_t len;                // Bytes in use
+    size_t capacity;           // Bytes allocated
+    OutputSegment *segments;   // Consecutive segments in print order
+    size_t segmentCount;       // Number of segments in use
+    size_t segmentCapacity;    // Number of segments allocated
+} OutputBuffer;
+
+/* BaseFields struct
+ * -----------------
+ * How output_base_fields() frames the digits of each output base.
+ */
+typedef struct
+{
+    const char *before;    // Text at the start of every field
+    const char *between;   // Text between the base and its digits, or NULL
+                           // to leave the base out
+    const char *after;     // Text at the end of every field
+    const char *separator; // Text between two fields
+} BaseFields;
+
+/* "Base 16: FF" lines of the text display */
+static const BaseFields TEXT_BASE_FIELDS = {"Base ", ": ", "\n", ""};
+/* "16":"FF" members of the --format jsonl "bases" object */
+static const BaseFields JSON_BASE_FIELDS = {"\"", "\":\"", "\"", ","};
+/* Tab separated digits of a --format tsv line */
+static const BaseFields TSV_BASE_FIELDS = {"\t", NULL, "", ""};
+/* " 16:FF" fields of a --serve reply */
+static const BaseFields SERVE_BASE_FIELDS = {" ", ":", "", ""};
+
+/* InputBuffer struct
+ * ------------------
+ * The literal being typed in interactive mode. Short literals live in
+ * inlineText; a longer one, such as a pasted key, moves to the heap, where
+ * the capacity doubles as it grows. text points at whichever is in use, so
+ * an InputBuffer must not be copied.
+ */
+typedef struct
+{
+    char *text;      // Null terminated literal, inline or on the heap
+    size_t len;      // Characters in the literal
+    size_t capacity; // Characters text can hold before the terminator
+    char inlineText[INPUT_INLINE_BYTES + 1]; // Storage for short literals
+} InputBuffer;
+
+/* KeyReader struct
+ * ----------------
+ * Interactive input taken with one read() per burst rather than one call
+ * per key, and the text of the most recent bracketed paste.
+ */
+typedef struct
+{
+    unsigned char data[KEY_READ_BYTES]; // Bytes read but not yet handled
+    size_t pos;            // Next byte of data to hand out
+    size_t len;            // Bytes in data
+    bool bracketed;        // Whether the terminal marks the start and end of pastes
+    char *paste;           // Text of the most recent paste
+    size_t pasteLen;       // Bytes in paste
+    size_t pasteCapacity;  // Bytes allocated for paste
+    size_t replayed;       // Bytes of paste already handed out as keys
+} KeyReader;
+
+/* InputPreview struct
  * -------------------
- * Stores a single history entry containing an expression, its base, and result.
+ * Value of the literal being typed in interactive mode, folded in one digit
+ * at a time so that each key costs a multiply-add instead of a reparse.
+ */
+typedef struct
+{
+    size_t len;               // Digits folded into the value
+    size_t wrapLen;           // Digit count at which value first wrapped, or 0
+    unsigned long long value; // Value modulo 2^64, as the evaluator reads it
+    BigInt big;               // Exact value, kept with --precision big or int
+} InputPreview;
+
+/* PreviewScreen struct
+ * --------------------
+ * The interactive display as last painted, so that the next paint only
+ * rewrites the lines that changed.
  */
 typedef struct
 {
-    char *expression;          // The mathematical expression string
-    int base;                  // The base used for the expression
-    unsigned long long result; // The calculated result
-} HistoryEntry;
+    OutputBuffer shown; // Lines on the terminal, each ending in '\n'
+    OutputBuffer next;  // Lines of the frame being built
+    bool painted;       // Whether the terminal still shows the shown lines
+    bool clear;         // Whether next replaces the screen or adds to it
+    bool pending;       // Whether next is complete but not yet painted
+    bool terminal;      // Whether frames wait for idle input and use escapes
+} PreviewScreen;
 
 /* Config struct
  * -------------
@@ -67,32 +273,307 @@ typedef struct
     int oBases[MAX_BASE]; // Array of output bases to display
     int oBasesCount;      // Number of output bases
     bool haveFile;        // Whether file input was specified
-    const char *fileName; // Name of input file (if any)
+    const char *fileName; // Name of input file, or NULL to read stdin
+    Precision precision;  // Arithmetic used to evaluate expressions
+    int jobs;             // Worker threads used for file mode
+    bool unbuffered;      // Write each expression's output immediately
+    bool haveServe;       // Whether --serve was specified
+    const char *servePath; // Socket path or "tcp:[HOST:]PORT" to serve on
+    enum OutputFormat format; // Record format for file and server output
+    size_t cacheEntries;  // Result cache entries per thread, 0 for none
+    bool stats;           // Whether --stats reports counters and latencies
+    Arena scratch;        // Interactive scratch memory, reset after each key
+    InputPreview preview; // Value of the interactive input buffer
+    PreviewScreen screen; // Interactive display as last painted
 
-    // History storage
-    HistoryEntry *history;  // Dynamic array of history entries
-    size_t historyCount;    // Number of entries in history
-    size_t historyCapacity; // Allocated capacity for history array
+    History history;      // Calculations shown by :h
 } Config;
 
+/* ExprDisplayFn type
+ * ------------------
+ * Appends whatever one expression displays to an output buffer; the
+ * signature of file_expr_evaluation_display().
+ */
+typedef void (*ExprDisplayFn)(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                              const char *expression, size_t len,
+                              int inputBase, int oBasesCount,
+                              const int *oBases, Precision precision);
+
+/* RecordResult struct
+ * -------------------
+ * The result of one expression on its way to being displayed.
+ */
+typedef struct
+{
+    Precision precision;      // Which of value and big holds the result
+    unsigned long long value; // The result with double or int precision
+    BigInt big;               // The result with big precision, or int
+                              // precision when it needs more than 64 bits
+    ResultCacheEntry *cached; // Cache entry holding rendered digits, or NULL
+    bool rendered;            // Whether digits holds value in every output base
+    size_t digitEnds[MAX_BASE];                    // Ends of the digits of each output base
+    char digits[MAX_BASE * FORMAT_DIGITS_BYTES];   // Block from format_all_bases()
+} RecordResult;
+
+/* FileInput struct
+ * ----------------
+ * The --file input. Regular files are mapped into memory and their lines
+ * are used in place; anything that cannot be mapped (pipes, terminals,
+ * a piped stdin) is streamed instead: read() fills a buffer in blocks of
+ * up to FILE_READ_BYTES and lines are used in place in that buffer.
+ */
+typedef struct
+{
+    FILE *file;          // The open input file
+    const char *map;     // Mapped contents, or NULL when streaming
+    size_t mapLen;       // Size of the mapping
+    size_t offset;       // Bytes of the mapping consumed so far
+    char *block;         // Buffer of streamed input
+    size_t blockCapacity; // Bytes allocated for block
+    size_t blockStart;   // Bytes of block consumed so far
+    size_t blockLen;     // Bytes read into block
+    bool ended;          // Whether the stream has no more input
+} FileInput;
+
+/* FileChunk struct
+ * ----------------
+ * A run of consecutive lines from the input file together with the output
+ * they produce, handed to a worker thread as one unit.
+ */
+typedef struct
+{
+    const char *data;    // Raw lines, newlines included (mapping or text)
+    size_t len;          // Bytes in data
+    char *text;          // Copy of the lines when the input is streamed
+    size_t textCapacity; // Bytes allocated for text
+    size_t number;       // Position of the chunk in the file, from 0
+    OutputBuffer output; // Output of every line, in order
+} FileChunk;
+
+/* WorkerPool struct
+ * -----------------
+ * Shared state for --jobs file mode, run as a pipeline of three stages: a
+ * reader thread fills chunks with whole lines, the workers evaluate them,
+ * and the main thread writes their output in file order. A fixed set of
+ * chunks circulates through three queues (empty chunks back to the
+ * reader, filled chunks to the workers, evaluated chunks to the writer),
+ * so reads, evaluation and writes overlap and a slow stage holds the
+ * others back once every chunk is waiting on it.
+ */
+typedef struct
+{
+    const Config *cfg;       // Settings used to evaluate every line
+    FileInput *in;           // The input, used only by the reader
+    FileChunk *chunks;       // Every chunk in circulation
+    size_t chunkCount;       // Number of chunks
+    int workers;             // Worker threads running
+    RingQueue empty;         // Chunks ready to be filled by the reader
+    RingQueue filled;        // Chunks to evaluate; NULL stops a worker
+    RingQueue evaluated;     // Chunks to write; NULL ends the input
+    size_t submitted;        // Chunks read, set by the reader before its NULL
+    ResultCacheStats cacheStats; // Cache counters of the workers that have exited
+    Stats stats;             // --stats of the threads that have exited
+    pthread_mutex_t lock;    // Guards the counters of exited threads
+} WorkerPool;
+
+/* ServeJob struct
+ * ---------------
+ * A run of complete request lines read from one --serve connection,
+ * evaluated by a worker as one unit into its own output buffer.
+ */
+typedef struct ServeJob
+{
+    struct ServeConnection *conn;      // Connection the lines came from
+    char *text;                        // Request lines, newlines included
+    size_t len;                        // Bytes in text
+    bool done;                         // Whether the event loop has seen it finish
+    OutputBuffer output;               // One record per line, in order
+    struct ServeJob *nextInConnection; // Next job of the same connection
+    struct ServeJob *nextQueued;       // Next job in the pool or done list
+} ServeJob;
+
+/* ServeConnection struct
+ * ----------------------
+ * One client of --serve mode. Its jobs are kept in request order, and a
+ * job's records join the reply only once every earlier job has too.
+ */
+typedef struct ServeConnection
+{
+    int fd;                             // The socket, or -1 once closed
+    char *input;                        // Bytes read but not yet submitted
+    size_t inputLen;                    // Bytes in input
+    size_t inputCapacity;               // Bytes allocated for input
+    OutputBuffer reply;                 // Records waiting to be sent
+    size_t replySent;                   // Bytes of reply already sent
+    ServeJob *firstJob;                 // Oldest job not yet in reply
+    ServeJob *lastJob;                  // Newest job
+    size_t jobCount;                    // Jobs not yet in reply
+    bool readClosed;                    // The client has finished sending
+    bool broken;                        // The connection failed; drop it
+    bool dirty;                         // On the event loop's dirty list
+    bool buried;                        // Waiting to be freed
+    uint32_t events;                    // Events registered with epoll
+    struct ServeConnection *nextDirty;  // Next connection on a dirty list
+    struct ServeConnection *prev;       // Neighbours in the server's list
+    struct ServeConnection *next;
+} ServeConnection;
+
+/* Server struct
+ * -------------
+ * Shared state for --serve mode. The event loop owns every connection;
+ * workers only take jobs from the queue and put them on the done list,
+ * then wake the loop through wakeFd.
+ */
+typedef struct
+{
+    const Config *cfg;             // Settings used to evaluate every line
+    int epollFd;                   // The event loop
+    int listenFd;                  // Listening socket
+    int wakeFd;                    // eventfd written when jobs finish
+    int signalFd;                  // signalfd for SIGINT and SIGTERM
+    ServeConnection *connections;  // Every open connection
+    ServeConnection *graveyard;    // Connections to free after this batch
+    ServeJob *queueHead;           // Jobs waiting for a worker, oldest first
+    ServeJob *queueTail;           // Newest job waiting for a worker
+    ServeJob *doneHead;            // Jobs finished since the loop last looked
+    bool finished;                 // Workers should exit
+    pthread_mutex_t lock;          // Guards the queue, done list and finished
+    pthread_cond_t workReady;      // Signalled when a job is queued
+    ResultCacheStats cacheStats;   // Cache counters of the workers that have exited
+    Stats stats;                   // --stats of the workers that have exited
+} Server;
+
+/* Terminal settings saved before the first switch to raw input */
+static struct termios originalTermios;
+static bool termiosInitialized = false;
+
 void invalid_command_line_args();
 bool in_range(int base);
 bool digits_only(const char *s);
-char *remove_trailings(char *s);
+size_t trimmed_line_length(const char *line, size_t len);
 void file_checking(const char *fileName, FILE **inputFile);
-void file_expr_evaluation_display(const char *expression, int inputBase,
-                                  int oBasesCount, const int *oBases);
+void file_input_open(FileInput *in, FILE *file);
+void file_input_close(FileInput *in);
+bool file_input_fill(FileInput *in);
+size_t file_input_find_newline(FileInput *in);
+bool file_input_next_line(FileInput *in, const char **line, size_t *len);
+bool file_input_next_chunk(FileInput *in, FileChunk *chunk);
+void output_init(OutputBuffer *out);
+void output_free(OutputBuffer *out);
+char *output_reserve(OutputBuffer *out, size_t len);
+void output_commit(OutputBuffer *out, FILE *stream, size_t len);
+void output_append(OutputBuffer *out, FILE *stream, const char *text, size_t len);
+void output_append_digits(OutputBuffer *out, FILE *stream,
+                          unsigned long long value, int base);
+void output_result_line(OutputBuffer *out, const char *prefix,
+                        const char *separator, int base,
+                        const unsigned long long *value);
+void output_expression_line(OutputBuffer *out, FILE *stream, const char *before,
+                            const char *expression, size_t len, const char *after);
+void output_base_fields(OutputBuffer *out, const BaseFields *fields,
+                        const int *bases, int count, const char *digits,
+                        const size_t *ends);
+void output_base_lines(OutputBuffer *out, unsigned long long value,
+                       const int *bases, int count);
+void output_printf(OutputBuffer *out, FILE *stream, const char *format, ...);
+void output_append_buffer(OutputBuffer *out, const OutputBuffer *from);
+void write_iovecs(int fd, struct iovec *iov, int count);
+void output_write_all(OutputBuffer **buffers, size_t count);
+void output_flush(OutputBuffer *out);
+void file_expr_evaluation_display(OutputBuffer *out, Arena *arena,
+                                  ResultCache *cache, const char *expression,
+                                  size_t len, int inputBase, int oBasesCount,
+                                  const int *oBases, Precision precision);
+void display_big_result(OutputBuffer *out, Arena *arena, const BigInt *result,
+                        int inputBase, int oBasesCount, const int *oBases);
+int record_evaluate(Arena *arena, ResultCache *cache, const char *expression,
+                    size_t len, int inputBase, int oBasesCount,
+                    const int *oBases, Precision precision, bool render,
+                    RecordResult *result);
+void record_result_free(RecordResult *result);
+void output_record_digits(OutputBuffer *out, Arena *arena, const RecordResult *result,
+                          int index, int base, bool lengthPrefix);
+void output_append_le(OutputBuffer *out, unsigned long long value, int bytes);
+int utf8_sequence_length(const unsigned char *s, size_t avail);
+void output_escaped(OutputBuffer *out, const char *expression, size_t len, bool json);
+void jsonl_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                       const char *expression, size_t len, int inputBase,
+                       int oBasesCount, const int *oBases, Precision precision);
+void tsv_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                     const char *expression, size_t len, int inputBase,
+                     int oBasesCount, const int *oBases, Precision precision);
+void binary_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                   const char *expression, size_t len, int inputBase,
+                   int oBasesCount, const int *oBases, Precision precision,
+                   bool withDigits);
+void binary_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                        const char *expression, size_t len, int inputBase,
+                        int oBasesCount, const int *oBases, Precision precision);
+void binary_digits_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                               const char *expression, size_t len, int inputBase,
+                               int oBasesCount, const int *oBases,
+                               Precision precision);
+ExprDisplayFn format_display(const Config *cfg, ExprDisplayFn textDisplay);
+ResultCache *open_result_cache(const Config *cfg, ResultCache *cache);
+void report_cache_stats(const Config *cfg, const ResultCacheStats *stats);
+void report_run_stats(const Config *cfg, const Stats *stats);
+EvalFailure rejection_reason(const char *expression, size_t len, int inputBase);
+bool process_file_serial(const Config *cfg, FileInput *in);
+void evaluate_lines(const Config *cfg, Arena *arena, ResultCache *cache,
+                    const char *data, size_t len, OutputBuffer *out,
+                    ExprDisplayFn display);
+void evaluate_file_chunk(const Config *cfg, Arena *arena, ResultCache *cache,
+                         FileChunk *chunk);
+void *file_reader(void *arg);
+void *file_worker(void *arg);
+size_t write_ready_chunks(FileChunk **order, size_t chunkCount, size_t *written,
+                          RingQueue *empty);
+bool process_file_parallel(const Config *cfg, FileInput *in);
+bool serve_saturated(const ServeConnection *conn);
+void serve_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                       const char *expression, size_t len, int inputBase,
+                       int oBasesCount, const int *oBases, Precision precision);
+int serve_open_unix(const char *path);
+int serve_open_tcp(const char *spec);
+void *serve_worker(void *arg);
+void serve_submit(Server *server, ServeConnection *conn, bool final);
+void serve_read(Server *server, ServeConnection *conn);
+void serve_send(ServeConnection *conn);
+void serve_collect(ServeConnection *conn);
+void serve_update(Server *server, ServeConnection *conn);
+void serve_accept(Server *server);
+void serve_drain_done(Server *server);
+void serve_free_connection(Server *server, ServeConnection *conn);
+int run_server(const Config *cfg);
 void initialize_config(Config *cfg);
 void parse_arguments(int argc, char **argv, Config *cfg);
 void handle_inputbase_arg(int argc, char **argv, int *i, Config *cfg);
 void handle_obases_arg(int argc, char **argv, int *i, Config *cfg);
 void handle_file_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_precision_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_jobs_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_serve_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_format_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_cache_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_history_size_arg(int argc, char **argv, int *i, Config *cfg);
+void handle_history_file_arg(int argc, char **argv, int *i, Config *cfg);
 void output_bases_parse(const char *basesOfOutput, Config *cfg);
 void program_startup(const Config *cfg);
-void add_history(Config *cfg, const char *expression, int base,
-                 unsigned long long result);
+void add_history(Config *cfg, const char *expression, size_t len, int base,
+                 unsigned long long result, const char *bigResult,
+                 size_t bigResultLen);
+void history_push(History *history, const char *expression, size_t len,
+                  int base, const char *result, size_t resultLen);
+void history_log_open(History *history);
+size_t history_log_load(History *history, const char *log, size_t len);
+size_t history_log_record_length(const char *log, size_t start, size_t len);
+size_t history_log_whole_length(const char *log, size_t len);
+void history_log_append(History *history, const char *expression, size_t len,
+                        int base, unsigned long long result,
+                        const char *bigResult, size_t bigResultLen);
 void free_history(Config *cfg);
 bool is_in_base_range(int ch, int base, char *outputCharacter);
+char *normalize_input_literal(Config *cfg, const char *inputBuffer);
 void append_string(char **expressionBuffer, size_t *expressionBufferLen,
                    size_t *expressionBufferCapacity, const char *inputBuffer,
                    size_t inputBufferLen);
@@ -103,11 +584,45 @@ void handle_operators(Config *cfg, char **expressionBuffer,
                       const char *inputBuffer, size_t inputBufferLen);
 void evaluate_and_display_result(
     Config *cfg, char *expressionBuffer, size_t *expressionBufferLen);
-void stdrd_input_expr_display(const Config *cfg, const char *expressionBuffer,
+bool evaluate_typed_expression(Config *cfg, OutputBuffer *out,
+                               const char *expression, size_t len);
+bool evaluate_typed_big_expression(Config *cfg, OutputBuffer *out,
+                                   const char *expression, size_t len);
+void show_typed_big_result(Config *cfg, OutputBuffer *out,
+                           const char *expression, size_t len,
+                           const BigInt *result);
+void paste_command(Config *cfg, const char *line, size_t len,
+                   char **expressionBuffer, size_t *expressionBufferLen,
+                   InputBuffer *input);
+bool paste_evaluate(Config *cfg, const char *text, size_t len,
+                    char **expressionBuffer, size_t *expressionBufferLen,
+                    InputBuffer *input);
+void enable_line_buffering(void);
+void disable_line_buffering(void);
+void clear_screen(void);
+void preview_push(Config *cfg, char digit);
+void preview_pop(Config *cfg, const char *inputBuffer, size_t inputBufferLen);
+void preview_clear(Config *cfg);
+bool screen_fits(const OutputBuffer *frame, const struct winsize *size);
+void screen_begin(PreviewScreen *screen, bool clear);
+void screen_show(PreviewScreen *screen);
+void screen_flush(PreviewScreen *screen);
+void screen_paint(PreviewScreen *screen);
+void stdrd_input_expr_display(Config *cfg, const char *expressionBuffer,
                               const char *inputBuffer);
+void input_buffer_init(InputBuffer *input);
+void input_buffer_free(InputBuffer *input);
+bool input_buffer_push(InputBuffer *input, char ch);
+void key_reader_init(KeyReader *reader, bool bracketed);
+void key_reader_free(KeyReader *reader);
+bool key_reader_fill(KeyReader *reader, PreviewScreen *screen);
+int key_reader_byte(KeyReader *reader, PreviewScreen *screen);
+bool key_reader_paste_start(KeyReader *reader);
+int key_reader_paste(KeyReader *reader, PreviewScreen *screen);
+int key_reader_next(KeyReader *reader, PreviewScreen *screen);
 void stdrd_input_expr_evaluation(Config *cfg);
-void handle_character_input(Config *cfg, int ch, char *inputBuffer,
-                            size_t *inputBufferLen, char **expressionBuffer);
+void handle_character_input(Config *cfg, int ch, InputBuffer *inputBuffer,
+                            char **expressionBuffer);
 void handle_operator_input(Config *cfg, int ch, char **expressionBuffer,
                            size_t *expressionBufferLen, size_t *expressionBufferCapacity,
                            char *inputBuffer, size_t *inputBufferLen);
@@ -132,6 +647,20 @@ void handle_output_base_command(Config *cfg, char *commandBuffer,
                                 size_t *expressionBufferLen, char *inputBuffer, size_t *inputBufferLen);
 void handle_history_command(Config *cfg);
 
+/* Names accepted by --format and their displays, indexed by OutputFormat;
+ * FORMAT_TEXT keeps the display of the current mode */
+static const struct
+{
+    const char *name;
+    ExprDisplayFn display;
+} outputFormats[] = {
+    {"text", NULL},
+    {"jsonl", jsonl_expr_record},
+    {"tsv", tsv_expr_record},
+    {"binary", binary_expr_record},
+    {"binary-digits", binary_digits_expr_record},
+};
+
 /* invalid_command_line_args()
  * ---------------------------
  * Prints usage information to stderr and exits the program with an error code.
@@ -143,7 +672,10 @@ void invalid_command_line_args()
 {
     fprintf(stderr,
             "Usage: ./uqbasejump [--obases 2..36] [--inputbase 2..36] [--file "
-            "string]\n");
+            "string] [--stdin-batch] [--precision double|int|big] [--jobs N] [--unbuffered] "
+            "[--serve string] [--format text|jsonl|tsv|binary|binary-digits] "
+            "[--cache N] [--history-size N] [--history-file string]" STATS_USAGE
+            "\n");
     exit(EXIT_INV_COMM_ARGS);
 }
 
@@ -180,26 +712,26 @@ bool digits_only(const char *s)
     return true;
 }
 
-/* remove_trailings()
- * ------------------
- * Removes trailing newline and carriage return characters from a string.
+/* trimmed_line_length()
+ * ----------------------
+ * Works out how much of a raw input line is the expression: a line ends at
+ * its first '\0' (as a C string would), less any trailing newline and
+ * carriage return characters. The line itself is not modified.
  *
- * s: The string to modify (may be NULL)
+ * line: The raw line (need not be null terminated)
+ * len: Number of bytes in the raw line
  *
- * Returns: The modified string (same pointer as input)
+ * Returns: Length of the expression at the start of line
  */
-char *remove_trailings(char *s)
+size_t trimmed_line_length(const char *line, size_t len)
 {
-    if (!s)
-    {
-        return s;
-    }
-    size_t n = strlen(s);
-    while (n && (s[n - 1] == '\n' || s[n - 1] == '\r'))
+    const char *nul = memchr(line, '\0', len);
+    size_t n = nul ? (size_t)(nul - line) : len;
+    while (n && (line[n - 1] == '\n' || line[n - 1] == '\r'))
     {
-        s[--n] = '\0';
+        n--;
     }
-    return s;
+    return n;
 }
 
 /* file_checking()
@@ -223,702 +755,4596 @@ void file_checking(const char *fileName, FILE **inputFile)
     *inputFile = file;
 }
 
-/* file_expr_evaluation_display()
- * ------------------------------
- * Evaluates a mathematical expression and displays the result in multiple
- * bases. Used for file-based input processing.
+/* output_init()
+ * -------------
+ * Initializes an empty output buffer.
  *
- * expression: The mathematical expression string to evaluate
- * inputBase: The base of the input expression (2-36)
- * oBasesCount: Number of output bases to display
- * oBases: Array of output bases to display results in
+ * out: Pointer to OutputBuffer structure to initialize
+ */
+void output_init(OutputBuffer *out)
+{
+    out->data = NULL;
+    out->len = 0;
+    out->capacity = 0;
+    out->segments = NULL;
+    out->segmentCount = 0;
+    out->segmentCapacity = 0;
+}
+
+/* output_free()
+ * -------------
+ * Releases the memory held by an output buffer and leaves it empty.
  *
- * Returns: Nothing (void)
- * Errors: Prints error message to stderr if expression cannot be evaluated
- * REF: This function was developed with assistance from Cursor for
- * REF: implementing file-based mathematical expression evaluation and
- * multi-base output display.
+ * out: Pointer to OutputBuffer structure to free
  */
-void file_expr_evaluation_display(const char *expression, int inputBase,
-                                  int oBasesCount, const int *oBases)
+void output_free(OutputBuffer *out)
 {
-    unsigned long long result = 0;
-    char *expressionInDecimal = convert_expression(expression, inputBase, DECIMAL);
-    int evaluateSuccessful = 0;
+    free(out->data);
+    free(out->segments);
+    output_init(out);
+}
 
-    if (expressionInDecimal)
+/* output_reserve()
+ * ----------------
+ * Makes room for at least len more bytes at the end of the buffer.
+ *
+ * out: Pointer to OutputBuffer to grow
+ * len: Number of bytes about to be written
+ *
+ * Returns: Pointer to where the bytes should be written, or NULL if memory
+ * allocation fails
+ */
+char *output_reserve(OutputBuffer *out, size_t len)
+{
+    if (out->len + len > out->capacity)
     {
-        evaluateSuccessful = evaluate_expression(expressionInDecimal, &result);
-
-        if (evaluateSuccessful != 0)
-        { // != 0 means unsuccessful
-            // Print error message to stderr
-            fprintf(stderr, "Cannot evaluate the expression \"%s\"\n",
-                    expression);
-            free(expressionInDecimal);
-            return;
+        size_t capacity = out->capacity ? out->capacity * 2 : 256;
+        while (capacity < out->len + len)
+        {
+            capacity *= 2;
+        }
+        char *data = realloc(out->data, capacity);
+        if (!data)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return NULL;
         }
-        printf("Expression (base %d): %s\n", inputBase, expression);
-        free(expressionInDecimal);
+        out->data = data;
+        out->capacity = capacity;
     }
-    else
+    return out->data + out->len;
+}
+
+/* output_commit()
+ * ---------------
+ * Adds len bytes written at output_reserve()'s pointer to the buffer,
+ * extending the last segment or starting a new one when the stream
+ * changes.
+ *
+ * out: Pointer to OutputBuffer being written
+ * stream: Stream the bytes are for (stdout or stderr)
+ * len: Number of bytes written
+ *
+ * Errors: Prints error message to stderr and drops the bytes if memory
+ * allocation fails
+ */
+void output_commit(OutputBuffer *out, FILE *stream, size_t len)
+{
+    if (out->segmentCount == 0 ||
+        out->segments[out->segmentCount - 1].stream != stream)
     {
-        // Failed to convert
-        fprintf(stderr, "Cannot evaluate the expression \"%s\"\n", expression);
-        return;
+        if (out->segmentCount == out->segmentCapacity)
+        {
+            size_t capacity = out->segmentCapacity ? out->segmentCapacity * 2 : 8;
+            OutputSegment *segments =
+                realloc(out->segments, capacity * sizeof(OutputSegment));
+            if (!segments)
+            {
+                fprintf(stderr, "Memory allocation failed\n");
+                return;
+            }
+            out->segments = segments;
+            out->segmentCapacity = capacity;
+        }
+        out->segments[out->segmentCount++].stream = stream;
     }
+    out->len += len;
+    out->segments[out->segmentCount - 1].end = out->len;
+}
 
-    char *resultInInputBase = convert_int_to_str_any_base(result, inputBase);
-    printf("Result (base %d): %s\n", inputBase,
-           resultInInputBase ? resultInInputBase : "0");
-
-    for (int i = 0; i < oBasesCount; i++)
+/* output_append()
+ * ---------------
+ * Appends len bytes of text to the buffer, to be written to stream.
+ *
+ * out: Pointer to OutputBuffer to append to
+ * stream: Stream the text is for (stdout or stderr)
+ * text: The bytes to append (need not be null terminated)
+ * len: Number of bytes to append
+ */
+void output_append(OutputBuffer *out, FILE *stream, const char *text, size_t len)
+{
+    char *p = output_reserve(out, len);
+    if (p)
     {
-        int base = oBases[i];
-        char *output = convert_int_to_str_any_base(result, base);
-        printf("Base %d: %s\n", base, output ? output : "0");
-        free(output);
+        memcpy(p, text, len);
+        output_commit(out, stream, len);
     }
-
-    free(resultInInputBase);
-    fflush(stdout);
 }
 
-/* initialize_config()
- * -------------------
- * Initializes a Config structure with default values.
- *
- * cfg: Pointer to Config structure to initialize
+/* output_append_digits()
+ * ----------------------
+ * Appends the digits of value in base to the buffer, formatting them in
+ * place without any intermediate string.
  *
- * Global variables modified: None
+ * out: Pointer to OutputBuffer to append to
+ * stream: Stream the digits are for (stdout or stderr)
+ * value: The number to write
+ * base: The base to write it in (2-36)
  */
-void initialize_config(Config *cfg)
+void output_append_digits(OutputBuffer *out, FILE *stream,
+                          unsigned long long value, int base)
 {
-    cfg->fileName = NULL;
-    cfg->haveFile = false;
-    cfg->haveInputBase = false;
-    cfg->inputBase = DECIMAL;
-    cfg->oBases[0] = BINARY;
-    cfg->oBases[1] = DECIMAL;
-    cfg->oBases[2] = HEX;
-    cfg->oBasesCount = DEFAULT_NUMBER_OF_BASES;
-
-    cfg->history = NULL;
-    cfg->historyCapacity = 0;
-    cfg->historyCount = 0;
+    char *p = output_reserve(out, 64);
+    if (p)
+    {
+        char *start = format_digits(value, base, p + 64);
+        size_t len = (size_t)(p + 64 - start);
+        memmove(p, start, len);
+        output_commit(out, stream, len);
+    }
 }
 
-/* parse_arguments()
- * -----------------
- * Parses command line arguments and populates the configuration structure.
+/* output_result_line()
+ * --------------------
+ * Appends a "<prefix><base><separator><digits>\n" line for stdout, such as
+ * "Base 16: FF", with the digits of value written in base. If value is
+ * NULL only "<prefix><base><separator>" is appended.
  *
- * argc: Number of command line arguments
- * argv: Array of command line argument strings
- * cfg: Pointer to Config structure to populate
+ * out: Pointer to OutputBuffer to append to
+ * prefix: Text before the base
+ * separator: Text between the base and the digits
+ * base: The base (2-36), printed in decimal
+ * value: The number to write in base, or NULL
+ */
+void output_result_line(OutputBuffer *out, const char *prefix,
+                        const char *separator, int base,
+                        const unsigned long long *value)
+{
+    output_append(out, stdout, prefix, strlen(prefix));
+    output_append_digits(out, stdout, (unsigned long long)base, DECIMAL);
+    output_append(out, stdout, separator, strlen(separator));
+    if (value)
+    {
+        output_append_digits(out, stdout, *value, base);
+        output_append(out, stdout, "\n", 1);
+    }
+}
+
+/* output_expression_line()
+ * ------------------------
+ * Appends an expression between two pieces of text.
  *
- * Global variables modified: None
- * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if arguments are invalid
+ * out: Pointer to OutputBuffer to append to
+ * stream: Stream the text is for (stdout or stderr)
+ * before: Text before the expression
+ * expression: The expression (need not be null terminated)
+ * len: Number of characters in the expression
+ * after: Text after the expression
  */
-void parse_arguments(int argc, char **argv, Config *cfg)
+void output_expression_line(OutputBuffer *out, FILE *stream, const char *before,
+                            const char *expression, size_t len, const char *after)
 {
-    initialize_config(cfg);
-    // Track which arguments have been used to prevent duplicates
-    bool usedInput = false, usedOutput = false, usedFile = false;
+    output_append(out, stream, before, strlen(before));
+    output_append(out, stream, expression, len);
+    output_append(out, stream, after, strlen(after));
+}
 
-    // Parse each command line argument starting from index 1
-    for (int i = 1; i < argc; i++)
+/* output_base_fields()
+ * --------------------
+ * Appends one field per output base, taking the digits from a block
+ * written by format_all_bases(). All of the fields are built in a single
+ * reservation of the buffer.
+ *
+ * out: Pointer to OutputBuffer to append to
+ * fields: How each field is framed
+ * bases: The output bases (2-36)
+ * count: Number of output bases
+ * digits: The digits of every base, one after another
+ * ends: The offset in digits just past each base's digits
+ */
+void output_base_fields(OutputBuffer *out, const BaseFields *fields,
+                        const int *bases, int count, const char *digits,
+                        const size_t *ends)
+{
+    if (count <= 0)
     {
-        const char *argument = argv[i];
-        // All valid arguments must start with '--'
-        if (argument[0] != '-')
+        return;
+    }
+    // Bases are at most two decimal digits
+    size_t framing = strlen(fields->before) + 2 + strlen(fields->after) +
+                     strlen(fields->separator) +
+                     (fields->between ? strlen(fields->between) : 0);
+    char *p = output_reserve(out, ends[count - 1] + (size_t)count * framing);
+    if (!p)
+    {
+        return;
+    }
+    // The framing texts are a few bytes each, too short to pay for memcpy()
+    char *start = p;
+    size_t from = 0;
+    for (int i = 0; i < count; i++)
+    {
+        for (const char *s = i > 0 ? fields->separator : ""; *s; s++)
         {
-            invalid_command_line_args();
+            *p++ = *s;
         }
-
-        if (strcmp(argument, "--inputbase") == 0)
+        for (const char *s = fields->before; *s; s++)
         {
-            if (usedInput)
-            {
-                invalid_command_line_args(); // Duplicate argument
-            }
-            usedInput = true;
-            handle_inputbase_arg(argc, argv, &i, cfg);
+            *p++ = *s;
         }
-
-        else if (strcmp(argument, "--obases") == 0)
+        if (fields->between)
         {
-            if (usedOutput)
+            if (bases[i] >= DECIMAL)
             {
-                invalid_command_line_args(); // Duplicate argument
+                *p++ = DIGIT_CHARS[bases[i] / DECIMAL];
             }
-            usedOutput = true;
-            handle_obases_arg(argc, argv, &i, cfg);
-        }
-
-        else if (strcmp(argument, "--file") == 0)
-        {
-            if (usedFile)
+            *p++ = DIGIT_CHARS[bases[i] % DECIMAL];
+            for (const char *s = fields->between; *s; s++)
             {
-                invalid_command_line_args(); // Duplicate argument
+                *p++ = *s;
             }
-            usedFile = true;
-            handle_file_arg(argc, argv, &i, cfg);
         }
-
-        else
+        memcpy(p, digits + from, ends[i] - from);
+        p += ends[i] - from;
+        for (const char *s = fields->after; *s; s++)
         {
-            invalid_command_line_args(); // Unknown argument
+            *p++ = *s;
         }
+        from = ends[i];
     }
+    output_commit(out, stdout, (size_t)(p - start));
 }
 
-/* handle_inputbase_arg()
- * ----------------------
- * Processes the --inputbase command line argument.
+/* output_base_lines()
+ * -------------------
+ * Appends the "Base <base>: <digits>" lines of value in every output base,
+ * rendering all of the bases in one pass with format_all_bases().
  *
- * argc: Total number of command line arguments
- * argv: Array of command line argument strings
- * i: Pointer to current argument index (will be incremented)
- * cfg: Pointer to Config structure to modify
+ * out: Pointer to OutputBuffer to append to
+ * value: The number to write
+ * bases: The output bases (2-36)
+ * count: Number of output bases
+ */
+void output_base_lines(OutputBuffer *out, unsigned long long value,
+                       const int *bases, int count)
+{
+    char digits[MAX_BASE * FORMAT_DIGITS_BYTES];
+    size_t ends[MAX_BASE];
+    STATS_CLOCK(formatStart);
+    format_all_bases(value, bases, (size_t)count, digits, ends);
+    STATS_LAP(STATS_FORMAT, formatStart);
+    output_base_fields(out, &TEXT_BASE_FIELDS, bases, count, digits, ends);
+}
+
+/* output_append_buffer()
+ * ----------------------
+ * Appends the text of another buffer, keeping the stream of every segment.
  *
- * Global variables modified: None
- * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ * out: Pointer to OutputBuffer to append to
+ * from: Pointer to OutputBuffer to copy from
  */
-void handle_inputbase_arg(int argc, char **argv, int *i, Config *cfg)
+void output_append_buffer(OutputBuffer *out, const OutputBuffer *from)
 {
-    (*i)++; // Move from "--inputbase" to its value
-    if (*i >= argc)
+    size_t start = 0;
+    for (size_t i = 0; i < from->segmentCount; i++)
     {
-        invalid_command_line_args();
+        output_append(out, from->segments[i].stream, from->data + start,
+                      from->segments[i].end - start);
+        start = from->segments[i].end;
     }
+}
 
-    const char *baseOfInput = argv[*i];
-    if (baseOfInput[0] == '\0' || !digits_only(baseOfInput))
+/* output_printf()
+ * ---------------
+ * Formats text like fprintf() and appends it to the buffer, to be written
+ * to stream by output_flush().
+ *
+ * out: Pointer to OutputBuffer to append to
+ * stream: Stream the text is for (stdout or stderr)
+ * format: printf-style format string
+ *
+ * Errors: Prints error message to stderr and drops the text if memory
+ * allocation fails
+ */
+void output_printf(OutputBuffer *out, FILE *stream, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(out->data ? out->data + out->len : NULL,
+                           out->capacity - out->len, format, args);
+    va_end(args);
+    if (needed < 0)
     {
-        invalid_command_line_args();
+        return;
     }
 
-    int base = (int)strtol(baseOfInput, NULL, DECIMAL);
-    if (!in_range(base))
+    // Grow the buffer and format again if the text did not fit
+    if (out->len + (size_t)needed + 1 > out->capacity)
     {
-        invalid_command_line_args();
+        if (!output_reserve(out, (size_t)needed + 1))
+        {
+            return;
+        }
+        va_start(args, format);
+        vsnprintf(out->data + out->len, out->capacity - out->len, format, args);
+        va_end(args);
     }
+    output_commit(out, stream, (size_t)needed);
+}
 
-    cfg->haveInputBase = true;
-    cfg->inputBase = base;
+/* output_append_le()
+ * ------------------
+ * Appends the low bytes of value as a little-endian integer for stdout.
+ *
+ * out: Pointer to OutputBuffer to append to
+ * value: The integer to write
+ * bytes: Number of bytes to write (1-8)
+ */
+void output_append_le(OutputBuffer *out, unsigned long long value, int bytes)
+{
+    char *p = output_reserve(out, (size_t)bytes);
+    if (p)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            p[i] = (char)(value >> (8 * i));
+        }
+        output_commit(out, stdout, (size_t)bytes);
+    }
 }
 
-/* handle_obases_arg()
- * -------------------
- * Processes the --obases command line argument.
+/* utf8_sequence_length()
+ * ----------------------
+ * Checks the UTF-8 sequence that starts with a byte of 0x80 or above,
+ * rejecting overlong forms, surrogates and code points above U+10FFFF.
  *
- * argc: Total number of command line arguments
- * argv: Array of command line argument strings
- * i: Pointer to current argument index (will be incremented)
- * cfg: Pointer to Config structure to modify
+ * s: The sequence
+ * avail: Number of bytes available at s
  *
- * Global variables modified: None
- * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
- * REF: This function was developed with assistance from Cursor for
- * REF: processing and validating command line output base arguments.
+ * Returns: The length of the sequence (2-4), or 0 if it is not valid UTF-8
  */
-void handle_obases_arg(int argc, char **argv, int *i, Config *cfg)
+int utf8_sequence_length(const unsigned char *s, size_t avail)
 {
-    (*i)++; // Move from "--obases" to its value
-    if (*i >= argc)
+    int length;
+    unsigned char low = 0x80, high = 0xBF; // Range of the second byte
+    if (s[0] >= 0xC2 && s[0] <= 0xDF)
     {
-        invalid_command_line_args();
+        length = 2;
+    }
+    else if (s[0] >= 0xE0 && s[0] <= 0xEF)
+    {
+        length = 3;
+        low = s[0] == 0xE0 ? 0xA0 : 0x80;
+        high = s[0] == 0xED ? 0x9F : 0xBF;
+    }
+    else if (s[0] >= 0xF0 && s[0] <= 0xF4)
+    {
+        length = 4;
+        low = s[0] == 0xF0 ? 0x90 : 0x80;
+        high = s[0] == 0xF4 ? 0x8F : 0xBF;
+    }
+    else
+    {
+        return 0;
     }
 
-    const char *basesOfOutput = argv[*i];
-    if (basesOfOutput[0] == '\0')
+    if (avail < (size_t)length || s[1] < low || s[1] > high)
     {
-        invalid_command_line_args();
+        return 0;
     }
-    output_bases_parse(basesOfOutput, cfg);
+    for (int i = 2; i < length; i++)
+    {
+        if ((s[i] & 0xC0) != 0x80)
+        {
+            return 0;
+        }
+    }
+    return length;
 }
 
-/* handle_file_arg()
- * -----------------
- * Processes the --file command line argument.
+/* output_escaped()
+ * ----------------
+ * Appends an expression for stdout so that it cannot break a JSON string
+ * or a TSV field. For JSON, quotes, backslashes and control characters are
+ * escaped and every byte that is not part of valid UTF-8 becomes U+FFFD.
+ * For TSV, tabs, newlines, carriage returns and backslashes get the usual
+ * \t, \n, \r and \\ escapes and other control characters become '?'.
  *
- * argc: Total number of command line arguments
- * argv: Array of command line argument strings
- * i: Pointer to current argument index (will be incremented)
- * cfg: Pointer to Config structure to modify
+ * out: Pointer to OutputBuffer to append to
+ * expression: The expression (need not be null terminated)
+ * len: Number of characters in the expression
+ * json: Whether to escape for a JSON string rather than a TSV field
+ */
+void output_escaped(OutputBuffer *out, const char *expression, size_t len, bool json)
+{
+    const unsigned char *text = (const unsigned char *)expression;
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char ch = text[i];
+        if (ch >= ' ' && ch < 0x80 && ch != '\\' && (ch != '"' || !json))
+        {
+            continue;
+        }
+        if (ch >= 0x80)
+        {
+            int length = json ? utf8_sequence_length(text + i, len - i) : 1;
+            if (length)
+            {
+                i += (size_t)length - 1;
+                continue;
+            }
+        }
+        output_append(out, stdout, expression + start, i - start);
+        start = i + 1;
+        if (ch == '\\' || ch == '"')
+        {
+            char escape[2] = {'\\', (char)ch};
+            output_append(out, stdout, escape, 2);
+        }
+        else if (ch == '\t' || ch == '\n' || ch == '\r')
+        {
+            char escape[2] = {'\\', ch == '\t' ? 't' : ch == '\n' ? 'n' : 'r'};
+            output_append(out, stdout, escape, 2);
+        }
+        else if (ch >= 0x80)
+        {
+            output_append(out, stdout, "\\ufffd", 6);
+        }
+        else if (json)
+        {
+            output_printf(out, stdout, "\\u%04x", ch);
+        }
+        else
+        {
+            output_append(out, stdout, "?", 1);
+        }
+    }
+    output_append(out, stdout, expression + start, len - start);
+}
+
+/* write_iovecs()
+ * --------------
+ * Writes a batch of buffers to a file descriptor with writev(), retrying
+ * after partial writes and interrupted calls.
  *
- * Global variables modified: None
- * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ * fd: The file descriptor to write to
+ * iov: The buffers to write (modified)
+ * count: Number of buffers
+ *
+ * Errors: Gives up silently if the descriptor reports an error (for
+ * example a closed pipe)
  */
-void handle_file_arg(int argc, char **argv, int *i, Config *cfg)
+void write_iovecs(int fd, struct iovec *iov, int count)
 {
-    (*i)++; // Move from "--file" to its value
-    if (*i >= argc)
+    while (count > 0)
     {
-        invalid_command_line_args();
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        // Skip the buffers that were written completely
+        while (count > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
     }
+}
 
-    const char *inputFileName = argv[*i];
-    if (inputFileName[0] == '\0')
+/* output_write_all()
+ * ------------------
+ * Writes the segments of several buffers, in order, straight to the file
+ * descriptors of their streams, and empties the buffers. Consecutive
+ * segments for the same stream are gathered into a single writev(). Any
+ * text still in stdout's stdio buffer is flushed before the first stdout
+ * write so that it keeps its place.
+ *
+ * buffers: The buffers to write, in output order
+ * count: Number of buffers
+ */
+void output_write_all(OutputBuffer **buffers, size_t count)
+{
+    struct iovec iov[OUTPUT_IOV_BATCH];
+    int iovCount = 0;
+    FILE *pending = NULL; // Stream of the buffers gathered in iov
+    STATS_CLOCK(writeStart);
+
+    for (size_t b = 0; b < count; b++)
     {
-        invalid_command_line_args();
+        OutputBuffer *out = buffers[b];
+        size_t start = 0;
+        for (size_t i = 0; i < out->segmentCount; i++)
+        {
+            FILE *stream = out->segments[i].stream;
+            if (iovCount > 0 && (stream != pending || iovCount == OUTPUT_IOV_BATCH))
+            {
+                write_iovecs(fileno(pending), iov, iovCount);
+                iovCount = 0;
+            }
+            if (iovCount == 0 && stream == stdout)
+            {
+                fflush(stdout);
+            }
+            pending = stream;
+            iov[iovCount].iov_base = out->data + start;
+            iov[iovCount].iov_len = out->segments[i].end - start;
+            iovCount++;
+            start = out->segments[i].end;
+        }
     }
+    if (iovCount > 0)
+    {
+        write_iovecs(fileno(pending), iov, iovCount);
+    }
+    STATS_LAP(STATS_WRITE, writeStart);
 
-    cfg->fileName = inputFileName;
-    cfg->haveFile = true;
+    for (size_t b = 0; b < count; b++)
+    {
+        buffers[b]->len = 0;
+        buffers[b]->segmentCount = 0;
+    }
 }
 
-/* output_bases_parse()
- * --------------------
- * Parses a comma-separated string of output bases and validates them.
+/* output_flush()
+ * --------------
+ * Writes every buffered segment to its stream in order and empties the
+ * buffer (see output_write_all()).
  *
- * basesOfOutput: Comma-separated string of base numbers (e.g., "2,8,16")
- * cfg: Pointer to Config structure to populate with parsed bases
+ * out: Pointer to OutputBuffer to write out
+ */
+void output_flush(OutputBuffer *out)
+{
+    output_write_all(&out, 1);
+}
+
+/* file_input_open()
+ * -----------------
+ * Prepares an open file for reading. Non-empty regular files are mapped
+ * read-only with sequential read-ahead advice, starting from the current
+ * position, which an inherited stdin may already be past; everything else
+ * is left to be streamed.
  *
- * Global variables modified: None
- * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if bases are invalid
- * REF: This function was developed with assistance from Cursor for
- * REF: parsing and validating comma-separated output base specifications.
+ * in: Pointer to FileInput structure to initialize
+ * file: The open input file
  */
-void output_bases_parse(const char *basesOfOutput, Config *cfg)
+void file_input_open(FileInput *in, FILE *file)
 {
-    size_t n = strlen(basesOfOutput);
-    // Check for empty string or trailing/leading commas
-    if (n == 0 || basesOfOutput[n - 1] == ',' || basesOfOutput[0] == ',')
+    in->file = file;
+    in->map = NULL;
+    in->mapLen = 0;
+    in->offset = 0;
+    in->block = NULL;
+    in->blockCapacity = 0;
+    in->blockStart = 0;
+    in->blockLen = 0;
+    in->ended = false;
+
+    struct stat info;
+    if (fstat(fileno(file), &info) != 0 || !S_ISREG(info.st_mode) ||
+        info.st_size <= 0 || (unsigned long long)info.st_size > SIZE_MAX)
     {
-        invalid_command_line_args();
+        return;
     }
+    void *map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE,
+                     fileno(file), 0);
+    if (map == MAP_FAILED)
+    {
+        return; // Fall back to streaming
+    }
+    madvise(map, (size_t)info.st_size, MADV_SEQUENTIAL);
+    in->map = map;
+    in->mapLen = (size_t)info.st_size;
+    off_t position = lseek(fileno(file), 0, SEEK_CUR);
+    if (position > 0 && position <= info.st_size)
+    {
+        in->offset = (size_t)position;
+    }
+}
 
-    // Check for consecutive commas which are invalid
-    for (size_t i = 1; i < n; i++)
+/* file_input_close()
+ * ------------------
+ * Releases the mapping or stream buffer of a FileInput. The file itself
+ * is left open.
+ *
+ * in: Pointer to FileInput structure to release
+ */
+void file_input_close(FileInput *in)
+{
+    if (in->map)
     {
-        if (basesOfOutput[i] == ',' && basesOfOutput[i - 1] == ',')
+        munmap((void *)in->map, in->mapLen);
+        in->map = NULL;
+    }
+    free(in->block);
+    in->block = NULL;
+    in->blockCapacity = 0;
+    in->blockStart = 0;
+    in->blockLen = 0;
+}
+
+/* file_input_fill()
+ * -----------------
+ * Reads the next block of a streamed input. The bytes not yet consumed are
+ * first moved to the front of the buffer, which doubles whenever less than
+ * FILE_READ_BYTES would be left free, so a line of any length fits.
+ *
+ * in: Pointer to the FileInput to read from
+ *
+ * Returns: true if more bytes were read, false at end of input
+ * Errors: Prints error message to stderr and ends the input if memory
+ * allocation fails; a read error also ends the input
+ */
+bool file_input_fill(FileInput *in)
+{
+    if (in->ended)
+    {
+        return false;
+    }
+    if (in->blockStart > 0)
+    {
+        memmove(in->block, in->block + in->blockStart, in->blockLen - in->blockStart);
+        in->blockLen -= in->blockStart;
+        in->blockStart = 0;
+    }
+    if (in->blockCapacity - in->blockLen < FILE_READ_BYTES)
+    {
+        size_t capacity = in->blockCapacity ? in->blockCapacity * 2 : FILE_READ_BYTES;
+        if (capacity - in->blockLen < FILE_READ_BYTES)
         {
-            invalid_command_line_args();
+            capacity = in->blockLen + FILE_READ_BYTES;
+        }
+        char *grown = realloc(in->block, capacity);
+        if (!grown)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            in->ended = true;
+            return false;
         }
+        in->block = grown;
+        in->blockCapacity = capacity;
     }
 
-    // Parse comma-separated base values
-    char *parsing = strdup(basesOfOutput);
-    char *token = strtok(parsing, ",");
-    cfg->oBasesCount = 0;
-
-    // Track which bases we've seen to prevent duplicates
-    bool seen[MAX_BASE + 1] = {false};
-    while (token)
+    while (1)
     {
-        // Ensure token contains only digits
-        if (digits_only(token) == false)
+        ssize_t n = read(fileno(in->file), in->block + in->blockLen,
+                         in->blockCapacity - in->blockLen);
+        if (n > 0)
         {
-            free(parsing);
-            invalid_command_line_args();
+            in->blockLen += (size_t)n;
+            return true;
         }
-
-        int base = (int)strtol(token, NULL, DECIMAL);
-        // Check for valid range, duplicates, and capacity limits
-        if ((!in_range(base) || seen[base] || cfg->oBasesCount >= MAX_BASE))
+        if (n < 0 && errno == EINTR)
         {
-            free(parsing);
-            invalid_command_line_args();
+            continue;
         }
-        seen[base] = true;
-        cfg->oBases[cfg->oBasesCount++] = base;
-        token = strtok(NULL, ",");
+        in->ended = true;
+        return false;
     }
-    free(parsing);
 }
 
-/* program_startup()
- * -----------------
- * Displays the program welcome message and current configuration.
+/* file_input_find_newline()
+ * -------------------------
+ * Finds the end of the next line of a streamed input, reading more blocks
+ * until the buffer holds a newline or the input ends. Bytes already
+ * searched are not searched again after a read.
  *
- * cfg: Pointer to Config structure containing current settings
+ * in: Pointer to the FileInput to read from
  *
- * Returns: Nothing (void)
+ * Returns: Offset from in->blockStart of the newline, or the number of
+ *          bytes left if the input ended without one
  */
-void program_startup(const Config *cfg)
+size_t file_input_find_newline(FileInput *in)
 {
-    if (!cfg->haveFile)
+    size_t searched = 0;
+    while (1)
     {
-        clear_screen();
+        size_t pending = in->blockLen - in->blockStart;
+        const char *start = in->block + in->blockStart;
+        const char *newline =
+            pending > searched ? memchr(start + searched, '\n', pending - searched) : NULL;
+        if (newline)
+        {
+            return (size_t)(newline - start);
+        }
+        searched = pending;
+        if (!file_input_fill(in))
+        {
+            return pending;
+        }
     }
-    printf("Welcome to uqbasejump.\n");
-    printf("This program was written by s4983508.\n");
-    printf("Input base: %d\n", cfg->inputBase);
-    printf("Output bases: ");
-    for (int i = 0; i < cfg->oBasesCount; i++)
+}
+
+/* file_input_next_line()
+ * ----------------------
+ * Fetches the next line of the input as a view: mapped lines point into
+ * the mapping, streamed lines into the stream buffer, where they stay
+ * valid until the next call.
+ *
+ * in: Pointer to the FileInput to read from
+ * line: Receives the start of the line
+ * len: Receives the length of the expression (see trimmed_line_length())
+ *
+ * Returns: true if a line was read, false at end of input
+ */
+bool file_input_next_line(FileInput *in, const char **line, size_t *len)
+{
+    if (!in->map)
     {
-        if (i > 0)
+        size_t newline = file_input_find_newline(in);
+        size_t pending = in->blockLen - in->blockStart;
+        if (pending == 0)
         {
-            printf(", ");
+            return false;
         }
-        printf("%d", cfg->oBases[i]);
+        size_t rawLen = newline < pending ? newline + 1 : pending;
+        *line = in->block + in->blockStart;
+        *len = trimmed_line_length(*line, rawLen);
+        in->blockStart += rawLen;
+        return true;
     }
-    printf("\n");
-    if (!cfg->haveFile)
+
+    if (in->offset >= in->mapLen)
     {
-        printf("Please enter your numbers and expressions.\n");
-        fflush(stdout);
+        return false;
     }
+    const char *start = in->map + in->offset;
+    size_t remaining = in->mapLen - in->offset;
+    const char *newline = memchr(start, '\n', remaining);
+    size_t rawLen = newline ? (size_t)(newline - start) + 1 : remaining;
+    in->offset += rawLen;
+    *line = start;
+    *len = trimmed_line_length(start, rawLen);
+    return true;
 }
 
-/* add_history()
- * -------------
- * Adds a new entry to the calculation history.
+/* file_input_next_chunk()
+ * -----------------------
+ * Fetches the next run of whole lines for a worker. A mapped chunk is a
+ * view of about FILE_CHUNK_BYTES of the mapping, extended to the end of
+ * its last line, whose pages are requested with MADV_WILLNEED so they are
+ * read in while earlier chunks are evaluated; a streamed chunk copies the
+ * whole lines already read, up to about FILE_CHUNK_BYTES of them, into the
+ * chunk's own buffer in one go. A stream is only read when not even one line is buffered, so a
+ * slow producer's lines are passed on as soon as they arrive.
  *
- * cfg: Pointer to Config structure containing history
- * expression: The mathematical expression string (must not be NULL)
- * base: The base used for the expression
- * result: The calculated result value
+ * in: Pointer to the FileInput to read from
+ * chunk: The chunk to fill (data and len are set)
  *
- * Global variables modified: cfg->history, cfg->historyCount,
- * cfg->historyCapacity Errors: Prints error message to stderr if memory
+ * Returns: true if the chunk holds at least one line, false at end of input
+ * Errors: Prints error message to stderr and stops reading if memory
  * allocation fails
  */
-void add_history(Config *cfg, const char *expression, int base,
-                 unsigned long long result)
+bool file_input_next_chunk(FileInput *in, FileChunk *chunk)
+{
+    chunk->len = 0;
+    if (in->map)
+    {
+        if (in->offset >= in->mapLen)
+        {
+            return false;
+        }
+        const char *start = in->map + in->offset;
+        size_t remaining = in->mapLen - in->offset;
+        size_t len = remaining < FILE_CHUNK_BYTES ? remaining : FILE_CHUNK_BYTES;
+        const char *newline = memchr(start + len - 1, '\n', remaining - len + 1);
+        len = newline ? (size_t)(newline - start) + 1 : remaining;
+        in->offset += len;
+        // Start reading the chunk's pages in before a worker touches them
+        uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t first = (uintptr_t)start & ~(page - 1);
+        madvise((void *)first, (uintptr_t)(start + len) - first, MADV_WILLNEED);
+        chunk->data = start;
+        chunk->len = len;
+        return true;
+    }
+
+    size_t newline = file_input_find_newline(in);
+    size_t pending = in->blockLen - in->blockStart;
+    if (pending == 0)
+    {
+        return false;
+    }
+    const char *start = in->block + in->blockStart;
+    size_t len = newline < pending ? newline + 1 : pending;
+    if (len < FILE_CHUNK_BYTES && len < pending)
+    {
+        // Every other whole line that is already buffered, within the limit
+        size_t limit = pending < FILE_CHUNK_BYTES ? pending : FILE_CHUNK_BYTES;
+        const char *last = memrchr(start, '\n', limit);
+        len = (size_t)(last - start) + 1;
+    }
+    if (len > chunk->textCapacity)
+    {
+        char *text = realloc(chunk->text, len);
+        if (!text)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return false;
+        }
+        chunk->text = text;
+        chunk->textCapacity = len;
+    }
+    memcpy(chunk->text, start, len);
+    in->blockStart += len;
+    chunk->data = chunk->text;
+    chunk->len = len;
+    return true;
+}
+
+/* file_expr_evaluation_display()
+ * ------------------------------
+ * Evaluates a mathematical expression and displays the result in multiple
+ * bases. Used for file-based input processing. The text is appended to out
+ * rather than printed, so this may run on any thread.
+ *
+ * out: Pointer to OutputBuffer to receive the display
+ * arena: Scratch arena for the evaluation (reset by the caller)
+ * cache: Result cache of the calling thread, or NULL for none
+ * expression: The mathematical expression to evaluate (need not be null
+ * terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of the input expression (2-36)
+ * oBasesCount: Number of output bases to display
+ * oBases: Array of output bases to display results in
+ * precision: Arithmetic used to evaluate the expression
+ *
+ * Returns: Nothing (void)
+ * Errors: Adds an error message for stderr if expression cannot be evaluated
+ * REF: This function was developed with assistance from Cursor for
+ * REF: implementing file-based mathematical expression evaluation and
+ * multi-base output display.
+ */
+void file_expr_evaluation_display(OutputBuffer *out, Arena *arena,
+                                  ResultCache *cache, const char *expression,
+                                  size_t len, int inputBase, int oBasesCount,
+                                  const int *oBases, Precision precision)
+{
+    if (precision == PRECISION_BIG)
+    {
+        BigInt bigResult;
+        bigint_init(&bigResult);
+        STATS_COUNT(expressions);
+        if (expression_precheck(expression, len, inputBase) != 0 ||
+            evaluate_expression_big_arena(arena, expression, len, inputBase, &bigResult) != 0)
+        {
+            stats_reject(rejection_reason(expression, len, inputBase));
+            output_expression_line(out, stderr, "Cannot evaluate the expression \"",
+                                   expression, len, "\"\n");
+            bigint_free(&bigResult);
+            return;
+        }
+        output_result_line(out, "Expression (base ", "): ", inputBase, NULL);
+        output_expression_line(out, stdout, "", expression, len, "\n");
+        display_big_result(out, arena, &bigResult, inputBase, oBasesCount, oBases);
+        bigint_free(&bigResult);
+        return;
+    }
+
+    RecordResult result;
+    // Numbers are tokenized straight from the input base (no decimal text)
+    int evaluateSuccessful =
+        record_evaluate(arena, cache, expression, len, inputBase, oBasesCount,
+                        oBases, precision, true, &result);
+
+    if (evaluateSuccessful != 0)
+    { // != 0 means unsuccessful (conversion or evaluation failed)
+        // Print error message to stderr
+        output_expression_line(out, stderr, "Cannot evaluate the expression \"",
+                               expression, len, "\"\n");
+        record_result_free(&result);
+        return;
+    }
+    output_result_line(out, "Expression (base ", "): ", inputBase, NULL);
+    output_expression_line(out, stdout, "", expression, len, "\n");
+
+    // Digits are formatted (or copied from the cache) into the output buffer
+    output_result_line(out, "Result (base ", "): ", inputBase, NULL);
+    output_record_digits(out, arena, &result, 0, inputBase, false);
+    output_append(out, stdout, "\n", 1);
+    if (result.rendered)
+    {
+        output_base_fields(out, &TEXT_BASE_FIELDS, oBases, oBasesCount, result.digits,
+                           result.digitEnds);
+        record_result_free(&result);
+        return;
+    }
+    for (int i = 0; i < oBasesCount; i++)
+    {
+        output_result_line(out, "Base ", ": ", oBases[i], NULL);
+        output_record_digits(out, arena, &result, i + 1, oBases[i], false);
+        output_append(out, stdout, "\n", 1);
+    }
+    record_result_free(&result);
+}
+
+/* display_big_result()
+ * --------------------
+ * Prints an arbitrary-precision result in the input base and in every
+ * output base, in the same layout as the fixed-precision display.
+ *
+ * out: Pointer to OutputBuffer to receive the display
+ * arena: Scratch arena for the digit strings, or NULL to use the heap
+ * result: The value to display
+ * inputBase: The base of the input expression (2-36)
+ * oBasesCount: Number of output bases to display
+ * oBases: Array of output bases to display results in
+ *
+ * Returns: Nothing (void)
+ */
+void display_big_result(OutputBuffer *out, Arena *arena, const BigInt *result,
+                        int inputBase, int oBasesCount, const int *oBases)
+{
+    STATS_CLOCK(formatStart);
+    char *resultInInputBase = bigint_to_str_arena(arena, result, inputBase);
+    output_printf(out, stdout, "Result (base %d): %s\n", inputBase,
+                  resultInInputBase ? resultInInputBase : "0");
+    arena_release(arena, resultInInputBase);
+
+    for (int i = 0; i < oBasesCount; i++)
+    {
+        int base = oBases[i];
+        char *output = bigint_to_str_arena(arena, result, base);
+        output_printf(out, stdout, "Base %d: %s\n", base, output ? output : "0");
+        arena_release(arena, output);
+    }
+    STATS_LAP(STATS_FORMAT, formatStart);
+}
+
+/* record_evaluate()
+ * -----------------
+ * Evaluates an expression for display, consulting the calling thread's
+ * result cache first when there is one. With double precision a miss
+ * evaluates the expression and caches its status and value, and, if
+ * render is set, its digits in the input base and every output base, so
+ * a repeated expression costs one hash lookup and some copies.
+ * Big precision is never cached.
+ *
+ * A miss, and every big precision line, first goes through
+ * expression_precheck(), so malformed lines are neither parsed nor
+ * cached. Without a cache the pre-pass is skipped: the tokenizer's single
+ * pass finds a bad character as early, and its token array comes from the
+ * arena, so the pre-pass would only add work to every valid line.
+ *
+ * arena: Scratch arena of the calling thread
+ * cache: Result cache of the calling thread, or NULL
+ * expression: The expression to evaluate (need not be null terminated)
+ * len: Number of characters in expression
+ * inputBase: The base of the input expression (2-36)
+ * oBasesCount: Number of output bases to display
+ * oBases: Array of output bases to display results in
+ * precision: Arithmetic used to evaluate the expression
+ * render: Whether the caller displays digits
+ * result: Receives the result; release it with record_result_free()
+ *
+ * Returns: 0 if successful, 1 if the expression cannot be evaluated
+ */
+int record_evaluate(Arena *arena, ResultCache *cache, const char *expression,
+                    size_t len, int inputBase, int oBasesCount,
+                    const int *oBases, Precision precision, bool render,
+                    RecordResult *result)
+{
+    result->precision = precision;
+    result->value = 0;
+    result->cached = NULL;
+    result->rendered = false;
+    bigint_init(&result->big);
+    STATS_COUNT(expressions);
+    if (precision == PRECISION_BIG)
+    {
+        if (expression_precheck(expression, len, inputBase) != 0 ||
+            evaluate_expression_big_arena(arena, expression, len, inputBase,
+                                          &result->big) != 0)
+        {
+            stats_reject(eval_failure());
+            return 1;
+        }
+        return 0;
+    }
+
+    char key[RESULT_CACHE_MAX_KEY];
+    size_t keyLen = cache ? result_cache_normalize(expression, len, key) : 0;
+    uint64_t hash = 0;
+    if (keyLen > 0)
+    {
+        hash = result_cache_hash(inputBase, key, keyLen);
+        ResultCacheEntry *entry = result_cache_lookup(cache, inputBase, key, keyLen, hash);
+        if (entry)
+        {
+            STATS_COUNT(cacheHits);
+            result->value = entry->value;
+            result->cached = entry;
+            if (entry->status != 0)
+            {
+                stats_reject((EvalFailure)(entry->status - 1));
+                return 1;
+            }
+            return 0;
+        }
+        // Junk found here is not cached, so it cannot evict real entries
+        if (expression_precheck(expression, len, inputBase) != 0)
+        {
+            stats_reject(eval_failure());
+            return 1;
+        }
+    }
+
+    int status;
+    if (precision == PRECISION_INT)
+    {
+        status = evaluate_expression_int_arena(arena, expression, len, inputBase,
+                                               &result->value, &result->big);
+        if (status == EVAL_WIDE)
+        {
+            // Too wide for a cache entry; the digits come from the bignum
+            result->precision = PRECISION_BIG;
+            return 0;
+        }
+    }
+    else
+    {
+        status = evaluate_expression_in_base_arena(arena, expression, len, inputBase,
+                                                   &result->value) != 0;
+    }
+    EvalFailure reason = EVAL_FAILURE_CONVERSION;
+    if (status != 0)
+    {
+        reason = rejection_reason(expression, len, inputBase);
+        stats_reject(reason);
+    }
+    if (status == 0 && render)
+    {
+        // Every output base is rendered in one pass over the value
+        STATS_CLOCK(formatStart);
+        format_all_bases(result->value, oBases, (size_t)oBasesCount,
+                         result->digits, result->digitEnds);
+        STATS_LAP(STATS_FORMAT, formatStart);
+        result->rendered = true;
+    }
+    if (keyLen > 0)
+    {
+        // A failure is cached with its reason, so hits count it again
+        int cachedStatus = status != 0 ? 1 + (int)reason : 0;
+        ResultCacheEntry *entry = result_cache_insert(cache, inputBase, key, keyLen,
+                                                      hash, cachedStatus, result->value);
+        if (entry && status == 0 && render)
+        {
+            char digitBuffer[FORMAT_DIGITS_BYTES];
+            char *end = digitBuffer + sizeof(digitBuffer);
+            char *digits = format_digits(result->value, inputBase, end);
+            result_cache_add_digits(entry, digits, (size_t)(end - digits));
+            for (int i = 0; i < oBasesCount; i++)
+            {
+                size_t from = i ? result->digitEnds[i - 1] : 0;
+                result_cache_add_digits(entry, result->digits + from,
+                                        result->digitEnds[i] - from);
+            }
+        }
+        result->cached = entry;
+    }
+    return status;
+}
+
+/* record_result_free()
+ * --------------------
+ * Releases the memory held by a result from record_evaluate().
+ *
+ * result: The result to release
+ */
+void record_result_free(RecordResult *result)
+{
+    bigint_free(&result->big);
+}
+
+/* output_record_digits()
+ * ----------------------
+ * Appends the digits of a result from record_evaluate() in base,
+ * optionally preceded by their count as a 32-bit little-endian integer.
+ * Digits that were cached, or rendered for every output base by
+ * record_evaluate(), are copied rather than formatted again.
+ *
+ * out: Pointer to OutputBuffer to append to
+ * arena: Scratch arena for big digit strings
+ * result: The result to write
+ * index: 0 for the input base, i + 1 for output base i, which selects the
+ *        cached digit string
+ * base: The base to write the digits in (2-36)
+ * lengthPrefix: Whether to prefix the digits with their length
+ */
+void output_record_digits(OutputBuffer *out, Arena *arena, const RecordResult *result,
+                          int index, int base, bool lengthPrefix)
+{
+    char digitBuffer[64];
+    const char *digits = NULL;
+    char *bigDigits = NULL;
+    size_t len = 0;
+    STATS_CLOCK(formatStart);
+    if (result->precision == PRECISION_BIG)
+    {
+        bigDigits = bigint_to_str_arena(arena, &result->big, base);
+        digits = bigDigits ? bigDigits : "0";
+        len = strlen(digits);
+        STATS_LAP(STATS_FORMAT, formatStart);
+    }
+    else if (result->rendered && index > 0)
+    {
+        size_t from = index > 1 ? result->digitEnds[index - 2] : 0;
+        digits = result->digits + from;
+        len = result->digitEnds[index - 1] - from;
+    }
+    else if (!result->cached ||
+             !(digits = result_cache_digits(result->cached, index, &len)))
+    {
+        digits = format_digits(result->value, base, digitBuffer + sizeof(digitBuffer));
+        len = (size_t)(digitBuffer + sizeof(digitBuffer) - digits);
+        STATS_LAP(STATS_FORMAT, formatStart);
+    }
+    if (lengthPrefix)
+    {
+        output_append_le(out, (unsigned long long)len, 4);
+    }
+    output_append(out, stdout, digits, len);
+    arena_release(arena, bigDigits);
+}
+
+/* jsonl_expr_record()
+ * -------------------
+ * --format jsonl: appends one JSON object per expression, such as
+ * {"expr":"7*6","ok":true,"result":"42","bases":{"2":"101010","16":"2A"}}
+ * or {"expr":"1/0","ok":false}. Digits are strings so that big results
+ * survive JSON parsers. Same parameters as file_expr_evaluation_display().
+ */
+void jsonl_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                       const char *expression, size_t len, int inputBase,
+                       int oBasesCount, const int *oBases, Precision precision)
+{
+    RecordResult result;
+    int status = record_evaluate(arena, cache, expression, len, inputBase,
+                                 oBasesCount, oBases, precision, true, &result);
+
+    output_append(out, stdout, "{\"expr\":\"", 9);
+    output_escaped(out, expression, len, true);
+    if (status != 0)
+    {
+        output_append(out, stdout, "\",\"ok\":false}\n", 14);
+        record_result_free(&result);
+        return;
+    }
+    output_append(out, stdout, "\",\"ok\":true,\"result\":\"", 22);
+    output_record_digits(out, arena, &result, 0, inputBase, false);
+    output_append(out, stdout, "\",\"bases\":{", 11);
+    if (result.rendered)
+    {
+        output_base_fields(out, &JSON_BASE_FIELDS, oBases, oBasesCount, result.digits,
+                           result.digitEnds);
+    }
+    for (int i = 0; !result.rendered && i < oBasesCount; i++)
+    {
+        output_append(out, stdout, i ? ",\"" : "\"", i ? 2 : 1);
+        output_append_digits(out, stdout, (unsigned long long)oBases[i], DECIMAL);
+        output_append(out, stdout, "\":\"", 3);
+        output_record_digits(out, arena, &result, i + 1, oBases[i], false);
+        output_append(out, stdout, "\"", 1);
+    }
+    output_append(out, stdout, "}}\n", 3);
+    record_result_free(&result);
+}
+
+/* tsv_expr_record()
+ * -----------------
+ * --format tsv: appends one tab separated line per expression: the
+ * expression, OK, the result in the input base and then its digits in
+ * every output base, in --obases order; or the expression and ERR,
+ * followed by empty fields so that every line has the same number of
+ * columns. Same parameters as file_expr_evaluation_display().
+ */
+void tsv_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                     const char *expression, size_t len, int inputBase,
+                     int oBasesCount, const int *oBases, Precision precision)
+{
+    RecordResult result;
+    int status = record_evaluate(arena, cache, expression, len, inputBase,
+                                 oBasesCount, oBases, precision, true, &result);
+
+    output_escaped(out, expression, len, false);
+    if (status != 0)
+    {
+        output_append(out, stdout, "\tERR\t", 5);
+        for (int i = 0; i < oBasesCount; i++)
+        {
+            output_append(out, stdout, "\t", 1);
+        }
+        output_append(out, stdout, "\n", 1);
+        record_result_free(&result);
+        return;
+    }
+    output_append(out, stdout, "\tOK\t", 4);
+    output_record_digits(out, arena, &result, 0, inputBase, false);
+    if (result.rendered)
+    {
+        output_base_fields(out, &TSV_BASE_FIELDS, oBases, oBasesCount, result.digits,
+                           result.digitEnds);
+    }
+    for (int i = 0; !result.rendered && i < oBasesCount; i++)
+    {
+        output_append(out, stdout, "\t", 1);
+        output_record_digits(out, arena, &result, i + 1, oBases[i], false);
+    }
+    output_append(out, stdout, "\n", 1);
+    record_result_free(&result);
+}
+
+/* binary_record()
+ * ---------------
+ * Appends one fixed layout binary record, all integers little-endian:
+ *
+ *   u8 status   RECORD_ERROR, RECORD_U64 or RECORD_BIG
+ *   RECORD_U64: u64 value
+ *   RECORD_BIG: u32 n, then the n byte magnitude, least significant first
+ *   with digits, unless RECORD_ERROR, for each output base in order:
+ *               u32 n, then n ASCII digits
+ *
+ * withDigits: Whether to append the digits in every output base
+ * Other parameters: as for file_expr_evaluation_display()
+ */
+void binary_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                   const char *expression, size_t len, int inputBase,
+                   int oBasesCount, const int *oBases, Precision precision,
+                   bool withDigits)
+{
+    RecordResult result;
+    if (record_evaluate(arena, cache, expression, len, inputBase, oBasesCount,
+                        oBases, precision, withDigits, &result) != 0)
+    {
+        output_append_le(out, RECORD_ERROR, 1);
+        record_result_free(&result);
+        return;
+    }
+
+    if (result.precision == PRECISION_BIG)
+    {
+        size_t bytes = (bigint_bit_length(&result.big) + 7) / 8;
+        const BigLimb *limbs = bigint_limbs_const(&result.big);
+        output_append_le(out, RECORD_BIG, 1);
+        output_append_le(out, (unsigned long long)bytes, 4);
+        char *p = output_reserve(out, bytes);
+        if (p)
+        {
+            for (size_t i = 0; i < bytes; i++)
+            {
+                p[i] = (char)(limbs[i / sizeof(BigLimb)] >> (8 * (i % sizeof(BigLimb))));
+            }
+            output_commit(out, stdout, bytes);
+        }
+    }
+    else
+    {
+        output_append_le(out, RECORD_U64, 1);
+        output_append_le(out, result.value, 8);
+    }
+
+    for (int i = 0; withDigits && i < oBasesCount; i++)
+    {
+        output_record_digits(out, arena, &result, i + 1, oBases[i], true);
+    }
+    record_result_free(&result);
+}
+
+/* binary_expr_record()
+ * --------------------
+ * --format binary: binary_record() without digits. Same parameters as
+ * file_expr_evaluation_display().
+ */
+void binary_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                        const char *expression, size_t len, int inputBase,
+                        int oBasesCount, const int *oBases, Precision precision)
+{
+    binary_record(out, arena, cache, expression, len, inputBase, oBasesCount,
+                  oBases, precision, false);
+}
+
+/* binary_digits_expr_record()
+ * ---------------------------
+ * --format binary-digits: binary_record() with the digits in every output
+ * base. Same parameters as file_expr_evaluation_display().
+ */
+void binary_digits_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                               const char *expression, size_t len, int inputBase,
+                               int oBasesCount, const int *oBases,
+                               Precision precision)
+{
+    binary_record(out, arena, cache, expression, len, inputBase, oBasesCount,
+                  oBases, precision, true);
+}
+
+/* format_display()
+ * ----------------
+ * Chooses how each expression is displayed for the configured --format.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * textDisplay: Display used by the current mode for --format text
+ *
+ * Returns: The display function
+ */
+ExprDisplayFn format_display(const Config *cfg, ExprDisplayFn textDisplay)
+{
+    ExprDisplayFn display = outputFormats[cfg->format].display;
+    return display ? display : textDisplay;
+}
+
+/* open_result_cache()
+ * -------------------
+ * Sets up the calling thread's result cache shard when --cache is given.
+ * Each thread that evaluates lines owns its own shard, so lookups never
+ * take a lock.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * cache: Storage for the shard
+ *
+ * Returns: cache, or NULL if caching is off or memory runs out (lines are
+ *          then simply evaluated every time)
+ */
+ResultCache *open_result_cache(const Config *cfg, ResultCache *cache)
+{
+    if (cfg->cacheEntries == 0 || result_cache_init(cache, cfg->cacheEntries) != 0)
+    {
+        return NULL;
+    }
+    return cache;
+}
+
+/* report_cache_stats()
+ * --------------------
+ * Prints the result cache counters of a run, summed over every shard, to
+ * stderr once all of its output has been written. Nothing is printed
+ * without --cache.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * stats: Counters summed over every shard used by the run
+ */
+void report_cache_stats(const Config *cfg, const ResultCacheStats *stats)
+{
+    if (cfg->cacheEntries > 0)
+    {
+        fprintf(stderr, "Cache: %zu hits, %zu misses, %zu evictions\n",
+                stats->hits, stats->misses, stats->evictions);
+    }
+}
+
+/* report_run_stats()
+ * ------------------
+ * Prints the --stats counters and stage latencies of a run, summed over
+ * every thread, to stderr once all of its output has been written.
+ * Nothing is printed without --stats, which only -DUJB_STATS builds have.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * stats: Counters summed over every thread used by the run
+ */
+void report_run_stats(const Config *cfg, const Stats *stats)
+{
+    if (cfg->stats)
+    {
+        stats_report(stats, stderr);
+    }
+}
+
+/* rejection_reason()
+ * ------------------
+ * Works out why an expression could not be evaluated, for --stats. A
+ * conversion failure from an evaluator is narrowed down with
+ * expression_precheck(), so the reasons counted are the same whether or
+ * not the pre-pass ran ahead of the evaluator. Only failures pay for it,
+ * and only in -DUJB_STATS builds.
+ *
+ * expression: The expression that failed (need not be null terminated)
+ * len: Number of characters in expression
+ * inputBase: The base of the input expression (2-36)
+ *
+ * Returns: The reason for the latest failure on the calling thread
+ */
+EvalFailure rejection_reason(const char *expression, size_t len, int inputBase)
+{
+#ifdef UJB_STATS
+    if (eval_failure() == EVAL_FAILURE_CONVERSION)
+    {
+        expression_precheck(expression, len, inputBase);
+    }
+#else
+    (void)expression;
+    (void)len;
+    (void)inputBase;
+#endif
+    return eval_failure();
+}
+
+/* process_file_serial()
+ * ---------------------
+ * Evaluates every line of the input file in order on the calling thread.
+ * Output is collected in one reusable buffer and written whenever it
+ * reaches OUTPUT_BUFFER_BYTES, or after every line with --unbuffered.
+ * Scratch memory comes from one arena that is reset after every line.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * in: The opened input
+ *
+ * Returns: true if the file contained at least one line, false otherwise
+ */
+bool process_file_serial(const Config *cfg, FileInput *in)
+{
+    bool fileHasContent = false;
+    OutputBuffer out;
+    output_init(&out);
+    Arena arena;
+    arena_init(&arena);
+    ResultCache shard;
+    ResultCache *cache = open_result_cache(cfg, &shard);
+    ExprDisplayFn display = format_display(cfg, file_expr_evaluation_display);
+    Stats stats;
+    stats_init(&stats);
+    stats_attach(cfg->stats ? &stats : NULL);
+    const char *line;
+    size_t len;
+
+    // Process each line from the input file
+    STATS_CLOCK(readStart);
+    while (file_input_next_line(in, &line, &len))
+    {
+        STATS_LAP(STATS_READ, readStart);
+        fileHasContent = true;
+        display(&out, &arena, cache, line, len, cfg->inputBase, cfg->oBasesCount,
+                cfg->oBases, cfg->precision);
+        arena_reset(&arena);
+        if (cfg->unbuffered || out.len >= OUTPUT_BUFFER_BYTES)
+        {
+            output_flush(&out);
+        }
+        STATS_RESTART(readStart);
+    }
+
+    output_flush(&out);
+    output_free(&out);
+    stats_count_arena(&stats, &arena.stats);
+    arena_free(&arena);
+    if (cache)
+    {
+        report_cache_stats(cfg, &cache->stats);
+        result_cache_free(cache);
+    }
+    stats_attach(NULL);
+    report_run_stats(cfg, &stats);
+    return fileHasContent;
+}
+
+/* evaluate_lines()
+ * ----------------
+ * Evaluates every line of a block of text into an output buffer. Lines are
+ * located with memchr() and evaluated in place, and the arena is reset
+ * after each one.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * arena: Scratch arena of the calling thread
+ * cache: Result cache of the calling thread, or NULL
+ * data: The lines, newlines included (the last one may lack its newline)
+ * len: Number of bytes in data
+ * out: Pointer to OutputBuffer to receive the output of every line
+ * display: Produces the output of one line
+ */
+void evaluate_lines(const Config *cfg, Arena *arena, ResultCache *cache,
+                    const char *data, size_t len, OutputBuffer *out,
+                    ExprDisplayFn display)
+{
+    const char *line = data;
+    const char *end = data + len;
+    while (line < end)
+    {
+        const char *newline = memchr(line, '\n', (size_t)(end - line));
+        size_t rawLen = newline ? (size_t)(newline - line) + 1 : (size_t)(end - line);
+        display(out, arena, cache, line, trimmed_line_length(line, rawLen),
+                cfg->inputBase, cfg->oBasesCount, cfg->oBases, cfg->precision);
+        arena_reset(arena);
+        line += rawLen;
+    }
+}
+
+/* evaluate_file_chunk()
+ * ---------------------
+ * Evaluates every line of a chunk into the chunk's output buffer.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * arena: Scratch arena of the calling thread
+ * cache: Result cache of the calling thread, or NULL
+ * chunk: The chunk to evaluate
+ */
+void evaluate_file_chunk(const Config *cfg, Arena *arena, ResultCache *cache,
+                         FileChunk *chunk)
+{
+    evaluate_lines(cfg, arena, cache, chunk->data, chunk->len, &chunk->output,
+                   format_display(cfg, file_expr_evaluation_display));
+}
+
+/* file_reader()
+ * -------------
+ * Thread body of the reader stage of --jobs file mode: fills each empty
+ * chunk it is given with the next whole lines of the input and passes it
+ * on to the workers, until the input ends. It then stops every worker and
+ * tells the writer how many chunks there were.
+ *
+ * arg: Pointer to the shared WorkerPool
+ *
+ * Returns: NULL
+ */
+void *file_reader(void *arg)
+{
+    WorkerPool *pool = arg;
+    Stats stats;
+    stats_init(&stats);
+    stats_attach(pool->cfg->stats ? &stats : NULL);
+    size_t submitted = 0;
+    while (1)
+    {
+        FileChunk *chunk = ring_queue_pop(&pool->empty);
+        STATS_CLOCK(readStart);
+        if (!file_input_next_chunk(pool->in, chunk))
+        {
+            break; // End of file
+        }
+        STATS_LAP(STATS_READ, readStart);
+        chunk->number = submitted++;
+        ring_queue_push(&pool->filled, chunk);
+    }
+
+    for (int i = 0; i < pool->workers; i++)
+    {
+        ring_queue_push(&pool->filled, NULL);
+    }
+    pool->submitted = submitted;
+    ring_queue_push(&pool->evaluated, NULL); // Publishes submitted
+    stats_attach(NULL);
+    pthread_mutex_lock(&pool->lock);
+    stats_add(&pool->stats, &stats);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/* file_worker()
+ * -------------
+ * Thread body for --jobs file mode: repeatedly takes the next filled
+ * chunk, evaluates it and passes it on to the writer, until it is handed
+ * NULL. Each worker owns one scratch arena and one result cache shard for
+ * all of its chunks.
+ *
+ * arg: Pointer to the shared WorkerPool
+ *
+ * Returns: NULL
+ */
+void *file_worker(void *arg)
+{
+    WorkerPool *pool = arg;
+    Arena arena;
+    arena_init(&arena);
+    ResultCache shard;
+    ResultCache *cache = open_result_cache(pool->cfg, &shard);
+    Stats stats;
+    stats_init(&stats);
+    stats_attach(pool->cfg->stats ? &stats : NULL);
+    FileChunk *chunk;
+    while ((chunk = ring_queue_pop(&pool->filled)))
+    {
+        evaluate_file_chunk(pool->cfg, &arena, cache, chunk);
+        ring_queue_push(&pool->evaluated, chunk);
+    }
+
+    stats_attach(NULL);
+    pthread_mutex_lock(&pool->lock);
+    if (cache)
+    {
+        result_cache_stats_add(&pool->cacheStats, &cache->stats);
+    }
+    stats_count_arena(&stats, &arena.stats);
+    stats_add(&pool->stats, &stats);
+    pthread_mutex_unlock(&pool->lock);
+    arena_free(&arena);
+    if (cache)
+    {
+        result_cache_free(cache);
+    }
+    return NULL;
+}
+
+/* write_ready_chunks()
+ * --------------------
+ * Writes out, in file order, every evaluated chunk from the oldest
+ * unwritten one onwards, gathering them into as few writes as possible,
+ * and hands the chunks back to the reader.
+ *
+ * order: Evaluated chunks not yet written, chunk n in slot n % chunkCount
+ * chunkCount: Number of slots in order
+ * written: Pointer to the number of chunks written so far (updated)
+ * empty: Queue of chunks for the reader to fill
+ *
+ * Returns: Number of chunks written
+ */
+size_t write_ready_chunks(FileChunk **order, size_t chunkCount, size_t *written,
+                          RingQueue *empty)
+{
+    OutputBuffer *ready[MAX_JOBS * 4];
+    size_t count = 0;
+    while (count < chunkCount && order[(*written + count) % chunkCount])
+    {
+        ready[count] = &order[(*written + count) % chunkCount]->output;
+        count++;
+    }
+    output_write_all(ready, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        FileChunk **slot = &order[(*written + i) % chunkCount];
+        ring_queue_push(empty, *slot);
+        *slot = NULL;
+    }
+    *written += count;
+    return count;
+}
+
+/* process_file_parallel()
+ * -----------------------
+ * Evaluates the input file on cfg->jobs worker threads, with a reader
+ * thread ahead of them and the main thread writing behind them (see
+ * WorkerPool). Output is written strictly in file order, so it is
+ * identical to that of process_file_serial().
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * in: The opened input
+ *
+ * Returns: true if the file contained at least one line, false otherwise
+ * Errors: Falls back to process_file_serial() if the pipeline cannot be
+ * set up
+ */
+bool process_file_parallel(const Config *cfg, FileInput *in)
+{
+    WorkerPool pool;
+    pool.cfg = cfg;
+    pool.in = in;
+    pool.chunkCount = (size_t)cfg->jobs * 4;
+    pool.workers = 0;
+    pool.submitted = 0;
+    memset(&pool.cacheStats, 0, sizeof(pool.cacheStats));
+    stats_init(&pool.stats);
+    pool.chunks = calloc(pool.chunkCount, sizeof(FileChunk));
+    FileChunk **order = calloc(pool.chunkCount, sizeof(FileChunk *));
+    pthread_t *threads = malloc((size_t)cfg->jobs * sizeof(pthread_t));
+    bool queues = ring_queue_init(&pool.empty, pool.chunkCount);
+    queues = ring_queue_init(&pool.filled, pool.chunkCount) && queues;
+    queues = ring_queue_init(&pool.evaluated, pool.chunkCount) && queues;
+    if (!pool.chunks || !order || !threads || !queues)
+    {
+        free(pool.chunks);
+        free(order);
+        free(threads);
+        ring_queue_free(&pool.empty);
+        ring_queue_free(&pool.filled);
+        ring_queue_free(&pool.evaluated);
+        return process_file_serial(cfg, in);
+    }
+    for (size_t i = 0; i < pool.chunkCount; i++)
+    {
+        output_init(&pool.chunks[i].output);
+        ring_queue_push(&pool.empty, &pool.chunks[i]);
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+
+    while (pool.workers < cfg->jobs &&
+           pthread_create(&threads[pool.workers], NULL, file_worker, &pool) == 0)
+    {
+        pool.workers++;
+    }
+    pthread_t reader;
+    bool reading = pool.workers > 0 &&
+                   pthread_create(&reader, NULL, file_reader, &pool) == 0;
+    if (!reading)
+    {
+        for (int i = 0; i < pool.workers; i++)
+        {
+            ring_queue_push(&pool.filled, NULL); // Nothing will be read
+        }
+    }
+
+    // The main thread is the writer stage
+    Stats stats;
+    stats_init(&stats);
+    stats_attach(cfg->stats ? &stats : NULL);
+
+    size_t written = 0;
+    bool ended = !reading;
+    while (!ended || written < pool.submitted)
+    {
+        // Wait for one chunk, then take every other one already evaluated
+        void *item = ring_queue_pop(&pool.evaluated);
+        do
+        {
+            FileChunk *chunk = item;
+            if (chunk)
+            {
+                order[chunk->number % pool.chunkCount] = chunk;
+            }
+            else
+            {
+                ended = true; // The reader is done; submitted is final
+            }
+        } while (ring_queue_try_pop(&pool.evaluated, &item));
+        write_ready_chunks(order, pool.chunkCount, &written, &pool.empty);
+    }
+
+    if (reading)
+    {
+        pthread_join(reader, NULL);
+    }
+    for (int i = 0; i < pool.workers; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    stats_attach(NULL);
+    bool fileHasContent = pool.submitted > 0;
+    if (reading)
+    {
+        report_cache_stats(cfg, &pool.cacheStats);
+        stats_add(&pool.stats, &stats);
+        report_run_stats(cfg, &pool.stats);
+    }
+    else
+    {
+        // Nothing was read; evaluate the file directly
+        fileHasContent = process_file_serial(cfg, in);
+    }
+
+    for (size_t i = 0; i < pool.chunkCount; i++)
+    {
+        free(pool.chunks[i].text);
+        output_free(&pool.chunks[i].output);
+    }
+    free(pool.chunks);
+    free(order);
+    free(threads);
+    ring_queue_free(&pool.empty);
+    ring_queue_free(&pool.filled);
+    ring_queue_free(&pool.evaluated);
+    pthread_mutex_destroy(&pool.lock);
+    return fileHasContent;
+}
+
+/* serve_expr_record()
+ * -------------------
+ * Evaluates one --serve request line and appends its reply as a single
+ * record: "OK <result> <base>:<digits>...\n" with the result in the input
+ * base followed by every output base, or SERVE_ERROR_RECORD if the line
+ * cannot be evaluated. A drop-in replacement for
+ * file_expr_evaluation_display().
+ *
+ * Parameters: as for file_expr_evaluation_display()
+ */
+void serve_expr_record(OutputBuffer *out, Arena *arena, ResultCache *cache,
+                       const char *expression, size_t len, int inputBase,
+                       int oBasesCount, const int *oBases, Precision precision)
+{
+    RecordResult result;
+    if (record_evaluate(arena, cache, expression, len, inputBase, oBasesCount,
+                        oBases, precision, true, &result) != 0)
+    {
+        output_append(out, stdout, SERVE_ERROR_RECORD, strlen(SERVE_ERROR_RECORD));
+        record_result_free(&result);
+        return;
+    }
+    output_append(out, stdout, "OK ", 3);
+    output_record_digits(out, arena, &result, 0, inputBase, false);
+    if (result.rendered)
+    {
+        output_base_fields(out, &SERVE_BASE_FIELDS, oBases, oBasesCount, result.digits,
+                           result.digitEnds);
+    }
+    for (int i = 0; !result.rendered && i < oBasesCount; i++)
+    {
+        output_append(out, stdout, " ", 1);
+        output_append_digits(out, stdout, (unsigned long long)oBases[i], DECIMAL);
+        output_append(out, stdout, ":", 1);
+        output_record_digits(out, arena, &result, i + 1, oBases[i], false);
+    }
+    output_append(out, stdout, "\n", 1);
+    record_result_free(&result);
+}
+
+/* serve_open_unix()
+ * -----------------
+ * Creates a non-blocking listening Unix domain socket at path. A socket
+ * left behind at path by an earlier server is replaced; any other kind of
+ * file is left alone and makes the bind fail.
+ *
+ * path: Filesystem path of the socket
+ *
+ * Returns: The listening socket, or -1 on failure
+ */
+int serve_open_unix(const char *path)
+{
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+    {
+        unlink(path);
+    }
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, SERVE_BACKLOG) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* serve_open_tcp()
+ * ----------------
+ * Creates a non-blocking listening TCP socket from "PORT" (bound to the
+ * loopback interface) or "HOST:PORT".
+ *
+ * spec: The address, without its "tcp:" prefix
+ *
+ * Returns: The listening socket, or -1 on failure
+ */
+int serve_open_tcp(const char *spec)
+{
+    char host[MAX_CMD_INPUT];
+    const char *port = strrchr(spec, ':');
+    if (port)
+    {
+        size_t hostLen = (size_t)(port - spec);
+        if (hostLen >= sizeof(host))
+        {
+            return -1;
+        }
+        memcpy(host, spec, hostLen);
+        host[hostLen] = '\0';
+        port++;
+    }
+    else
+    {
+        strcpy(host, SERVE_DEFAULT_HOST);
+        port = spec;
+    }
+    if (port[0] == '\0' || !digits_only(port))
+    {
+        return -1;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    struct addrinfo *addresses;
+    if (getaddrinfo(host[0] ? host : NULL, port, &hints, &addresses) != 0)
+    {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *a = addresses; a && fd < 0; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    a->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 ||
+            listen(fd, SERVE_BACKLOG) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+/* serve_saturated()
+ * -----------------
+ * Checks whether a connection has so much work in flight, or so much reply
+ * the client has not read, that no more requests should be read from it.
+ *
+ * conn: The connection to check
+ *
+ * Returns: true if reading should pause, false otherwise
+ */
+bool serve_saturated(const ServeConnection *conn)
+{
+    return conn->jobCount >= SERVE_MAX_JOBS ||
+           conn->reply.len - conn->replySent >= SERVE_MAX_REPLY_BYTES;
+}
+
+/* serve_worker()
+ * --------------
+ * Thread body for --serve mode: repeatedly takes the oldest queued job,
+ * evaluates its lines, puts it on the done list and wakes the event loop,
+ * until the server is finished. Each worker owns one scratch arena and
+ * one result cache shard.
+ *
+ * arg: Pointer to the shared Server
+ *
+ * Returns: NULL
+ */
+void *serve_worker(void *arg)
+{
+    Server *server = arg;
+    Arena arena;
+    arena_init(&arena);
+    ResultCache shard;
+    ResultCache *cache = open_result_cache(server->cfg, &shard);
+    Stats stats;
+    stats_init(&stats);
+    stats_attach(server->cfg->stats ? &stats : NULL);
+    pthread_mutex_lock(&server->lock);
+    while (1)
+    {
+        while (!server->queueHead && !server->finished)
+        {
+            pthread_cond_wait(&server->workReady, &server->lock);
+        }
+        if (server->finished)
+        {
+            break;
+        }
+        ServeJob *job = server->queueHead;
+        server->queueHead = job->nextQueued;
+        if (!server->queueHead)
+        {
+            server->queueTail = NULL;
+        }
+        pthread_mutex_unlock(&server->lock);
+
+        evaluate_lines(server->cfg, &arena, cache, job->text, job->len, &job->output,
+                       format_display(server->cfg, serve_expr_record));
+
+        pthread_mutex_lock(&server->lock);
+        job->nextQueued = server->doneHead;
+        server->doneHead = job;
+        pthread_mutex_unlock(&server->lock);
+        uint64_t one = 1;
+        while (write(server->wakeFd, &one, sizeof(one)) < 0 && errno == EINTR)
+        {
+        }
+        pthread_mutex_lock(&server->lock);
+    }
+    if (cache)
+    {
+        result_cache_stats_add(&server->cacheStats, &cache->stats);
+    }
+    stats_count_arena(&stats, &arena.stats);
+    stats_add(&server->stats, &stats);
+    pthread_mutex_unlock(&server->lock);
+    arena_free(&arena);
+    if (cache)
+    {
+        result_cache_free(cache);
+    }
+    return NULL;
+}
+
+/* serve_submit()
+ * --------------
+ * Hands every complete line read from a connection to the worker pool as
+ * one job. The read buffer itself becomes the job's text, so only the
+ * trailing partial line is copied. At end of input the partial line is
+ * submitted too.
+ *
+ * server: The shared Server
+ * conn: The connection that was read
+ * final: Whether the client has finished sending
+ *
+ * Errors: Marks the connection broken if a line exceeds SERVE_MAX_LINE or
+ *         memory runs out
+ */
+void serve_submit(Server *server, ServeConnection *conn, bool final)
+{
+    size_t len = conn->inputLen;
+    if (!final)
+    {
+        while (len > 0 && conn->input[len - 1] != '\n')
+        {
+            len--;
+        }
+        if (len == 0)
+        {
+            conn->broken = conn->inputLen > SERVE_MAX_LINE;
+            return;
+        }
+    }
+    if (len == 0)
+    {
+        return;
+    }
+
+    ServeJob *job = calloc(1, sizeof(ServeJob));
+    size_t rest = conn->inputLen - len;
+    char *input = rest > 0 ? malloc(rest + SERVE_READ_BYTES) : NULL;
+    if (!job || (rest > 0 && !input))
+    {
+        free(job);
+        free(input);
+        conn->broken = true;
+        return;
+    }
+    if (rest > 0)
+    {
+        memcpy(input, conn->input + len, rest);
+    }
+    job->conn = conn;
+    job->text = conn->input;
+    job->len = len;
+    output_init(&job->output);
+    conn->input = input;
+    conn->inputLen = rest;
+    conn->inputCapacity = input ? rest + SERVE_READ_BYTES : 0;
+
+    if (conn->lastJob)
+    {
+        conn->lastJob->nextInConnection = job;
+    }
+    else
+    {
+        conn->firstJob = job;
+    }
+    conn->lastJob = job;
+    conn->jobCount++;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->queueTail)
+    {
+        server->queueTail->nextQueued = job;
+    }
+    else
+    {
+        server->queueHead = job;
+    }
+    server->queueTail = job;
+    pthread_cond_signal(&server->workReady);
+    pthread_mutex_unlock(&server->lock);
+}
+
+/* serve_read()
+ * ------------
+ * Reads whatever a connection has sent and submits its complete lines,
+ * until the socket would block or the connection is saturated.
+ *
+ * server: The shared Server
+ * conn: The connection to read
+ *
+ * Errors: Marks the connection broken on a socket error
+ */
+void serve_read(Server *server, ServeConnection *conn)
+{
+    while (!conn->broken && !conn->readClosed && !serve_saturated(conn))
+    {
+        if (conn->inputCapacity - conn->inputLen < SERVE_READ_BYTES)
+        {
+            size_t capacity = conn->inputLen + SERVE_READ_BYTES;
+            char *grown = realloc(conn->input, capacity);
+            if (!grown)
+            {
+                conn->broken = true;
+                return;
+            }
+            conn->input = grown;
+            conn->inputCapacity = capacity;
+        }
+
+        STATS_CLOCK(readStart);
+        ssize_t n = recv(conn->fd, conn->input + conn->inputLen, SERVE_READ_BYTES, 0);
+        if (n > 0)
+        {
+            STATS_LAP(STATS_READ, readStart);
+            conn->inputLen += (size_t)n;
+            serve_submit(server, conn, false);
+        }
+        else if (n == 0)
+        {
+            conn->readClosed = true;
+            serve_submit(server, conn, true);
+        }
+        else if (errno != EINTR)
+        {
+            conn->broken = errno != EAGAIN && errno != EWOULDBLOCK;
+            return;
+        }
+    }
+}
+
+/* serve_send()
+ * ------------
+ * Sends as much of a connection's reply as the socket accepts, and empties
+ * the reply buffer once all of it has gone.
+ *
+ * conn: The connection to write to
+ *
+ * Errors: Marks the connection broken on a socket error
+ */
+void serve_send(ServeConnection *conn)
+{
+    while (conn->replySent < conn->reply.len)
+    {
+        STATS_CLOCK(writeStart);
+        ssize_t n = send(conn->fd, conn->reply.data + conn->replySent,
+                         conn->reply.len - conn->replySent, MSG_NOSIGNAL);
+        if (n >= 0)
+        {
+            STATS_LAP(STATS_WRITE, writeStart);
+            conn->replySent += (size_t)n;
+        }
+        else if (errno != EINTR)
+        {
+            conn->broken = errno != EAGAIN && errno != EWOULDBLOCK;
+            return;
+        }
+    }
+    conn->reply.len = 0;
+    conn->reply.segmentCount = 0;
+    conn->replySent = 0;
+}
+
+/* serve_collect()
+ * ---------------
+ * Moves the records of the connection's finished jobs into its reply, in
+ * request order, stopping at the first job that is still running. When
+ * the reply is empty a job's buffer is swapped in rather than copied.
+ *
+ * conn: The connection whose jobs to collect
+ */
+void serve_collect(ServeConnection *conn)
+{
+    while (conn->firstJob && conn->firstJob->done)
+    {
+        ServeJob *job = conn->firstJob;
+        conn->firstJob = job->nextInConnection;
+        if (!conn->firstJob)
+        {
+            conn->lastJob = NULL;
+        }
+        conn->jobCount--;
+
+        if (conn->broken)
+        {
+            // Nobody is listening; just drop the records
+        }
+        else if (conn->reply.len == 0)
+        {
+            OutputBuffer empty = conn->reply;
+            conn->reply = job->output;
+            job->output = empty;
+        }
+        else
+        {
+            output_append(&conn->reply, stdout, job->output.data, job->output.len);
+        }
+        free(job->text);
+        output_free(&job->output);
+        free(job);
+    }
+}
+
+/* serve_update()
+ * --------------
+ * Brings a connection's epoll registration in line with its state, and
+ * closes it once it is broken or the client has finished sending and
+ * every reply has gone. A closed connection is freed after the current
+ * batch of events, as soon as no worker holds one of its jobs.
+ *
+ * server: The shared Server
+ * conn: The connection to update
+ */
+void serve_update(Server *server, ServeConnection *conn)
+{
+    if (conn->fd >= 0 &&
+        (conn->broken || (conn->readClosed && conn->jobCount == 0 &&
+                          conn->replySent == conn->reply.len)))
+    {
+        close(conn->fd); // Also removes it from the epoll set
+        conn->fd = -1;
+        conn->events = 0;
+    }
+    if (conn->fd < 0)
+    {
+        if (conn->jobCount == 0 && !conn->buried)
+        {
+            conn->buried = true;
+            conn->nextDirty = server->graveyard;
+            server->graveyard = conn;
+        }
+        return;
+    }
+
+    // Registering no events at all still reports hangups, so deregister
+    uint32_t events = 0;
+    if (!conn->readClosed && !serve_saturated(conn))
+    {
+        events |= EPOLLIN;
+    }
+    if (conn->replySent < conn->reply.len)
+    {
+        events |= EPOLLOUT;
+    }
+    if (events != conn->events)
+    {
+        struct epoll_event event;
+        event.events = events;
+        event.data.ptr = conn;
+        int op = !conn->events ? EPOLL_CTL_ADD : (!events ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+        if (epoll_ctl(server->epollFd, op, conn->fd, &event) != 0)
+        {
+            conn->broken = true;
+            serve_update(server, conn);
+            return;
+        }
+        conn->events = events;
+    }
+}
+
+/* serve_accept()
+ * --------------
+ * Accepts every pending connection on the listening socket.
+ *
+ * server: The shared Server
+ */
+void serve_accept(Server *server)
+{
+    while (1)
+    {
+        int fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            return; // EAGAIN, or out of descriptors until a client leaves
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // TCP only
+
+        ServeConnection *conn = calloc(1, sizeof(ServeConnection));
+        if (!conn)
+        {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        output_init(&conn->reply);
+        conn->next = server->connections;
+        if (server->connections)
+        {
+            server->connections->prev = conn;
+        }
+        server->connections = conn;
+        serve_update(server, conn);
+    }
+}
+
+/* serve_drain_done()
+ * ------------------
+ * Takes every job the workers have finished, then collects and sends the
+ * replies of the connections they belong to.
+ *
+ * server: The shared Server
+ */
+void serve_drain_done(Server *server)
+{
+    uint64_t count;
+    while (read(server->wakeFd, &count, sizeof(count)) < 0 && errno == EINTR)
+    {
+    }
+
+    pthread_mutex_lock(&server->lock);
+    ServeJob *job = server->doneHead;
+    server->doneHead = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    ServeConnection *dirty = NULL;
+    for (; job; job = job->nextQueued)
+    {
+        job->done = true;
+        if (!job->conn->dirty)
+        {
+            job->conn->dirty = true;
+            job->conn->nextDirty = dirty;
+            dirty = job->conn;
+        }
+    }
+
+    while (dirty)
+    {
+        ServeConnection *conn = dirty;
+        dirty = conn->nextDirty;
+        conn->dirty = false;
+        serve_collect(conn);
+        if (conn->fd >= 0 && !conn->broken)
+        {
+            serve_send(conn);
+        }
+        // Finishing jobs may have freed space to read more requests
+        if (conn->fd >= 0 && !conn->broken && !conn->readClosed)
+        {
+            serve_read(server, conn);
+        }
+        serve_update(server, conn);
+    }
+}
+
+/* serve_free_connection()
+ * -----------------------
+ * Closes a connection if it is still open, frees it and every job it still
+ * owns, and removes it from the server's list. No worker may hold any of
+ * its jobs.
+ *
+ * server: The shared Server
+ * conn: The connection to free
+ */
+void serve_free_connection(Server *server, ServeConnection *conn)
+{
+    if (conn->fd >= 0)
+    {
+        close(conn->fd);
+    }
+    ServeJob *job = conn->firstJob;
+    while (job)
+    {
+        ServeJob *next = job->nextInConnection;
+        free(job->text);
+        output_free(&job->output);
+        free(job);
+        job = next;
+    }
+    if (conn->prev)
+    {
+        conn->prev->next = conn->next;
+    }
+    else
+    {
+        server->connections = conn->next;
+    }
+    if (conn->next)
+    {
+        conn->next->prev = conn->prev;
+    }
+    free(conn->input);
+    output_free(&conn->reply);
+    free(conn);
+}
+
+/* run_server()
+ * ------------
+ * Runs --serve mode: listens on cfg->servePath, reads newline delimited
+ * expressions from any number of clients and replies to each line with
+ * one record, in request order. Clients may pipeline as many requests as
+ * they like; lines are evaluated in batches on cfg->jobs worker threads
+ * while a single epoll loop does all of the socket I/O. Runs until
+ * SIGINT or SIGTERM.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ *
+ * Returns: 0 after a clean shutdown
+ * Errors: Prints a message to stderr and returns EXIT_SERVE if the server
+ *         cannot be set up
+ */
+int run_server(const Config *cfg)
+{
+    bool isTcp = strncmp(cfg->servePath, SERVE_TCP_PREFIX,
+                         strlen(SERVE_TCP_PREFIX)) == 0;
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.cfg = cfg;
+    Stats stats; // The event loop's own reads and writes
+    stats_init(&stats);
+    stats_attach(cfg->stats ? &stats : NULL);
+    server.listenFd = isTcp ? serve_open_tcp(cfg->servePath + strlen(SERVE_TCP_PREFIX))
+                            : serve_open_unix(cfg->servePath);
+    server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    server.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // Signals are taken by the event loop, so block them in every thread
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    server.signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    pthread_t *threads = malloc((size_t)cfg->jobs * sizeof(pthread_t));
+    int started = 0;
+    bool ready = server.listenFd >= 0 && server.epollFd >= 0 &&
+                 server.wakeFd >= 0 && server.signalFd >= 0 && threads;
+    int *markers[] = {&server.listenFd, &server.wakeFd, &server.signalFd};
+    for (size_t i = 0; ready && i < sizeof(markers) / sizeof(markers[0]); i++)
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = markers[i];
+        ready = epoll_ctl(server.epollFd, EPOLL_CTL_ADD, *markers[i], &event) == 0;
+    }
+    bool poolStarted = ready;
+    if (poolStarted)
+    {
+        pthread_mutex_init(&server.lock, NULL);
+        pthread_cond_init(&server.workReady, NULL);
+        while (started < cfg->jobs &&
+               pthread_create(&threads[started], NULL, serve_worker, &server) == 0)
+        {
+            started++;
+        }
+        ready = started > 0;
+    }
+
+    struct epoll_event events[SERVE_MAX_EVENTS];
+    bool running = ready;
+    while (running)
+    {
+        int count = epoll_wait(server.epollFd, events, SERVE_MAX_EVENTS, -1);
+        if (count < 0 && errno != EINTR)
+        {
+            break;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            void *tag = events[i].data.ptr;
+            if (tag == &server.listenFd)
+            {
+                serve_accept(&server);
+            }
+            else if (tag == &server.wakeFd)
+            {
+                serve_drain_done(&server);
+            }
+            else if (tag == &server.signalFd)
+            {
+                running = false;
+            }
+            else
+            {
+                ServeConnection *conn = tag;
+                uint32_t happened = events[i].events;
+                if (conn->fd < 0)
+                {
+                    continue; // Closed earlier in this batch
+                }
+                if (happened & EPOLLERR)
+                {
+                    conn->broken = true;
+                }
+                if (happened & (EPOLLIN | EPOLLHUP))
+                {
+                    serve_read(&server, conn);
+                }
+                if ((happened & EPOLLOUT) && !conn->broken)
+                {
+                    serve_send(conn);
+                }
+                serve_update(&server, conn);
+            }
+        }
+        while (server.graveyard)
+        {
+            ServeConnection *conn = server.graveyard;
+            server.graveyard = conn->nextDirty;
+            serve_free_connection(&server, conn);
+        }
+    }
+
+    if (poolStarted)
+    {
+        pthread_mutex_lock(&server.lock);
+        server.finished = true;
+        pthread_cond_broadcast(&server.workReady);
+        pthread_mutex_unlock(&server.lock);
+        for (int i = 0; i < started; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&server.lock);
+        pthread_cond_destroy(&server.workReady);
+        report_cache_stats(cfg, &server.cacheStats);
+        stats_add(&server.stats, &stats);
+        report_run_stats(cfg, &server.stats);
+    }
+    stats_attach(NULL);
+    while (server.connections)
+    {
+        serve_free_connection(&server, server.connections);
+    }
+    free(threads);
+    int fds[] = {server.signalFd, server.wakeFd, server.epollFd, server.listenFd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+    if (server.listenFd >= 0 && !isTcp)
+    {
+        unlink(cfg->servePath);
+    }
+
+    if (!ready)
+    {
+        fprintf(stderr, "uqbasejump: can't serve on \"%s\"\n", cfg->servePath);
+        return EXIT_SERVE;
+    }
+    return 0;
+}
+
+/* initialize_config()
+ * -------------------
+ * Initializes a Config structure with default values.
+ *
+ * cfg: Pointer to Config structure to initialize
+ *
+ * Global variables modified: None
+ */
+void initialize_config(Config *cfg)
+{
+    cfg->fileName = NULL;
+    cfg->haveFile = false;
+    cfg->haveInputBase = false;
+    cfg->inputBase = DECIMAL;
+    cfg->oBases[0] = BINARY;
+    cfg->oBases[1] = DECIMAL;
+    cfg->oBases[2] = HEX;
+    cfg->oBasesCount = DEFAULT_NUMBER_OF_BASES;
+    cfg->precision = PRECISION_DOUBLE;
+    cfg->jobs = 1;
+    cfg->unbuffered = false;
+    cfg->haveServe = false;
+    cfg->servePath = NULL;
+    cfg->format = FORMAT_TEXT;
+    cfg->cacheEntries = 0;
+    cfg->stats = false;
+    arena_init(&cfg->scratch);
+    cfg->preview.len = 0;
+    cfg->preview.wrapLen = 0;
+    cfg->preview.value = 0;
+    bigint_init(&cfg->preview.big);
+    output_init(&cfg->screen.shown);
+    output_init(&cfg->screen.next);
+    cfg->screen.painted = false;
+    cfg->screen.clear = true;
+    cfg->screen.pending = false;
+    cfg->screen.terminal = false;
+
+    history_ring_init(&cfg->history.ring, DEFAULT_HISTORY_ENTRIES);
+    cfg->history.logPath = NULL;
+    cfg->history.logFd = -1;
+}
+
+/* parse_arguments()
+ * -----------------
+ * Parses command line arguments and populates the configuration structure.
+ *
+ * argc: Number of command line arguments
+ * argv: Array of command line argument strings
+ * cfg: Pointer to Config structure to populate
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if arguments are invalid
+ */
+void parse_arguments(int argc, char **argv, Config *cfg)
+{
+    initialize_config(cfg);
+    // Track which arguments have been used to prevent duplicates
+    bool usedInput = false, usedOutput = false, usedFile = false,
+         usedPrecision = false, usedJobs = false, usedUnbuffered = false,
+         usedServe = false, usedFormat = false, usedCache = false,
+         usedHistorySize = false, usedHistoryFile = false;
+
+    // Parse each command line argument starting from index 1
+    for (int i = 1; i < argc; i++)
+    {
+        const char *argument = argv[i];
+        // All valid arguments must start with '--'
+        if (argument[0] != '-')
+        {
+            invalid_command_line_args();
+        }
+
+        if (strcmp(argument, "--inputbase") == 0)
+        {
+            if (usedInput)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedInput = true;
+            handle_inputbase_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--obases") == 0)
+        {
+            if (usedOutput)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedOutput = true;
+            handle_obases_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--file") == 0)
+        {
+            if (usedFile)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedFile = true;
+            handle_file_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--stdin-batch") == 0)
+        {
+            if (usedFile)
+            {
+                invalid_command_line_args(); // Duplicate, or given with --file
+            }
+            usedFile = true;
+            cfg->haveFile = true; // Read stdin exactly as a file
+        }
+
+        else if (strcmp(argument, "--precision") == 0)
+        {
+            if (usedPrecision)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedPrecision = true;
+            handle_precision_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--jobs") == 0)
+        {
+            if (usedJobs)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedJobs = true;
+            handle_jobs_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--unbuffered") == 0)
+        {
+            if (usedUnbuffered)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedUnbuffered = true;
+            cfg->unbuffered = true;
+        }
+
+        else if (strcmp(argument, "--serve") == 0)
+        {
+            if (usedServe)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedServe = true;
+            handle_serve_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--format") == 0)
+        {
+            if (usedFormat)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedFormat = true;
+            handle_format_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--cache") == 0)
+        {
+            if (usedCache)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedCache = true;
+            handle_cache_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--history-size") == 0)
+        {
+            if (usedHistorySize)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedHistorySize = true;
+            handle_history_size_arg(argc, argv, &i, cfg);
+        }
+
+        else if (strcmp(argument, "--history-file") == 0)
+        {
+            if (usedHistoryFile)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            usedHistoryFile = true;
+            handle_history_file_arg(argc, argv, &i, cfg);
+        }
+
+#ifdef UJB_STATS
+        else if (strcmp(argument, "--stats") == 0)
+        {
+            if (cfg->stats)
+            {
+                invalid_command_line_args(); // Duplicate argument
+            }
+            cfg->stats = true;
+        }
+#endif
+
+        else
+        {
+            invalid_command_line_args(); // Unknown argument
+        }
+    }
+
+    // A server reads its expressions from clients, not from a file
+    if (cfg->haveServe && cfg->haveFile)
+    {
+        invalid_command_line_args();
+    }
+    // Records, the cache and the workers are only used for a file or for clients
+    if ((cfg->format != FORMAT_TEXT || cfg->cacheEntries > 0 || usedJobs) &&
+        !cfg->haveFile && !cfg->haveServe)
+    {
+        invalid_command_line_args();
+    }
+    // Only file mode output is buffered
+    if (cfg->unbuffered && !cfg->haveFile)
+    {
+        invalid_command_line_args();
+    }
+    // History is only kept for interactive use
+    if ((usedHistorySize || usedHistoryFile) && (cfg->haveFile || cfg->haveServe))
+    {
+        invalid_command_line_args();
+    }
+}
+
+/* handle_inputbase_arg()
+ * ----------------------
+ * Processes the --inputbase command line argument.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_inputbase_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--inputbase" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *baseOfInput = argv[*i];
+    if (baseOfInput[0] == '\0' || !digits_only(baseOfInput))
+    {
+        invalid_command_line_args();
+    }
+
+    int base = (int)strtol(baseOfInput, NULL, DECIMAL);
+    if (!in_range(base))
+    {
+        invalid_command_line_args();
+    }
+
+    cfg->haveInputBase = true;
+    cfg->inputBase = base;
+}
+
+/* handle_obases_arg()
+ * -------------------
+ * Processes the --obases command line argument.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ * REF: This function was developed with assistance from Cursor for
+ * REF: processing and validating command line output base arguments.
+ */
+void handle_obases_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--obases" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *basesOfOutput = argv[*i];
+    if (basesOfOutput[0] == '\0')
+    {
+        invalid_command_line_args();
+    }
+    output_bases_parse(basesOfOutput, cfg);
+}
+
+/* handle_file_arg()
+ * -----------------
+ * Processes the --file command line argument.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_file_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--file" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *inputFileName = argv[*i];
+    if (inputFileName[0] == '\0')
+    {
+        invalid_command_line_args();
+    }
+
+    cfg->fileName = inputFileName;
+    cfg->haveFile = true;
+}
+
+/* handle_precision_arg()
+ * ----------------------
+ * Processes the --precision command line argument ("double", "int" or
+ * "big").
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_precision_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--precision" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *precision = argv[*i];
+    if (strcmp(precision, "double") == 0)
+    {
+        cfg->precision = PRECISION_DOUBLE;
+    }
+    else if (strcmp(precision, "int") == 0)
+    {
+        cfg->precision = PRECISION_INT;
+    }
+    else if (strcmp(precision, "big") == 0)
+    {
+        cfg->precision = PRECISION_BIG;
+    }
+    else
+    {
+        invalid_command_line_args();
+    }
+}
+
+/* handle_jobs_arg()
+ * -----------------
+ * Processes the --jobs command line argument: the number of worker threads
+ * used to evaluate a file (1 to MAX_JOBS), or 0 for one per online CPU.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_jobs_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--jobs" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *jobs = argv[*i];
+    if (jobs[0] == '\0' || strlen(jobs) > 3 || !digits_only(jobs))
+    {
+        invalid_command_line_args();
+    }
+
+    int count = (int)strtol(jobs, NULL, DECIMAL);
+    if (count == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cpus < 1 ? 1 : (cpus > MAX_JOBS ? MAX_JOBS : (int)cpus);
+    }
+    if (count > MAX_JOBS)
+    {
+        invalid_command_line_args();
+    }
+    cfg->jobs = count;
+}
+
+/* handle_serve_arg()
+ * ------------------
+ * Processes the --serve command line argument: a Unix domain socket path,
+ * or "tcp:PORT" or "tcp:HOST:PORT" to listen on TCP instead.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_serve_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--serve" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *servePath = argv[*i];
+    if (servePath[0] == '\0' || strcmp(servePath, SERVE_TCP_PREFIX) == 0)
+    {
+        invalid_command_line_args();
+    }
+
+    cfg->servePath = servePath;
+    cfg->haveServe = true;
+}
+
+/* handle_format_arg()
+ * -------------------
+ * Processes the --format command line argument, one of the names in
+ * outputFormats.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_format_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--format" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    for (size_t f = 0; f < sizeof(outputFormats) / sizeof(outputFormats[0]); f++)
+    {
+        if (strcmp(argv[*i], outputFormats[f].name) == 0)
+        {
+            cfg->format = (enum OutputFormat)f;
+            return;
+        }
+    }
+    invalid_command_line_args();
+}
+
+/* handle_cache_arg()
+ * ------------------
+ * Processes the --cache command line argument: the number of results each
+ * evaluating thread keeps (1 to MAX_CACHE_ENTRIES).
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_cache_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--cache" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *entries = argv[*i];
+    if (entries[0] == '\0' || strlen(entries) > 8 || !digits_only(entries))
+    {
+        invalid_command_line_args();
+    }
+
+    long count = strtol(entries, NULL, DECIMAL);
+    if (count < 1 || count > MAX_CACHE_ENTRIES)
+    {
+        invalid_command_line_args();
+    }
+    cfg->cacheEntries = (size_t)count;
+}
+
+/* handle_history_size_arg()
+ * -------------------------
+ * Processes the --history-size command line argument: the number of
+ * calculations the interactive history keeps (1 to MAX_HISTORY_ENTRIES).
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_history_size_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--history-size" to its value
+    if (*i >= argc)
+    {
+        invalid_command_line_args();
+    }
+
+    const char *entries = argv[*i];
+    if (entries[0] == '\0' || strlen(entries) > 8 || !digits_only(entries))
+    {
+        invalid_command_line_args();
+    }
+
+    long count = strtol(entries, NULL, DECIMAL);
+    if (count < 1 || count > MAX_HISTORY_ENTRIES)
+    {
+        invalid_command_line_args();
+    }
+    history_ring_resize(&cfg->history.ring, (size_t)count);
+}
+
+/* handle_history_file_arg()
+ * -------------------------
+ * Processes the --history-file command line argument: the log the
+ * interactive history is reloaded from and appended to.
+ *
+ * argc: Total number of command line arguments
+ * argv: Array of command line argument strings
+ * i: Pointer to current argument index (will be incremented)
+ * cfg: Pointer to Config structure to modify
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if argument is invalid
+ */
+void handle_history_file_arg(int argc, char **argv, int *i, Config *cfg)
+{
+    (*i)++; // Move from "--history-file" to its value
+    if (*i >= argc || argv[*i][0] == '\0')
+    {
+        invalid_command_line_args();
+    }
+    cfg->history.logPath = argv[*i];
+}
+
+/* output_bases_parse()
+ * --------------------
+ * Parses a comma-separated string of output bases and validates them.
+ *
+ * basesOfOutput: Comma-separated string of base numbers (e.g., "2,8,16")
+ * cfg: Pointer to Config structure to populate with parsed bases
+ *
+ * Global variables modified: None
+ * Errors: Program exits with EXIT_INV_COMM_ARGS (17) if bases are invalid
+ * REF: This function was developed with assistance from Cursor for
+ * REF: parsing and validating comma-separated output base specifications.
+ */
+void output_bases_parse(const char *basesOfOutput, Config *cfg)
+{
+    size_t n = strlen(basesOfOutput);
+    // Check for empty string or trailing/leading commas
+    if (n == 0 || basesOfOutput[n - 1] == ',' || basesOfOutput[0] == ',')
+    {
+        invalid_command_line_args();
+    }
+
+    // Check for consecutive commas which are invalid
+    for (size_t i = 1; i < n; i++)
+    {
+        if (basesOfOutput[i] == ',' && basesOfOutput[i - 1] == ',')
+        {
+            invalid_command_line_args();
+        }
+    }
+
+    // Parse comma-separated base values
+    char *parsing = strdup(basesOfOutput);
+    char *token = strtok(parsing, ",");
+    cfg->oBasesCount = 0;
+
+    // Track which bases we've seen to prevent duplicates
+    bool seen[MAX_BASE + 1] = {false};
+    while (token)
+    {
+        // Ensure token contains only digits
+        if (digits_only(token) == false)
+        {
+            free(parsing);
+            invalid_command_line_args();
+        }
+
+        int base = (int)strtol(token, NULL, DECIMAL);
+        // Check for valid range, duplicates, and capacity limits
+        if ((!in_range(base) || seen[base] || cfg->oBasesCount >= MAX_BASE))
+        {
+            free(parsing);
+            invalid_command_line_args();
+        }
+        seen[base] = true;
+        cfg->oBases[cfg->oBasesCount++] = base;
+        token = strtok(NULL, ",");
+    }
+    free(parsing);
+}
+
+/* program_startup()
+ * -----------------
+ * Displays the program welcome message and current configuration.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ *
+ * Returns: Nothing (void)
+ */
+void program_startup(const Config *cfg)
+{
+    if (!cfg->haveFile)
+    {
+        clear_screen();
+    }
+    printf("Welcome to uqbasejump.\n");
+    printf("This program was written by s4983508.\n");
+    printf("Input base: %d\n", cfg->inputBase);
+    printf("Output bases: ");
+    for (int i = 0; i < cfg->oBasesCount; i++)
+    {
+        if (i > 0)
+        {
+            printf(", ");
+        }
+        printf("%d", cfg->oBases[i]);
+    }
+    printf("\n");
+    if (!cfg->haveFile)
+    {
+        printf("Please enter your numbers and expressions.\n");
+        fflush(stdout);
+    }
+}
+
+/* add_history()
+ * -------------
+ * Adds a new entry to the calculation history and, with --history-file,
+ * appends it to the log.
+ *
+ * cfg: Pointer to Config structure containing history
+ * expression: The mathematical expression (need not be null terminated)
+ * len: Number of characters in the expression
+ * base: The base used for the expression
+ * result: The calculated result value
+ * bigResult: Result digits in base if it does not fit in result (may be NULL)
+ * bigResultLen: Number of characters in bigResult
+ *
+ * Global variables modified: cfg->history
+ */
+void add_history(Config *cfg, const char *expression, size_t len, int base,
+                 unsigned long long result, const char *bigResult,
+                 size_t bigResultLen)
+{
+    if (!cfg || !expression)
+    {
+        return;
+    }
+    if (bigResult)
+    {
+        history_push(&cfg->history, expression, len, base, bigResult,
+                     bigResultLen);
+    }
+    else
+    {
+        // The history keeps the result as digits, ready for :h
+        char digits[FORMAT_DIGITS_BYTES];
+        char *start = format_digits(result, base, digits + sizeof(digits));
+        history_push(&cfg->history, expression, len, base, start,
+                     (size_t)(digits + sizeof(digits) - start));
+    }
+    if (cfg->history.logFd >= 0)
+    {
+        history_log_append(&cfg->history, expression, len, base, result,
+                           bigResult, bigResultLen);
+    }
+}
+
+/* history_push()
+ * --------------
+ * Adds a new entry to a history with history_ring_push(), replacing the
+ * oldest entry once the history is full.
+ *
+ * history: The history to add to
+ * expression: The mathematical expression (need not be null terminated)
+ * len: Number of characters in the expression
+ * base: The base used for the expression
+ * result: The result digits in base (need not be null terminated)
+ * resultLen: Number of characters in result
+ *
+ * Errors: Prints error message to stderr if memory allocation fails
+ */
+void history_push(History *history, const char *expression, size_t len,
+                  int base, const char *result, size_t resultLen)
+{
+    if (!history_ring_push(&history->ring, expression, len, base, result,
+                           resultLen))
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+    }
+}
+
+/* history_log_open()
+ * ------------------
+ * Opens the --history-file log for appending, creating it if needed, and
+ * reloads the newest entries from it. The log is mapped read-only and
+ * walked backwards from its end, so only the entries that fit in the
+ * history are read however long the log is.
+ *
+ * history: The history, with logPath set
+ *
+ * Errors: Program exits with EXIT_OPEN_FILE (13) if the log cannot be
+ * opened or is not a history log
+ */
+void history_log_open(History *history)
+{
+    int fd = open(history->logPath, O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        fprintf(stderr, "uqbasejump: can't use history file \"%s\"\n",
+                history->logPath);
+        exit(EXIT_OPEN_FILE);
+    }
+
+    size_t size = (size_t)info.st_size;
+    bool valid = true;
+    if (size == 0)
+    {
+        valid = write(fd, HISTORY_LOG_MAGIC, HISTORY_LOG_MAGIC_BYTES) ==
+                HISTORY_LOG_MAGIC_BYTES;
+    }
+    else if (size < HISTORY_LOG_MAGIC_BYTES)
+    {
+        valid = false;
+    }
+    else
+    {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        valid = map != MAP_FAILED &&
+                memcmp(map, HISTORY_LOG_MAGIC, HISTORY_LOG_MAGIC_BYTES) == 0;
+        if (valid && history_log_load(history, map, size) == 0 &&
+            size > HISTORY_LOG_MAGIC_BYTES)
+        {
+            // A record cut short at the end is cut off before appending
+            size_t whole = history_log_whole_length(map, size);
+            valid = ftruncate(fd, (off_t)whole) == 0;
+            if (valid)
+            {
+                history_log_load(history, map, whole);
+            }
+        }
+        if (map != MAP_FAILED)
+        {
+            munmap(map, size);
+        }
+    }
+    if (!valid)
+    {
+        fprintf(stderr, "uqbasejump: can't use history file \"%s\"\n",
+                history->logPath);
+        exit(EXIT_OPEN_FILE);
+    }
+    history->logFd = fd;
+}
+
+/* history_log_record_length()
+ * ---------------------------
+ * Checks the record of a mapped log that starts at start.
+ *
+ * log: The mapped log
+ * start: Offset of the record
+ * len: Bytes in the log
+ *
+ * Returns: The length of the record, or 0 if there is no whole, consistent
+ * record at start
+ */
+size_t history_log_record_length(const char *log, size_t start, size_t len)
+{
+    size_t minimum = sizeof(HistoryRecord) + sizeof(uint32_t);
+    if (len - start < minimum)
+    {
+        return 0;
+    }
+    HistoryRecord record;
+    memcpy(&record, log + start, sizeof(record));
+    uint32_t trailer;
+    if (record.length < minimum || record.length > len - start)
+    {
+        return 0;
+    }
+    memcpy(&trailer, log + start + record.length - sizeof(trailer), sizeof(trailer));
+    if (trailer != record.length || record.base < MIN_BASE ||
+        record.base > MAX_BASE ||
+        (uint64_t)record.expressionLen + record.digitsLen + minimum != record.length)
+    {
+        return 0;
+    }
+    return record.length;
+}
+
+/* history_log_whole_length()
+ * --------------------------
+ * Reads a mapped log from the front to find where its last whole record
+ * ends. Only needed to recover from a record cut short by a crash.
+ *
+ * log: The mapped log, starting with HISTORY_LOG_MAGIC
+ * len: Bytes in the log
+ *
+ * Returns: The length of the log up to the end of its last whole record
+ */
+size_t history_log_whole_length(const char *log, size_t len)
+{
+    size_t end = HISTORY_LOG_MAGIC_BYTES;
+    size_t length;
+    while ((length = history_log_record_length(log, end, len)) > 0)
+    {
+        end += length;
+    }
+    return end;
+}
+
+/* history_log_load()
+ * ------------------
+ * Adds the newest records of a mapped log to a history, oldest first. The
+ * records are found by following the trailing length of each one back
+ * from the end of the log; a record that does not check out ends the walk.
+ *
+ * history: The history to add to
+ * log: The mapped log, starting with HISTORY_LOG_MAGIC
+ * len: Bytes in the log
+ *
+ * Returns: The number of records added
+ */
+size_t history_log_load(History *history, const char *log, size_t len)
+{
+    size_t minimum = sizeof(HistoryRecord) + sizeof(uint32_t);
+    size_t start = len;
+    size_t count = 0;
+    while (count < history->ring.capacity && start - HISTORY_LOG_MAGIC_BYTES >= minimum)
+    {
+        uint32_t length;
+        memcpy(&length, log + start - sizeof(length), sizeof(length));
+        if (length < minimum || length > start - HISTORY_LOG_MAGIC_BYTES ||
+            history_log_record_length(log, start - length, start) != length)
+        {
+            break;
+        }
+        start -= length;
+        count++;
+    }
+
+    // Forwards again over the records found
+    for (size_t i = 0; i < count; i++)
+    {
+        HistoryRecord record;
+        memcpy(&record, log + start, sizeof(record));
+        const char *expression = log + start + sizeof(record);
+        if (record.digitsLen > 0)
+        {
+            history_push(history, expression, record.expressionLen, record.base,
+                         expression + record.expressionLen, record.digitsLen);
+        }
+        else
+        {
+            char digits[FORMAT_DIGITS_BYTES];
+            char *first = format_digits(record.value, record.base,
+                                        digits + sizeof(digits));
+            history_push(history, expression, record.expressionLen, record.base,
+                         first, (size_t)(digits + sizeof(digits) - first));
+        }
+        start += record.length;
+    }
+    return count;
+}
+
+/* history_log_append()
+ * --------------------
+ * Appends one record to the --history-file log with a single writev(), so
+ * that the record lands whole at the end of the log. If the write fails
+ * the log is closed and nothing more is appended this session.
+ *
+ * history: The history, with its log open
+ * expression: The mathematical expression (need not be null terminated)
+ * len: Number of characters in the expression
+ * base: The base used for the expression
+ * result: The calculated result value
+ * bigResult: Result digits in base if it does not fit in result (may be NULL)
+ * bigResultLen: Number of characters in bigResult
+ */
+void history_log_append(History *history, const char *expression, size_t len,
+                        int base, unsigned long long result,
+                        const char *bigResult, size_t bigResultLen)
+{
+    size_t length = sizeof(HistoryRecord) + len + bigResultLen + sizeof(uint32_t);
+    if (length > UINT32_MAX)
+    {
+        return; // Too long to record
+    }
+    HistoryRecord record;
+    record.length = (uint32_t)length;
+    record.base = (uint8_t)base;
+    record.value = bigResult ? 0 : result;
+    record.expressionLen = (uint32_t)len;
+    record.digitsLen = bigResult ? (uint32_t)bigResultLen : 0;
+    uint32_t trailer = record.length;
+
+    struct iovec iov[4] = {
+        {&record, sizeof(record)},
+        {(void *)expression, len},
+        {(void *)bigResult, bigResult ? bigResultLen : 0},
+        {&trailer, sizeof(trailer)},
+    };
+    if (writev(history->logFd, iov, 4) != (ssize_t)length)
+    {
+        close(history->logFd);
+        history->logFd = -1;
+    }
+}
+
+/* free_history()
+ * --------------
+ * Frees all memory allocated for the calculation history.
+ *
+ * cfg: Pointer to Config structure containing history (may be NULL)
+ *
+ * Global variables modified: cfg->history
+ */
+void free_history(Config *cfg)
+{
+    if (!cfg)
+    {
+        return;
+    }
+
+    if (cfg->history.logFd >= 0)
+    {
+        close(cfg->history.logFd);
+        cfg->history.logFd = -1;
+    }
+    history_ring_free(&cfg->history.ring);
+}
+
+/* is_in_base_range()
+ * ------------------
+ * Checks if a character is valid for a given number base.
+ *
+ * ch: The character to check
+ * base: The number base to validate against (2-36)
+ * outputCharacter: Pointer to store the validated character (may be NULL)
+ *
+ * Returns: true if character is valid for the base, false otherwise
+ */
+bool is_in_base_range(int ch, int base, char *outputCharacter)
+{
+    if (isdigit(ch))
+    {
+        int digit = ch - '0';
+        if (digit < base)
+        {
+            if (outputCharacter)
+            {
+                *outputCharacter = (char)ch;
+            }
+            return true;
+        }
+    }
+    else if (isalpha(ch))
+    {
+        // ch = toupper(ch);
+        int digit = toupper(ch) - 'A' + DECIMAL;
+        if (digit < base)
+        {
+            if (outputCharacter)
+            {
+                *outputCharacter = (char)ch;
+                //*outputCharacter = (char)toupper(ch);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* normalize_input_literal()
+ * -------------------------
+ * Rewrites the literal being typed in its canonical form in the input base
+ * (uppercase digits, no leading zeros) before it joins the expression.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * inputBuffer: The literal typed so far (must not be NULL or empty)
+ *
+ * Returns: A string in cfg->scratch (valid until the next key is handled),
+ *          or NULL on error.
+ */
+char *normalize_input_literal(Config *cfg, const char *inputBuffer)
+{
+    if (cfg->precision != PRECISION_DOUBLE)
+    {
+        BigInt value;
+        bigint_init(&value);
+        char *normalized = NULL;
+        if (bigint_from_str(&value, inputBuffer, strlen(inputBuffer),
+                            cfg->inputBase) == 0)
+        {
+            normalized = bigint_to_str_arena(&cfg->scratch, &value, cfg->inputBase);
+        }
+        bigint_free(&value);
+        return normalized;
+    }
+
+    return convert_int_to_str_any_base_arena(
+        &cfg->scratch, convert_str_to_int_any_base(inputBuffer, cfg->inputBase),
+        cfg->inputBase);
+}
+
+/* append_string()
+ * ---------------
+ * Appends a string to a dynamically allocated buffer, expanding as needed.
+ *
+ * expressionBuffer: Pointer to the buffer pointer (may be reallocated)
+ * expressionBufferLen: Pointer to current buffer length
+ * expressionBufferCapacity: Pointer to current buffer capacity
+ * inputBuffer: String to append (must not be NULL)
+ * inputBufferLen: Length of string to append
+ *
+ * Global variables modified: None
+ * Errors: Prints error message to stderr if memory allocation fails
+ */
+void append_string(char **expressionBuffer, size_t *expressionBufferLen,
+                   size_t *expressionBufferCapacity, const char *inputBuffer,
+                   size_t inputBufferLen)
+{
+    // Check if we need to expand the buffer capacity
+    if ((*expressionBufferLen) + (inputBufferLen) + 1 > (*expressionBufferCapacity))
+    {
+        // Calculate new capacity (double current or start with INITIAL_CAPACITY)
+        size_t newCap = (*expressionBufferCapacity == 0)
+                            ? INITIAL_CAPACITY
+                            : (*expressionBufferCapacity) * 2;
+        // Keep doubling until we have enough space
+        while (newCap < (*expressionBufferLen) + (inputBufferLen) + 1)
+        {
+            newCap *= 2;
+        }
+        // Reallocate buffer with new capacity
+        char *newBuffer = realloc(*expressionBuffer, newCap);
+        if (!newBuffer)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            free(*expressionBuffer);
+            return;
+        }
+        *expressionBuffer = newBuffer;
+        *expressionBufferCapacity = newCap;
+    }
+    // Allocate initial buffer if needed
+    if (!*expressionBuffer)
+    {
+        *expressionBuffer = malloc(*expressionBufferCapacity);
+        if (!*expressionBuffer)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return;
+        }
+    }
+    // Copy the input string to the buffer and update length
+    memcpy(*expressionBuffer + *expressionBufferLen, inputBuffer,
+           inputBufferLen);
+    (*expressionBufferLen) += (inputBufferLen);
+    (*expressionBuffer)[*expressionBufferLen] = '\0';
+}
+
+/* append_char()
+ * -------------
+ * Appends a single character to a dynamically allocated buffer.
+ *
+ * expressionBuffer: Pointer to the buffer pointer (may be reallocated)
+ * exprLen: Pointer to current buffer length
+ * capacity: Pointer to current buffer capacity
+ * ch: Character to append
+ *
+ * Global variables modified: None
+ * Errors: Prints error message to stderr if memory allocation fails
+ */
+void append_char(
+    char **expressionBuffer, size_t *exprLen, size_t *capacity, char ch)
+{
+    char tmp[2] = {ch, '\0'};
+    size_t len = strlen(tmp);
+    append_string(expressionBuffer, exprLen, capacity, tmp, len);
+}
+
+/* handle_operators()
+ * ------------------
+ * Processes operator input by converting current input buffer to expression
+ * format.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * expressionBuffer: Pointer to the expression buffer pointer
+ * expressionBufferLen: Pointer to expression buffer length
+ * expressionBufferCapacity: Pointer to expression buffer capacity
+ * inputBuffer: Current input buffer content
+ * inputBufferLen: Length of current input buffer
+ *
+ * Global variables modified: None
+ * REF: This function was refactored and broken down from a larger function with
+ * REF: assistance from GitHub Copilot to improve code modularity and
+ * readability.
+ */
+void handle_operators(Config *cfg, char **expressionBuffer,
+                      size_t *expressionBufferLen, size_t *expressionBufferCapacity,
+                      const char *inputBuffer, size_t inputBufferLen)
+{
+    if (inputBufferLen > 0)
+    {
+        char *normalizedInput = normalize_input_literal(cfg, inputBuffer);
+        if (normalizedInput)
+        {
+            size_t tmpLen = strlen(normalizedInput);
+            append_string(expressionBuffer, expressionBufferLen,
+                          expressionBufferCapacity, normalizedInput, tmpLen);
+        }
+    }
+    else
+    {
+        append_char(expressionBuffer, expressionBufferLen,
+                    expressionBufferCapacity, '0');
+    }
+}
+
+/* evaluate_and_display_result()
+ * -----------------------------
+ * Evaluates the current expression and displays results in all configured
+ * bases.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * expressionBuffer: The expression string to evaluate
+ * expressionBufferLen: Pointer to expression buffer length (will be reset)
+ *
+ * Global variables modified: cfg->history (via add_history)
+ * Errors: Prints error message to stderr if expression cannot be evaluated
+ * REF: This function was created by breaking down a larger function with
+ * assistance REF: from GitHub Copilot to improve code modularity and meet
+ * function size limits.
+ */
+void evaluate_and_display_result(
+    Config *cfg, char *expressionBuffer, size_t *expressionBufferLen)
+{
+    OutputBuffer out;
+    output_init(&out);
+    bool evaluated = evaluate_typed_expression(cfg, &out, expressionBuffer,
+                                               *expressionBufferLen);
+
+    // A result replaces the screen; an error is added below it
+    screen_begin(&cfg->screen, evaluated);
+    output_append_buffer(&cfg->screen.next, &out);
+    screen_show(&cfg->screen);
+    output_free(&out);
+
+    *expressionBufferLen = 0;
+    expressionBuffer[0] = '\0';
+}
+
+/* evaluate_typed_expression()
+ * ---------------------------
+ * Evaluates an expression entered interactively, adds it to the history and
+ * appends the display of its result in all configured bases.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * out: Pointer to OutputBuffer to receive the display
+ * expression: The expression to evaluate (need not be null terminated)
+ * len: Number of characters in the expression
+ *
+ * Returns: true if the expression was evaluated, false otherwise
+ * Global variables modified: cfg->history (via add_history)
+ * Errors: Adds an error message for stderr if expression cannot be evaluated
+ */
+bool evaluate_typed_expression(Config *cfg, OutputBuffer *out,
+                               const char *expression, size_t len)
+{
+    STATS_COUNT(expressions);
+    if (cfg->precision == PRECISION_BIG)
+    {
+        return evaluate_typed_big_expression(cfg, out, expression, len);
+    }
+
+    unsigned long long result = 0;
+    int status;
+    if (cfg->precision == PRECISION_INT)
+    {
+        BigInt wide;
+        bigint_init(&wide);
+        status = evaluate_expression_int_arena(&cfg->scratch, expression, len,
+                                               cfg->inputBase, &result, &wide);
+        if (status == EVAL_WIDE)
+        {
+            show_typed_big_result(cfg, out, expression, len, &wide);
+        }
+        bigint_free(&wide);
+        if (status == EVAL_WIDE)
+        {
+            return true;
+        }
+    }
+    else
+    {
+        status = evaluate_expression_in_base_arena(&cfg->scratch, expression, len,
+                                                   cfg->inputBase, &result);
+    }
+    if (status != 0)
+    {
+        stats_reject(rejection_reason(expression, len, cfg->inputBase));
+        output_expression_line(out, stderr, "Cannot evaluate the expression \"",
+                               expression, len, "\"\n");
+        return false;
+    }
+    add_history(cfg, expression, len, cfg->inputBase, result, NULL, 0);
+
+    output_result_line(out, "Expression (base ", "): ", cfg->inputBase, NULL);
+    output_expression_line(out, stdout, "", expression, len, "\n");
+    output_result_line(out, "Result (base ", "): ", cfg->inputBase, &result);
+    output_base_lines(out, result, cfg->oBases, cfg->oBasesCount);
+    return true;
+}
+
+/* evaluate_typed_big_expression()
+ * -------------------------------
+ * Arbitrary-precision counterpart of evaluate_typed_expression(), used
+ * when the calculator runs with --precision big.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * out: Pointer to OutputBuffer to receive the display
+ * expression: The expression to evaluate (need not be null terminated)
+ * len: Number of characters in the expression
+ *
+ * Returns: true if the expression was evaluated, false otherwise
+ * Global variables modified: cfg->history (via add_history)
+ * Errors: Adds an error message for stderr if expression cannot be evaluated
+ */
+bool evaluate_typed_big_expression(Config *cfg, OutputBuffer *out,
+                                   const char *expression, size_t len)
+{
+    BigInt result;
+    bigint_init(&result);
+
+    if (evaluate_expression_big_arena(&cfg->scratch, expression, len, cfg->inputBase,
+                                      &result) != 0)
+    {
+        stats_reject(rejection_reason(expression, len, cfg->inputBase));
+        output_expression_line(out, stderr, "Cannot evaluate the expression \"",
+                               expression, len, "\"\n");
+        bigint_free(&result);
+        return false;
+    }
+
+    show_typed_big_result(cfg, out, expression, len, &result);
+    bigint_free(&result);
+    return true;
+}
+
+/* show_typed_big_result()
+ * -----------------------
+ * Adds an arbitrary-precision result to the history and appends its
+ * display in all configured bases.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * out: Pointer to OutputBuffer to receive the display
+ * expression: The expression that was evaluated (need not be null terminated)
+ * len: Number of characters in the expression
+ * result: The value of the expression
+ *
+ * Global variables modified: cfg->history (via add_history)
+ */
+void show_typed_big_result(Config *cfg, OutputBuffer *out,
+                           const char *expression, size_t len,
+                           const BigInt *result)
+{
+    // Results wider than 64 bits are kept as digits in the input base
+    if (bigint_fits_u64(result))
+    {
+        add_history(cfg, expression, len, cfg->inputBase,
+                    bigint_mag_u64(result), NULL, 0);
+    }
+    else
+    {
+        char *digits = bigint_to_str_arena(&cfg->scratch, result, cfg->inputBase);
+        if (digits)
+        {
+            add_history(cfg, expression, len, cfg->inputBase, 0, digits,
+                        strlen(digits));
+        }
+    }
+
+    output_result_line(out, "Expression (base ", "): ", cfg->inputBase, NULL);
+    output_expression_line(out, stdout, "", expression, len, "\n");
+    display_big_result(out, &cfg->scratch, result, cfg->inputBase,
+                       cfg->oBasesCount, cfg->oBases);
+}
+
+/* paste_command()
+ * ---------------
+ * Runs a pasted command line (:i, :o or :h) exactly as if it had been
+ * typed, key by key, followed by Enter.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * line: The pasted line, starting with its ':'
+ * len: Number of characters in line
+ * expressionBuffer: Pointer to the expression buffer pointer
+ * expressionBufferLen: Pointer to expression buffer length
+ * input: The literal being typed
+ *
+ * Global variables modified: cfg->inputBase, cfg->oBases, cfg->oBasesCount (via
+ * handle_command_mode)
+ */
+void paste_command(Config *cfg, const char *line, size_t len,
+                   char **expressionBuffer, size_t *expressionBufferLen,
+                   InputBuffer *input)
+{
+    char commandBuffer[MAX_CMD_INPUT] = {'\0'};
+    size_t commandBufferLen = 0;
+    bool command = false;
+    handle_colon_command(&command, &commandBufferLen, commandBuffer);
+    for (size_t i = 1; i <= len; i++)
+    {
+        int ch = i < len ? (unsigned char)line[i] : '\n';
+        handle_command_mode(cfg, ch, &command, commandBuffer, &commandBufferLen,
+                            expressionBuffer, expressionBufferLen, input->text,
+                            &input->len);
+    }
+}
+
+/* paste_evaluate()
+ * ----------------
+ * Evaluates a pasted block of text line by line, as file mode would, and
+ * shows the results of consecutive lines together on one screen. Each
+ * expression is added to the history; blank lines are skipped. A line
+ * starting with ':' is a command and is run as if typed (see
+ * paste_command()), so the lines after a base change use the new bases.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * text: The pasted text
+ * len: Number of bytes in text
+ * expressionBuffer: Pointer to the expression buffer pointer
+ * expressionBufferLen: Pointer to expression buffer length
+ * input: The literal being typed
+ *
+ * Returns: true if the screen ends with results, false if it ends with
+ *          the display of a command (or nothing was pasted)
+ * Global variables modified: cfg->history (via add_history)
+ * Errors: Adds an error message for stderr for each line that cannot be
+ * evaluated
+ */
+bool paste_evaluate(Config *cfg, const char *text, size_t len,
+                    char **expressionBuffer, size_t *expressionBufferLen,
+                    InputBuffer *input)
+{
+    bool results = false; // Whether the frame being built holds results
+    const char *line = text;
+    const char *end = text + len;
+    while (line < end)
+    {
+        const char *newline = memchr(line, '\n', (size_t)(end - line));
+        size_t rawLen = newline ? (size_t)(newline - line) + 1 : (size_t)(end - line);
+        size_t lineLen = trimmed_line_length(line, rawLen);
+        if (lineLen > 0 && line[0] == ':')
+        {
+            // The results so far are shown before the command redraws
+            if (results)
+            {
+                screen_show(&cfg->screen);
+                results = false;
+            }
+            paste_command(cfg, line, lineLen, expressionBuffer,
+                          expressionBufferLen, input);
+        }
+        else if (lineLen > 0)
+        {
+            if (!results)
+            {
+                screen_begin(&cfg->screen, true);
+                results = true;
+            }
+            evaluate_typed_expression(cfg, &cfg->screen.next, line, lineLen);
+        }
+        arena_reset(&cfg->scratch);
+        line += rawLen;
+    }
+    if (results)
+    {
+        screen_show(&cfg->screen);
+    }
+    return results;
+}
+
+/* enable_line_buffering()
+ * -----------------------
+ * Restores canonical mode and echo on the terminal and turns bracketed
+ * paste off. Typically used to undo the effects of disable_line_buffering().
+ */
+void enable_line_buffering(void)
+{
+    if (termiosInitialized)
+    {
+        printf("\033[?2004l");
+        fflush(stdout);
+        tcsetattr(STDIN_FILENO, TCSANOW, &originalTermios);
+        termiosInitialized = false; // The atexit call has nothing left to do
+    }
+}
+
+/* disable_line_buffering()
+ * ------------------------
+ * Disables canonical mode and echo on the terminal to allow
+ * character-by-character input, and turns on bracketed paste. Registers
+ * enable_line_buffering() to be called at exit to restore settings.
+ */
+void disable_line_buffering(void)
+{
+    if (!isatty(STDIN_FILENO))
+    {
+        return;
+    }
+
+    static bool restoreRegistered = false;
+    if (!termiosInitialized)
+    {
+        tcgetattr(STDIN_FILENO, &originalTermios);
+        termiosInitialized = true;
+    }
+    if (!restoreRegistered)
+    {
+        restoreRegistered = true;
+        atexit(enable_line_buffering);
+    }
+
+    struct termios raw = originalTermios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+    // Ask the terminal to mark pastes (see key_reader_next())
+    printf("\033[?2004h");
+    fflush(stdout);
+}
+
+/* clear_screen()
+ * --------------
+ * Uses ANSI escape codes to clear the screen and reset the cursor position.
+ * If standard input is not from a terminal, this function will do nothing.
+ */
+void clear_screen(void)
+{
+    if (!isatty(STDIN_FILENO))
+    {
+        return;
+    }
+    printf("\033[2J\033[H");
+    fflush(stdout);
+}
+
+/* preview_push()
+ * --------------
+ * Folds a digit appended to the interactive input buffer into the preview
+ * value: value = value * base + digit.
+ *
+ * cfg: Pointer to Config structure holding the preview
+ * digit: The digit appended, valid in cfg->inputBase
+ */
+void preview_push(Config *cfg, char digit)
+{
+    InputPreview *preview = &cfg->preview;
+    unsigned long long base = (unsigned long long)cfg->inputBase;
+    unsigned long long value = (unsigned long long)digit_value(digit);
+
+    preview->len++;
+    if (!preview->wrapLen && preview->value > (~0ULL - value) / base)
+    {
+        preview->wrapLen = preview->len;
+    }
+    preview->value = preview->value * base + value;
+    if (cfg->precision != PRECISION_DOUBLE)
+    {
+        bigint_mul_small_add(&preview->big, (BigLimb)base, (BigLimb)value);
+    }
+}
+
+/* preview_pop()
+ * -------------
+ * Undoes preview_push() for a digit removed from the end of the interactive
+ * input buffer. Dividing by the base undoes an exact push; once the value
+ * has wrapped modulo 2^64 the shorter literal is read again instead.
+ *
+ * cfg: Pointer to Config structure holding the preview
+ * inputBuffer: The input buffer after the digit was removed
+ * inputBufferLen: Length of the input buffer
+ */
+void preview_pop(Config *cfg, const char *inputBuffer, size_t inputBufferLen)
+{
+    InputPreview *preview = &cfg->preview;
+    if (preview->len == 0)
+    {
+        return;
+    }
+
+    preview->len--;
+    if (preview->wrapLen)
+    {
+        digit_run_parse(inputBuffer, inputBufferLen, cfg->inputBase, &preview->value);
+        if (preview->len < preview->wrapLen)
+        {
+            preview->wrapLen = 0;
+        }
+    }
+    else
+    {
+        preview->value /= (unsigned long long)cfg->inputBase;
+    }
+    if (cfg->precision != PRECISION_DOUBLE)
+    {
+        bigint_div_small(&preview->big, (BigLimb)cfg->inputBase);
+    }
+}
+
+/* preview_clear()
+ * ---------------
+ * Resets the preview value when the interactive input buffer is emptied.
+ *
+ * cfg: Pointer to Config structure holding the preview
+ */
+void preview_clear(Config *cfg)
+{
+    cfg->preview.len = 0;
+    cfg->preview.wrapLen = 0;
+    cfg->preview.value = 0;
+    bigint_set_u64(&cfg->preview.big, 0);
+}
+
+/* screen_fits()
+ * -------------
+ * Checks whether every line of a frame fits on one terminal row and the
+ * whole frame fits on the screen, so that line n of the frame is row n.
+ *
+ * frame: The lines to check, each ending in '\n'
+ * size: Size of the terminal
+ *
+ * Returns: true if the frame can be updated in place, false otherwise
+ */
+bool screen_fits(const OutputBuffer *frame, const struct winsize *size)
+{
+    size_t rows = 0, start = 0;
+    for (size_t i = 0; i < frame->len; i++)
+    {
+        if (frame->data[i] == '\n')
+        {
+            if (i - start >= size->ws_col)
+            {
+                return false;
+            }
+            rows++;
+            start = i + 1;
+        }
+    }
+    return rows < size->ws_row;
+}
+
+/* screen_begin()
+ * --------------
+ * Starts the next frame of the interactive display in screen->next. A new
+ * frame replaces the screen; otherwise the text is added below what is
+ * already on it, or below a frame that has not been painted yet.
+ *
+ * screen: Pointer to PreviewScreen to build the frame in
+ * clear: Whether the frame replaces the screen
+ */
+void screen_begin(PreviewScreen *screen, bool clear)
+{
+    if (clear || !screen->pending)
+    {
+        screen->next.len = 0;
+        screen->next.segmentCount = 0;
+        screen->clear = clear;
+    }
+}
+
+/* screen_show()
+ * -------------
+ * Finishes the frame in screen->next. On a terminal the frame is only
+ * painted once the input is idle (see key_reader_fill()), so a burst of
+ * keys costs one redraw; otherwise it is written at once.
+ *
+ * screen: Pointer to PreviewScreen holding the frame
+ */
+void screen_show(PreviewScreen *screen)
+{
+    screen->pending = true;
+    if (!screen->terminal)
+    {
+        screen_paint(screen);
+    }
+}
+
+/* screen_flush()
+ * --------------
+ * Paints the frame in screen->next if it has not been painted yet.
+ *
+ * screen: Pointer to PreviewScreen holding the frame
+ */
+void screen_flush(PreviewScreen *screen)
+{
+    if (screen->pending)
+    {
+        screen_paint(screen);
+    }
+}
+
+/* screen_paint()
+ * --------------
+ * Puts the frame in screen->next on the screen. When the terminal still
+ * shows the previous frame, only the lines that differ from it are
+ * rewritten, each addressed by row; otherwise the screen is cleared (if the
+ * frame replaces it) and the whole frame written, as clear_screen() would.
+ * If standard input is not from a terminal the frame is written as plain
+ * text.
+ *
+ * screen: Pointer to PreviewScreen holding the previous and next frames
+ */
+void screen_paint(PreviewScreen *screen)
+{
+    OutputBuffer *shown = &screen->shown, *next = &screen->next;
+    bool stdoutOnly = next->segmentCount == 0 ||
+                      (next->segmentCount == 1 && next->segments[0].stream == stdout);
+    struct winsize size;
+
+    if (!screen->terminal || !screen->clear || !screen->painted || !stdoutOnly ||
+        ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 ||
+        !screen_fits(shown, &size) || !screen_fits(next, &size))
+    {
+        if (screen->terminal && screen->clear)
+        {
+            fputs("\033[2J\033[H", stdout);
+        }
+        size_t start = 0;
+        for (size_t i = 0; i < next->segmentCount; i++)
+        {
+            FILE *stream = next->segments[i].stream;
+            fwrite(next->data + start, 1, next->segments[i].end - start, stream);
+            fflush(stream);
+            start = next->segments[i].end;
+        }
+    }
+    else
+    {
+        size_t row = 1, old = 0, cur = 0;
+        while (cur < next->len)
+        {
+            const char *line = next->data + cur;
+            size_t len = (size_t)((const char *)memchr(line, '\n', next->len - cur) - line);
+            bool same = false;
+            if (old < shown->len)
+            {
+                const char *oldLine = shown->data + old;
+                size_t oldLen = (size_t)((const char *)memchr(
+                    oldLine, '\n', shown->len - old) - oldLine);
+                same = oldLen == len && memcmp(oldLine, line, len) == 0;
+                old += oldLen + 1;
+            }
+            if (!same)
+            {
+                printf("\033[%zu;1H", row);
+                fwrite(line, 1, len, stdout);
+                fputs("\033[K", stdout);
+            }
+            cur += len + 1;
+            row++;
+        }
+        // Erase whatever is left of a longer previous frame
+        if (old < shown->len)
+        {
+            printf("\033[%zu;1H\033[J", row);
+        }
+        printf("\033[%zu;1H", row);
+    }
+    fflush(stdout);
+
+    OutputBuffer painted = *shown;
+    *shown = *next;
+    *next = painted;
+    next->len = 0;
+    next->segmentCount = 0;
+    // Text added below an unknown screen leaves nothing to compare with
+    screen->painted = screen->terminal && screen->clear;
+    screen->pending = false;
+}
+
+/* stdrd_input_expr_display()
+ * --------------------------
+ * Displays the current expression and input state in the interactive interface.
+ * The value of the input comes from cfg->preview, which the key handlers
+ * keep in step with the input buffer.
+ *
+ * cfg: Pointer to Config structure containing current settings
+ * expressionBuffer: Current expression string (may be NULL)
+ * inputBuffer: Current input buffer string (may be NULL)
+ *
+ * Returns: Nothing (void)
+ */
+void stdrd_input_expr_display(Config *cfg, const char *expressionBuffer,
+                              const char *inputBuffer)
 {
-    if (!cfg || !expression)
+    OutputBuffer *frame = &cfg->screen.next;
+    screen_begin(&cfg->screen, true);
+
+    // Display current expression being built
+    output_printf(frame, stdout, "Expression (base %d): %s\n", cfg->inputBase,
+                  expressionBuffer ? expressionBuffer : "");
+
+    // Display current input buffer
+    output_printf(frame, stdout, "Input (base %d): %s\n", cfg->inputBase,
+                  inputBuffer ? inputBuffer : "");
+
+    // Display the input in all configured output bases
+    bool wide = cfg->precision == PRECISION_BIG ||
+                (cfg->precision == PRECISION_INT && cfg->preview.wrapLen);
+    if (!wide)
     {
-        return;
+        output_base_lines(frame, cfg->preview.value, cfg->oBases, cfg->oBasesCount);
     }
-    // Expand history array if at capacity
-    if (cfg->historyCount >= cfg->historyCapacity)
+    for (int i = 0; wide && i < cfg->oBasesCount; i++)
     {
-        size_t newCapacity = (cfg->historyCapacity == 0)
-                                 ? MAX_INPUT
-                                 : (cfg->historyCapacity * 2);
-        HistoryEntry *newHistory = realloc(cfg->history, sizeof(HistoryEntry) * newCapacity);
-        if (!newHistory)
-        {
-            fprintf(stderr, "Memory allocation failed\n");
-            return;
-        }
-        cfg->history = newHistory;
-        cfg->historyCapacity = newCapacity;
-    }
-
-    // Add new entry to history
-    HistoryEntry *entry = &cfg->history[cfg->historyCount];
-    entry->expression = strdup(expression); // Make a copy of expression
-    if (!entry->expression)
-    { // Check if strdup failed
-        return;
+        // Wide literals need the arbitrary-precision display
+        int base = cfg->oBases[i];
+        char *resultExpression = bigint_to_str_arena(&cfg->scratch, &cfg->preview.big, base);
+        output_printf(frame, stdout, "Base %d: %s\n", base,
+                      resultExpression ? resultExpression : "0");
     }
-    cfg->historyCount++;
-    entry->base = base;
-    entry->result = result;
+    screen_show(&cfg->screen);
 }
 
-/* free_history()
- * --------------
- * Frees all memory allocated for the calculation history.
- *
- * cfg: Pointer to Config structure containing history (may be NULL)
+/* input_buffer_init()
+ * -------------------
+ * Initializes an empty input buffer using its inline storage.
  *
- * Global variables modified: cfg->history, cfg->historyCount,
- * cfg->historyCapacity
+ * input: Pointer to InputBuffer to initialize
  */
-void free_history(Config *cfg)
+void input_buffer_init(InputBuffer *input)
 {
-    if (!cfg)
-    {
-        return;
-    }
+    input->text = input->inlineText;
+    input->len = 0;
+    input->capacity = INPUT_INLINE_BYTES;
+    input->text[0] = '\0';
+}
 
-    for (size_t i = 0; i < cfg->historyCount; i++)
+/* input_buffer_free()
+ * -------------------
+ * Releases the heap storage of an input buffer, if any, and leaves it empty.
+ *
+ * input: Pointer to InputBuffer to release
+ */
+void input_buffer_free(InputBuffer *input)
+{
+    if (input->text != input->inlineText)
     {
-        free(cfg->history[i].expression);
+        free(input->text);
     }
-    free(cfg->history);
-    cfg->history = NULL;
-    cfg->historyCount = 0;
-    cfg->historyCapacity = 0;
+    input_buffer_init(input);
 }
 
-/* is_in_base_range()
- * ------------------
- * Checks if a character is valid for a given number base.
+/* input_buffer_push()
+ * -------------------
+ * Appends a character to an input buffer, moving it to the heap or doubling
+ * its heap capacity when it is full.
  *
- * ch: The character to check
- * base: The number base to validate against (2-36)
- * outputCharacter: Pointer to store the validated character (may be NULL)
+ * input: Pointer to InputBuffer to append to
+ * ch: Character to append
  *
- * Returns: true if character is valid for the base, false otherwise
+ * Returns: true if the character was appended, false otherwise
+ * Errors: Prints error message to stderr if memory allocation fails
  */
-bool is_in_base_range(int ch, int base, char *outputCharacter)
+bool input_buffer_push(InputBuffer *input, char ch)
 {
-    if (isdigit(ch))
+    if (input->len == input->capacity)
     {
-        int digit = ch - '0';
-        if (digit < base)
+        size_t newCapacity = input->capacity * 2;
+        bool onHeap = input->text != input->inlineText;
+        char *newText = realloc(onHeap ? input->text : NULL, newCapacity + 1);
+        if (!newText)
         {
-            if (outputCharacter)
-            {
-                *outputCharacter = (char)ch;
-            }
-            return true;
+            fprintf(stderr, "Memory allocation failed\n");
+            return false;
         }
-    }
-    else if (isalpha(ch))
-    {
-        // ch = toupper(ch);
-        int digit = toupper(ch) - 'A' + DECIMAL;
-        if (digit < base)
+        if (!onHeap)
         {
-            if (outputCharacter)
-            {
-                *outputCharacter = (char)ch;
-                //*outputCharacter = (char)toupper(ch);
-            }
-            return true;
+            memcpy(newText, input->inlineText, input->len + 1);
         }
+        input->text = newText;
+        input->capacity = newCapacity;
     }
+    input->text[input->len++] = ch;
+    input->text[input->len] = '\0';
+    return true;
+}
 
-    return false;
+/* key_reader_init()
+ * -----------------
+ * Initializes an empty key reader.
+ *
+ * reader: Pointer to KeyReader to initialize
+ * bracketed: Whether bracketed paste is turned on in the terminal
+ */
+void key_reader_init(KeyReader *reader, bool bracketed)
+{
+    reader->pos = 0;
+    reader->len = 0;
+    reader->bracketed = bracketed;
+    reader->paste = NULL;
+    reader->pasteLen = 0;
+    reader->pasteCapacity = 0;
+    reader->replayed = 0;
 }
 
-/* append_string()
- * ---------------
- * Appends a string to a dynamically allocated buffer, expanding as needed.
+/* key_reader_free()
+ * -----------------
+ * Releases the paste buffer of a key reader.
  *
- * expressionBuffer: Pointer to the buffer pointer (may be reallocated)
- * expressionBufferLen: Pointer to current buffer length
- * expressionBufferCapacity: Pointer to current buffer capacity
- * inputBuffer: String to append (must not be NULL)
- * inputBufferLen: Length of string to append
+ * reader: Pointer to KeyReader to release
+ */
+void key_reader_free(KeyReader *reader)
+{
+    free(reader->paste);
+    key_reader_init(reader, reader->bracketed);
+}
+
+/* key_reader_fill()
+ * -----------------
+ * Refills the reader with every byte of input that is available, waiting
+ * for at least one. A frame that is waiting to be painted is painted first
+ * if no input is ready, so the screen is only redrawn once a burst of keys
+ * (a fast typist, or a paste) has been handled.
  *
- * Global variables modified: None
- * Errors: Prints error message to stderr if memory allocation fails
+ * reader: Pointer to KeyReader to refill
+ * screen: Pointer to PreviewScreen of the interactive display
+ *
+ * Returns: true if bytes were read, false on end of input or error
  */
-void append_string(char **expressionBuffer, size_t *expressionBufferLen,
-                   size_t *expressionBufferCapacity, const char *inputBuffer,
-                   size_t inputBufferLen)
+bool key_reader_fill(KeyReader *reader, PreviewScreen *screen)
 {
-    // Check if we need to expand the buffer capacity
-    if ((*expressionBufferLen) + (inputBufferLen) + 1 > (*expressionBufferCapacity))
+    struct pollfd ready = {STDIN_FILENO, POLLIN, 0};
+    if (screen->pending && poll(&ready, 1, 0) <= 0)
     {
-        // Calculate new capacity (double current or start with MAX_INPUT)
-        size_t newCap = (*expressionBufferCapacity == 0)
-                            ? MAX_INPUT
-                            : (*expressionBufferCapacity) * 2;
-        // Keep doubling until we have enough space
-        while (newCap < (*expressionBufferLen) + (inputBufferLen) + 1)
-        {
-            newCap *= 2;
-        }
-        // Reallocate buffer with new capacity
-        char *newBuffer = realloc(*expressionBuffer, newCap);
-        if (!newBuffer)
-        {
-            fprintf(stderr, "Memory allocation failed\n");
-            free(*expressionBuffer);
-            return;
-        }
-        *expressionBuffer = newBuffer;
-        *expressionBufferCapacity = newCap;
+        screen_paint(screen);
     }
-    // Allocate initial buffer if needed
-    if (!*expressionBuffer)
+
+    ssize_t got;
+    do
     {
-        *expressionBuffer = malloc(*expressionBufferCapacity);
-        if (!*expressionBuffer)
-        {
-            fprintf(stderr, "Memory allocation failed\n");
-            return;
-        }
-    }
-    // Copy the input string to the buffer and update length
-    memcpy(*expressionBuffer + *expressionBufferLen, inputBuffer,
-           inputBufferLen);
-    (*expressionBufferLen) += (inputBufferLen);
-    (*expressionBuffer)[*expressionBufferLen] = '\0';
+        got = read(STDIN_FILENO, reader->data, sizeof(reader->data));
+    } while (got < 0 && errno == EINTR);
+    reader->pos = 0;
+    reader->len = got > 0 ? (size_t)got : 0;
+    return got > 0;
 }
 
-/* append_char()
- * -------------
- * Appends a single character to a dynamically allocated buffer.
+/* key_reader_byte()
+ * -----------------
+ * Takes the next byte of input.
  *
- * expressionBuffer: Pointer to the buffer pointer (may be reallocated)
- * exprLen: Pointer to current buffer length
- * capacity: Pointer to current buffer capacity
- * ch: Character to append
+ * reader: Pointer to KeyReader to read from
+ * screen: Pointer to PreviewScreen of the interactive display
  *
- * Global variables modified: None
- * Errors: Prints error message to stderr if memory allocation fails
+ * Returns: The byte, or EOF at the end of input
  */
-void append_char(
-    char **expressionBuffer, size_t *exprLen, size_t *capacity, char ch)
+int key_reader_byte(KeyReader *reader, PreviewScreen *screen)
 {
-    char tmp[2] = {ch, '\0'};
-    size_t len = strlen(tmp);
-    append_string(expressionBuffer, exprLen, capacity, tmp, len);
+    if (reader->pos == reader->len && !key_reader_fill(reader, screen))
+    {
+        return EOF;
+    }
+    return reader->data[reader->pos++];
 }
 
-/* handle_operators()
- * ------------------
- * Processes operator input by converting current input buffer to expression
- * format.
+/* key_reader_paste_start()
+ * ------------------------
+ * Decides whether the ESC just taken starts PASTE_START. The rest of the
+ * marker may not have been read yet, so while the buffered bytes are a
+ * prefix of it the reader waits up to PASTE_MARKER_WAIT_MS for more input,
+ * appended behind them. A lone ESC key therefore still comes back promptly.
  *
- * cfg: Pointer to Config structure containing current settings
- * expressionBuffer: Pointer to the expression buffer pointer
- * expressionBufferLen: Pointer to expression buffer length
- * expressionBufferCapacity: Pointer to expression buffer capacity
- * inputBuffer: Current input buffer content
- * inputBufferLen: Length of current input buffer
+ * reader: Pointer to KeyReader to read from
  *
- * Global variables modified: None
- * REF: This function was refactored and broken down from a larger function with
- * REF: assistance from GitHub Copilot to improve code modularity and
- * readability.
+ * Returns: true if PASTE_START followed (its bytes are then consumed),
+ *          false if the ESC is the ESC key
  */
-void handle_operators(Config *cfg, char **expressionBuffer,
-                      size_t *expressionBufferLen, size_t *expressionBufferCapacity,
-                      const char *inputBuffer, size_t inputBufferLen)
+bool key_reader_paste_start(KeyReader *reader)
 {
-    if (inputBufferLen > 0)
+    const size_t need = PASTE_MARKER_BYTES - 1;
+    while (1)
     {
+        size_t buffered = reader->len - reader->pos;
+        size_t compared = buffered < need ? buffered : need;
+        if (memcmp(reader->data + reader->pos, PASTE_START + 1, compared) != 0)
+        {
+            return false;
+        }
+        if (compared == need)
+        {
+            reader->pos += need;
+            return true;
+        }
 
-        char *convertInputIntoBaseTen = convert_any_base_to_base_ten(inputBuffer, cfg->inputBase);
-        char *convertBackToInputBase = convert_expression(
-            convertInputIntoBaseTen, DECIMAL, cfg->inputBase);
-
-        // unsigned long long result = 0;
-        if (convertBackToInputBase)
+        // Keep the partial marker and read the rest in behind it
+        memmove(reader->data, reader->data + reader->pos, buffered);
+        reader->pos = 0;
+        reader->len = buffered;
+        struct pollfd ready = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&ready, 1, PASTE_MARKER_WAIT_MS) <= 0)
         {
-            size_t tmpLen = strlen(convertBackToInputBase);
-            append_string(expressionBuffer, expressionBufferLen,
-                          expressionBufferCapacity, convertBackToInputBase, tmpLen);
-            free(convertBackToInputBase);
+            return false;
         }
-        free(convertInputIntoBaseTen);
-    }
-    else
-    {
-        append_char(expressionBuffer, expressionBufferLen,
-                    expressionBufferCapacity, '0');
+        ssize_t got;
+        do
+        {
+            got = read(STDIN_FILENO, reader->data + buffered,
+                       sizeof(reader->data) - buffered);
+        } while (got < 0 && errno == EINTR);
+        if (got <= 0)
+        {
+            return false;
+        }
+        reader->len += (size_t)got;
     }
 }
 
-/* evaluate_and_display_result()
- * -----------------------------
- * Evaluates the current expression and displays results in all configured
- * bases.
+/* key_reader_paste()
+ * ------------------
+ * Collects the text of a bracketed paste, whose start marker has just been
+ * read, up to its end marker (which may arrive in a later read()). Text
+ * holding whole lines is a block for paste_evaluate(); anything else, such
+ * as a long literal, is handed out again as ordinary keys.
  *
- * cfg: Pointer to Config structure containing current settings
- * expressionBuffer: The expression string to evaluate
- * expressionBufferLen: Pointer to expression buffer length (will be reset)
+ * reader: Pointer to KeyReader to read from
+ * screen: Pointer to PreviewScreen of the interactive display
  *
- * Global variables modified: cfg->history (via add_history)
- * Errors: Prints error message to stderr if expression cannot be evaluated
- * REF: This function was created by breaking down a larger function with
- * assistance REF: from GitHub Copilot to improve code modularity and meet
- * function size limits.
+ * Returns: PASTE_BLOCK, the first key of the paste, or EOF
  */
-void evaluate_and_display_result(
-    Config *cfg, char *expressionBuffer, size_t *expressionBufferLen)
+int key_reader_paste(KeyReader *reader, PreviewScreen *screen)
 {
-    char *expressionInBaseTen = convert_expression(expressionBuffer, cfg->inputBase, DECIMAL);
-    unsigned long long result = 0;
-    int evaluationSuccess = 0;
-
-    if (expressionInBaseTen)
+    reader->pasteLen = 0;
+    size_t matched = 0; // Bytes of PASTE_END seen so far
+    while (matched < PASTE_MARKER_BYTES)
     {
-        evaluationSuccess = evaluate_expression(expressionInBaseTen, &result);
-
-        if (evaluationSuccess != 0)
+        int ch = key_reader_byte(reader, screen);
+        if (ch == EOF)
         {
-            fprintf(stderr, "Cannot evaluate the expression \"%s\"\n",
-                    expressionBuffer);
-            *expressionBufferLen = 0;
-            expressionBuffer[0] = '\0';
-            free(expressionInBaseTen);
-            return;
+            return EOF;
         }
-
-        add_history(cfg, expressionBuffer, cfg->inputBase, result);
-
-        clear_screen();
-        printf("Expression (base %d): %s\n", cfg->inputBase, expressionBuffer);
-        char *resultOfTheExpression = convert_int_to_str_any_base(result, cfg->inputBase);
-        printf("Result (base %d): %s\n", cfg->inputBase,
-               resultOfTheExpression ? resultOfTheExpression : "0");
-
-        for (int i = 0; i < cfg->oBasesCount; i++)
+        if (ch == (unsigned char)PASTE_END[matched])
         {
-            int base = cfg->oBases[i];
-            char *outputInBases = convert_int_to_str_any_base(result, base);
-            printf("Base %d: %s\n", base, outputInBases ? outputInBases : "0");
-            free(outputInBases);
+            matched++;
+            continue;
+        }
+        // A partial marker was pasted text after all
+        append_string(&reader->paste, &reader->pasteLen, &reader->pasteCapacity,
+                      PASTE_END, matched);
+        matched = ch == ESC ? 1 : 0;
+        if (!matched)
+        {
+            append_char(&reader->paste, &reader->pasteLen,
+                        &reader->pasteCapacity, (char)ch);
         }
-
-        free(expressionInBaseTen);
-        free(resultOfTheExpression);
-
-        *expressionBufferLen = 0;
-        expressionBuffer[0] = '\0';
     }
-    else
+
+    if (reader->pasteLen && memchr(reader->paste, ENTER, reader->pasteLen))
     {
-        fprintf(stderr, "Cannot evaluate the expression \"%s\"\n",
-                expressionBuffer);
-        *expressionBufferLen = 0;
-        expressionBuffer[0] = '\0';
+        reader->replayed = reader->pasteLen;
+        return PASTE_BLOCK;
     }
+    reader->replayed = 0;
+    return key_reader_next(reader, screen);
 }
 
-/* stdrd_input_expr_display()
- * --------------------------
- * Displays the current expression and input state in the interactive interface.
+/* key_reader_next()
+ * -----------------
+ * Takes the next key of interactive input. With bracketed paste a paste
+ * arrives between PASTE_START and PASTE_END and is collected as a whole by
+ * key_reader_paste(); an ESC that does not start PASTE_START is the ESC key.
+ * The marker is recognised even when a read() splits it (see
+ * key_reader_paste_start()).
  *
- * cfg: Pointer to Config structure containing current settings
- * expressionBuffer: Current expression string (may be NULL)
- * inputBuffer: Current input buffer string (may be NULL)
+ * reader: Pointer to KeyReader to read from
+ * screen: Pointer to PreviewScreen of the interactive display
  *
- * Returns: Nothing (void)
+ * Returns: The key, PASTE_BLOCK for a pasted block (in reader->paste), or
+ *          EOF at the end of input
  */
-void stdrd_input_expr_display(const Config *cfg, const char *expressionBuffer,
-                              const char *inputBuffer)
+int key_reader_next(KeyReader *reader, PreviewScreen *screen)
 {
-    clear_screen();
-
-    // Display current expression being built
-    printf("Expression (base %d): %s\n", cfg->inputBase,
-           expressionBuffer ? expressionBuffer : "");
-
-    // Display current input buffer
-    printf("Input (base %d): %s\n", cfg->inputBase,
-           (inputBuffer && inputBuffer[0]) ? inputBuffer : "");
-    unsigned long long result = 0;
-
-    // Convert and display input in all output bases if input exists
-    if (inputBuffer && inputBuffer[0])
+    if (reader->replayed < reader->pasteLen)
     {
-        size_t size = strlen(inputBuffer);
-        char tempCapitalized[MAX_INPUT + 1] = {'\0'};
-
-        // Convert input to uppercase for consistent base conversion
-        for (size_t i = 0; i < size && i < MAX_INPUT; i++)
-        {
-            tempCapitalized[i] = (isalpha(inputBuffer[i]))
-                                     ? toupper(inputBuffer[i])
-                                     : inputBuffer[i];
-        }
-
-        tempCapitalized[size] = '\0';
-        result = convert_str_to_int_any_base(tempCapitalized, cfg->inputBase);
+        return (unsigned char)reader->paste[reader->replayed++];
     }
 
-    // Display result in all configured output bases
-    for (int i = 0; i < cfg->oBasesCount; i++)
+    int ch = key_reader_byte(reader, screen);
+    if (ch == ESC && reader->bracketed && key_reader_paste_start(reader))
     {
-        int base = cfg->oBases[i];
-        char *resultExpression = convert_int_to_str_any_base(result, base);
-        printf("Base %d: %s\n", base,
-               resultExpression ? resultExpression : "0");
-        free(resultExpression);
+        return key_reader_paste(reader, screen);
     }
-    fflush(stdout);
+    return ch;
 }
 
 /* stdrd_input_expr_evaluation()
@@ -937,27 +5363,53 @@ void stdrd_input_expr_evaluation(Config *cfg)
     disable_line_buffering();
     char *expressionBuffer = NULL;
     size_t expressionBufferLen = 0, expressionBufferCapacity = 0,
-           inputBufferLen = 0, commandBufferLen = 0;
-    char inputBuffer[MAX_INPUT + 1] = {'\0'},
-                                 commandBuffer[MAX_CMD_INPUT] = {'\0'};
+           commandBufferLen = 0;
+    InputBuffer input;
+    input_buffer_init(&input);
+    KeyReader reader;
+    key_reader_init(&reader, termiosInitialized);
+    cfg->screen.terminal = isatty(STDIN_FILENO);
+    char commandBuffer[MAX_CMD_INPUT] = {'\0'};
     bool justDisplayedResult = false, command = false;
+    Stats stats; // Typed input is waited for, so its reads are not timed
+    stats_init(&stats);
+    stats_attach(cfg->stats ? &stats : NULL);
     int ch;
     while (1)
     {
-        ch = getchar();
+        // Scratch memory only lives while one key is handled
+        arena_reset(&cfg->scratch);
+        ch = key_reader_next(&reader, &cfg->screen);
         if (ch == EOF || ch == END_OF_TRANSMISSION)
         { // Handle end of input
           // (EOF or EOT)
+            screen_flush(&cfg->screen);
             enable_line_buffering();
             printf("Thank you for using uqbasejump!\n");
             free(expressionBuffer);
+            input_buffer_free(&input);
+            key_reader_free(&reader);
             free_history(cfg);
+            stats_count_arena(&stats, &cfg->scratch.stats);
+            stats_attach(NULL);
+            report_run_stats(cfg, &stats);
+            arena_free(&cfg->scratch);
+            bigint_free(&cfg->preview.big);
+            output_free(&cfg->screen.shown);
+            output_free(&cfg->screen.next);
             return;
         }
+        if (ch == PASTE_BLOCK)
+        { // Evaluate a pasted block of lines in one go
+            justDisplayedResult = paste_evaluate(cfg, reader.paste, reader.pasteLen,
+                                                 &expressionBuffer,
+                                                 &expressionBufferLen, &input);
+            continue;
+        }
         if (justDisplayedResult)
         { // Handle state after displaying a result
             handle_just_displayed_result(&cfg, ch, &justDisplayedResult,
-                                         &expressionBuffer, inputBuffer);
+                                         &expressionBuffer, input.text);
             if (justDisplayedResult)
             {
                 continue;
@@ -967,7 +5419,7 @@ void stdrd_input_expr_evaluation(Config *cfg)
         { // Process input based on current mode and character type
             handle_command_mode(cfg, ch, &command, commandBuffer,
                                 &commandBufferLen, &expressionBuffer, &expressionBufferLen,
-                                inputBuffer, &inputBufferLen);
+                                input.text, &input.len);
             continue;
         }
         if (ch == ':')
@@ -977,24 +5429,23 @@ void stdrd_input_expr_evaluation(Config *cfg)
         else if (ch == ESC || ch == BACK_SPACE)
         {
             handle_special_keys(cfg, ch, &expressionBuffer,
-                                &expressionBufferLen, inputBuffer, &inputBufferLen);
+                                &expressionBufferLen, input.text, &input.len);
         }
         else if (ch == ENTER)
         {
             handle_enter_key(cfg, &expressionBuffer, &expressionBufferLen,
-                             &expressionBufferCapacity, inputBuffer, &inputBufferLen,
+                             &expressionBufferCapacity, input.text, &input.len,
                              &justDisplayedResult);
         }
         else if (ch == '+' || ch == '-' || ch == '*' || ch == '/')
         {
             handle_operator_input(cfg, ch, &expressionBuffer,
                                   &expressionBufferLen, &expressionBufferCapacity,
-                                  inputBuffer, &inputBufferLen);
+                                  input.text, &input.len);
         }
         else
         {
-            handle_character_input(
-                cfg, ch, inputBuffer, &inputBufferLen, &expressionBuffer);
+            handle_character_input(cfg, ch, &input, &expressionBuffer);
         }
     }
 }
@@ -1005,8 +5456,7 @@ void stdrd_input_expr_evaluation(Config *cfg)
  *
  * cfg: Pointer to Config structure containing current settings
  * ch: The character input to process
- * inputBuffer: Buffer to store input characters
- * inputBufferLen: Pointer to current input buffer length
+ * inputBuffer: Pointer to InputBuffer storing the input characters
  * expressionBuffer: Pointer to the expression buffer pointer
  *
  * Global variables modified: None
@@ -1014,20 +5464,19 @@ void stdrd_input_expr_evaluation(Config *cfg)
  * REF: assistance from GitHub Copilot to modularize the main input processing
  * loop.
  */
-void handle_character_input(Config *cfg, int ch, char *inputBuffer,
-                            size_t *inputBufferLen, char **expressionBuffer)
+void handle_character_input(Config *cfg, int ch, InputBuffer *inputBuffer,
+                            char **expressionBuffer)
 {
     char validCharacter = 0;
     if (is_in_base_range(ch, cfg->inputBase, &validCharacter))
     {
-        if (*inputBufferLen < MAX_INPUT)
+        if (input_buffer_push(inputBuffer, validCharacter))
         {
-            inputBuffer[(*inputBufferLen)++] = validCharacter;
-            inputBuffer[*inputBufferLen] = '\0';
+            preview_push(cfg, validCharacter);
         }
     }
     // Always update the display regardless of whether character was valid/added
-    stdrd_input_expr_display(cfg, *expressionBuffer, inputBuffer);
+    stdrd_input_expr_display(cfg, *expressionBuffer, inputBuffer->text);
 }
 
 /* handle_input_base_command()
@@ -1060,6 +5509,7 @@ void handle_input_base_command(Config *cfg, char *commandBuffer,
             *inputBufferLen = 0;
             *expressionBufferLen = 0;
             inputBuffer[0] = '\0';
+            preview_clear(cfg);
             if (*expressionBuffer)
             {
                 (*expressionBuffer)[0] = '\0';
@@ -1102,6 +5552,7 @@ void handle_output_base_command(Config *cfg, char *commandBuffer,
         *inputBufferLen = 0;
         *expressionBufferLen = 0;
         inputBuffer[0] = '\0';
+        preview_clear(cfg);
         if (*expressionBuffer)
         {
             (*expressionBuffer)[0] = '\0';
@@ -1112,7 +5563,9 @@ void handle_output_base_command(Config *cfg, char *commandBuffer,
 
 /* handle_history_command()
  * ------------------------
- * Processes the :h command to display calculation history.
+ * Processes the :h command to display calculation history: the last
+ * --history-size calculations, oldest first, with the result digits that
+ * were stored when each was added.
  *
  * cfg: Pointer to Config structure containing history
  *
@@ -1123,17 +5576,20 @@ void handle_output_base_command(Config *cfg, char *commandBuffer,
  */
 void handle_history_command(Config *cfg)
 {
-    clear_screen();
-    for (size_t i = 0; i < cfg->historyCount; i++)
+    OutputBuffer *out = &cfg->screen.next;
+    screen_begin(&cfg->screen, true);
+    const HistoryRing *ring = &cfg->history.ring;
+    for (size_t i = 0; i < ring->count; i++)
     {
-        printf("Expression (base %d): %s\n", cfg->history[i].base,
-               cfg->history[i].expression);
-        char *resultOfExpression = convert_int_to_str_any_base(
-            cfg->history[i].result, cfg->history[i].base);
-        printf("Result (base %d): %s\n", cfg->history[i].base,
-               resultOfExpression ? resultOfExpression : "0");
-        free(resultOfExpression);
+        const HistoryEntry *entry = history_ring_entry(ring, i);
+        output_result_line(out, "Expression (base ", "): ", entry->base, NULL);
+        output_expression_line(out, stdout, "", entry->expression,
+                               entry->expressionLen, "\n");
+        output_result_line(out, "Result (base ", "): ", entry->base, NULL);
+        output_expression_line(out, stdout, "", entry->result,
+                               entry->resultLen, "\n");
     }
+    screen_show(&cfg->screen);
 }
 
 /* handle_command_mode()
@@ -1219,17 +5675,12 @@ void handle_enter_key(Config *cfg, char **expressionBuffer,
 {
     if (*inputBufferLen > 0)
     {
-        char *convertInputIntoBaseTen = convert_any_base_to_base_ten(inputBuffer, cfg->inputBase);
-        char *convertBackToInputBase = convert_expression(
-            convertInputIntoBaseTen, DECIMAL, cfg->inputBase);
-
-        if (convertBackToInputBase)
+        char *normalizedInput = normalize_input_literal(cfg, inputBuffer);
+        if (normalizedInput)
         {
-            size_t tmpLen = strlen(convertBackToInputBase);
+            size_t tmpLen = strlen(normalizedInput);
             append_string(expressionBuffer, expressionBufferLen,
-                          expressionBufferCapacity, convertBackToInputBase, tmpLen);
-            free(convertInputIntoBaseTen);
-            free(convertBackToInputBase);
+                          expressionBufferCapacity, normalizedInput, tmpLen);
         }
     }
 
@@ -1241,6 +5692,7 @@ void handle_enter_key(Config *cfg, char **expressionBuffer,
 
     *inputBufferLen = 0;
     inputBuffer[0] = '\0';
+    preview_clear(cfg);
     *justDisplayedResult = true;
 
     if (*expressionBufferLen > 0)
@@ -1282,6 +5734,7 @@ void handle_special_keys(Config *cfg, int ch, char **expressionBuffer,
         *expressionBufferLen = 0;
         inputBuffer[0] = '\0';
         *inputBufferLen = 0;
+        preview_clear(cfg);
         stdrd_input_expr_display(cfg, *expressionBuffer, inputBuffer);
     }
     else if (ch == BACK_SPACE)
@@ -1289,6 +5742,7 @@ void handle_special_keys(Config *cfg, int ch, char **expressionBuffer,
         if (*inputBufferLen > 0)
         {
             inputBuffer[--(*inputBufferLen)] = '\0';
+            preview_pop(cfg, inputBuffer, *inputBufferLen);
         }
         stdrd_input_expr_display(cfg, *expressionBuffer, inputBuffer);
     }
@@ -1359,6 +5813,7 @@ void handle_operator_input(Config *cfg, int ch, char **expressionBuffer,
                      expressionBufferCapacity, inputBuffer, *inputBufferLen);
     *inputBufferLen = 0;
     inputBuffer[0] = '\0';
+    preview_clear(cfg);
     append_char(expressionBuffer, expressionBufferLen, expressionBufferCapacity,
                 (char)ch);
     stdrd_input_expr_display(cfg, *expressionBuffer, inputBuffer);
@@ -1389,41 +5844,57 @@ int main(int argc, char **argv)
 {
     Config cfg;
     parse_arguments(argc, argv, &cfg);
-    bool fileHasContent = false;
+
+    // Server mode prints nothing but replies to its clients
+    if (cfg.haveServe)
+    {
+        return run_server(&cfg);
+    }
 
     // Handle file-based input mode
     if (cfg.haveFile)
     {
-        FILE *inputFile = NULL;
-        file_checking(cfg.fileName, &inputFile);
-        program_startup(&cfg);
-        char *line = NULL;
-        size_t size = 0;
-        ssize_t n;
-
-        // Process each line from the input file
-        while ((n = getline(&line, &size, inputFile)) != -1)
+        FILE *inputFile = stdin;
+        if (cfg.fileName)
+        {
+            file_checking(cfg.fileName, &inputFile);
+        }
+        // Record formats carry nothing but the records
+        bool records = cfg.format != FORMAT_TEXT;
+        if (!records)
         {
-            fileHasContent = true;
-            remove_trailings(line);
-            file_expr_evaluation_display(
-                line, cfg.inputBase, cfg.oBasesCount, cfg.oBases);
+            program_startup(&cfg);
         }
 
+        FileInput in;
+        file_input_open(&in, inputFile);
+        bool fileHasContent = cfg.jobs > 1 ? process_file_parallel(&cfg, &in)
+                                           : process_file_serial(&cfg, &in);
+        file_input_close(&in);
+
         // Handle empty file case
-        if (!fileHasContent)
+        if (!fileHasContent && !records)
         {
             fprintf(stderr, "Cannot evaluate the expression \"\"\n");
         }
 
-        free(line);
-        fclose(inputFile);
-        printf("Thank you for using uqbasejump!\n");
+        if (inputFile != stdin)
+        {
+            fclose(inputFile);
+        }
+        if (!records)
+        {
+            printf("Thank you for using uqbasejump!\n");
+        }
     }
 
     // Handle interactive input mode
     else
     {
+        if (cfg.history.logPath)
+        {
+            history_log_open(&cfg.history);
+        }
         program_startup(&cfg);
         stdrd_input_expr_evaluation(&cfg);
     }
@@ -6,65 +6,12 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
-#include <unistd.h>
-#include <termios.h>
 #include <math.h>
-
-/* Static variable to store original terminal settings */
-static struct termios originalTermios;
-static bool termiosInitialized = false;
-
-/*
- * enable_line_buffering()
- * -----------------------
- * Restores canonical mode and echo on the terminal.
- * Typically used to undo the effects of disable_line_buffering().
- */
-static inline void enable_line_buffering(void)
-{
-    if (termiosInitialized) {
-        tcsetattr(STDIN_FILENO, TCSANOW, &originalTermios);
-    }
-}
-
-/*
- * disable_line_buffering()
- * ------------------------
- * Disables canonical mode and echo on the terminal to allow
- * character-by-character input. Registers enable_line_buffering()
- * to be called at exit to restore settings.
- */
-static inline void disable_line_buffering(void)
-{
-    if (!isatty(STDIN_FILENO)) {
-        return;
-    }
-    
-    if (!termiosInitialized) {
-        tcgetattr(STDIN_FILENO, &originalTermios);
-        termiosInitialized = true;
-        atexit(enable_line_buffering);
-    }
-    
-    struct termios raw = originalTermios;
-    raw.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
-}
-
-/*
- * clear_screen()
- * --------------
- * Uses ANSI escape codes to clear the screen and reset the cursor position.
- * If standard input is not from a terminal, this function will do nothing.
- */
-static inline void clear_screen(void)
-{
-    if (!isatty(STDIN_FILENO)) {
-        return;
-    }
-    printf("\033[2J\033[H");
-    fflush(stdout);
-}
+#include "radix.h"
+#include "digits.h"
+#include "arena.h"
+#include "bigint.h"
+#include "stats.h"
 
 /*
  * char_to_digit()
@@ -74,16 +21,30 @@ static inline void clear_screen(void)
  */
 static inline int char_to_digit(char c)
 {
-    if (c >= '0' && c <= '9') {
-        return c - '0';
-    } else if (c >= 'a' && c <= 'z') {
-        return c - 'a' + 10;
-    } else if (c >= 'A' && c <= 'Z') {
-        return c - 'A' + 10;
-    }
-    return -1;
+    return digit_value(c);
 }
 
+/* Digit characters indexed by digit value (uppercase for 10-35) */
+static const char DIGIT_CHARS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/* Two hex digits for every byte value, used to emit base 16 a byte at a time */
+static const char HEX_DIGIT_PAIRS[513] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+/* Two decimal digits for every value 0-99, used to emit base 10 two at a time */
+static const char DECIMAL_DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
 /*
  * digit_to_char()
  * ---------------
@@ -92,54 +53,165 @@ static inline int char_to_digit(char c)
  */
 static inline char digit_to_char(int digit)
 {
-    if (digit >= 0 && digit <= 9) {
-        return '0' + digit;
-    } else if (digit >= 10 && digit <= 35) {
-        return 'A' + (digit - 10);
+    if (digit >= 0 && digit <= 35) {
+        return DIGIT_CHARS[digit];
     }
     return '?';
 }
 
 /*
- * convert_any_base_to_base_ten()
- * ------------------------------
- * Converts a string representing a number in a given base to base-10.
- *
- * input: A string representing the number (not NULL)
- * base: The base of the input number (2-36)
+ * format_pow2_digits()
+ * --------------------
+ * Writes the digits of a non-zero value in base 2^shift so that they end
+ * just before end, using shifts and masks instead of division. Binary is
+ * emitted eight digits per input byte and hex two digits per byte.
  *
- * Returns: A dynamically allocated string containing the base-10 representation.
- *          It is the caller's responsibility to free this buffer.
- *          Returns NULL on error.
+ * Returns: Pointer to the first digit written.
  */
-static inline char* convert_any_base_to_base_ten(const char* input, int base)
+static inline char* format_pow2_digits(unsigned long long value, int shift, char* end)
 {
-    if (!input || base < 2 || base > 36) {
-        return NULL;
+    int bits = 64 - __builtin_clzll(value);
+    int digits = (bits + shift - 1) / shift;
+    char* start = end - digits;
+    char* p = end;
+    
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (shift == 1) {
+        // Spread each byte's bits into eight '0'/'1' characters at once
+        while (p - start >= 8) {
+            unsigned long long spread =
+                (((value & 0xFF) * 0x8040201008040201ULL) >> 7) & 0x0101010101010101ULL;
+            spread += 0x3030303030303030ULL;  // '0' in every byte
+            p -= 8;
+            memcpy(p, &spread, 8);
+            value >>= 8;
+        }
+    }
+#endif
+    if (shift == 4) {
+        while (p - start >= 2) {
+            p -= 2;
+            memcpy(p, &HEX_DIGIT_PAIRS[(value & 0xFF) * 2], 2);
+            value >>= 8;
+        }
     }
     
-    unsigned long long value = 0;
-    const char* p = input;
+    unsigned long long mask = (1ULL << shift) - 1;
+    while (p > start) {
+        *--p = DIGIT_CHARS[value & mask];
+        value >>= shift;
+    }
+    return start;
+}
+
+/*
+ * format_u32_digits()
+ * -------------------
+ * Writes the digits of a 32-bit chunk in the given base so that they end
+ * just before end. Only 32-bit divisions are used, and base 10 is emitted
+ * two digits per division. If width is non-zero the chunk is zero padded
+ * to exactly width digits, otherwise it is written without leading zeros.
+ *
+ * Returns: Pointer to the first digit written.
+ */
+static inline char* format_u32_digits(uint32_t chunk, int base, char* end, int width)
+{
+    char* p = end;
     
-    while (*p) {
-        int digit = char_to_digit(*p);
-        if (digit < 0 || digit >= base) {
-            return NULL;
+    if (base == 10) {
+        while (chunk >= 100) {
+            p -= 2;
+            memcpy(p, &DECIMAL_DIGIT_PAIRS[(chunk % 100) * 2], 2);
+            chunk /= 100;
         }
-        value = value * base + digit;
-        p++;
+        if (chunk >= 10) {
+            p -= 2;
+            memcpy(p, &DECIMAL_DIGIT_PAIRS[chunk * 2], 2);
+        } else if (chunk > 0 || p == end) {
+            *--p = DIGIT_CHARS[chunk];
+        }
+    } else {
+        uint32_t b = (uint32_t)base;
+        do {
+            *--p = DIGIT_CHARS[chunk % b];
+            chunk /= b;
+        } while (chunk > 0);
     }
     
-    // Allocate buffer for result (max 20 digits for unsigned long long + null)
-    char* result = (char*)malloc(21);
-    if (!result) {
-        return NULL;
+    while (end - p < width) {
+        *--p = '0';
     }
+    return p;
+}
+
+/*
+ * format_chunked_digits()
+ * -----------------------
+ * Writes the digits of value in any base so that they end just before end.
+ * The value is split into chunks of RADIX_CHUNKS[base].digits32 digits with
+ * one 64-bit division each, and every chunk is then formatted with 32-bit
+ * arithmetic. At most 64 characters are written.
+ *
+ * Returns: Pointer to the first digit written.
+ */
+static inline char* format_chunked_digits(unsigned long long value, int base, char* end)
+{
+    const RadixChunk* chunk = &RADIX_CHUNKS[base];
+    char* p = end;
     
-    sprintf(result, "%llu", value);
-    return result;
+    while (value > UINT32_MAX) {
+        uint32_t low = (uint32_t)(value % chunk->power32);
+        value /= chunk->power32;
+        p = format_u32_digits(low, base, p, chunk->digits32);
+    }
+    return format_u32_digits((uint32_t)value, base, p, 0);
 }
 
+/*
+ * DigitFormatter
+ * --------------
+ * Writes the digits of value so that they end just before end, in the one
+ * base the function was built for, and returns the first digit written.
+ */
+typedef char* (*DigitFormatter)(unsigned long long value, char* end);
+
+/*
+ * RADIX_FORMATTER()
+ * -----------------
+ * Defines format_digits_base<base>(), whose base is a compile-time
+ * constant. Flattening inlines the whole chunked path around it, so every
+ * division by the base or by RADIX_CHUNKS[base].power32 becomes a multiply
+ * and shift, and power-of-two bases keep only their own shift.
+ */
+#define RADIX_FORMATTER(base) \
+    static inline __attribute__((flatten)) char* format_digits_base##base( \
+            unsigned long long value, char* end) \
+    { \
+        if (value == 0) { \
+            *--end = '0'; \
+            return end; \
+        } \
+        if (radix_pow2_shift(base)) { \
+            return format_pow2_digits(value, radix_pow2_shift(base), end); \
+        } \
+        return format_chunked_digits(value, base, end); \
+    }
+
+/* Expands X once for every supported base */
+#define RADIX_EACH_BASE(X) \
+    X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) \
+    X(14) X(15) X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) \
+    X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32) X(33) X(34) X(35) X(36)
+
+RADIX_EACH_BASE(RADIX_FORMATTER)
+
+#define RADIX_FORMATTER_ENTRY(base) format_digits_base##base,
+
+/* Formatter of every base (2-36); entries 0 and 1 are unused */
+static const DigitFormatter DIGIT_FORMATTERS[37] = {
+    NULL, NULL, RADIX_EACH_BASE(RADIX_FORMATTER_ENTRY)
+};
+
 /*
  * convert_str_to_int_any_base()
  * -----------------------------
@@ -157,397 +229,2322 @@ static inline unsigned long long convert_str_to_int_any_base(const char* input,
         return 0;
     }
     
-    unsigned long long value = 0;
-    const char* p = input;
-    
-    while (*p) {
-        int digit = char_to_digit(*p);
-        if (digit < 0 || digit >= base) {
-            return 0;
-        }
-        value = value * base + digit;
-        p++;
+    size_t len = strlen(input);
+    unsigned long long value;
+    if (digit_run_parse(input, len, base, &value) != len) {
+        return 0;
     }
-    
     return value;
 }
 
 /*
- * convert_int_to_str_any_base()
- * -----------------------------
- * Converts a numeric value to a string representation in the specified base.
+ * format_digits()
+ * ---------------
+ * Writes the digits of value in any base (2-36) so that they end just
+ * before end, through the DIGIT_FORMATTERS entry built for that base: the
+ * shift-and-mask path for power-of-two bases and the chunked path, with
+ * constant divisors, otherwise. At most 64 characters are written and no
+ * memory is allocated.
  *
- * value: The number to convert
- * outputBase: The base to convert to (2-36)
+ * Returns: Pointer to the first digit written.
+ */
+static inline char* format_digits(unsigned long long value, int base, char* end)
+{
+    return DIGIT_FORMATTERS[base](value, end);
+}
+
+/* Upper bound on the digits of a 64-bit value in any base (base 2) */
+#define FORMAT_DIGITS_BYTES 64
+
+/* Every base that is a perfect power has a root below this */
+#define RADIX_ROOT_LIMIT 7
+
+/*
+ * Root and exponent of the bases that share digits in format_all_bases(),
+ * packed as root * 4 + exponent: 3, 9 and 27 are powers of 3, 5 and 25 of
+ * 5, and 6 and 36 of 6. Zero for every other base; the powers of two are
+ * handled by radix_pow2_shift().
+ */
+#define RADIX_ROOT(root, exponent) ((root) * 4 + (exponent))
+static const unsigned char RADIX_ROOTS[37] = {
+    0, 0, 0, RADIX_ROOT(3, 1), 0, RADIX_ROOT(5, 1), RADIX_ROOT(6, 1), 0, 0,
+    RADIX_ROOT(3, 2), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    RADIX_ROOT(5, 2), 0, RADIX_ROOT(3, 3), 0, 0, 0, 0, 0, 0, 0, 0,
+    RADIX_ROOT(6, 2),
+};
+
+/*
+ * format_regrouped_digits()
+ * -------------------------
+ * Writes the digits of a value in base root^k (k = 1, 2 or 3) so that they
+ * end just before end, given its digits in root: every k root digits from
+ * the right make one digit, so no division of the value is needed.
  *
- * Returns: A dynamically allocated string containing the number in the specified base.
- *          It is the caller's responsibility to free this buffer.
+ * Returns: Pointer to the first digit written.
  */
-static inline char* convert_int_to_str_any_base(unsigned long long value, int outputBase)
+static inline char* format_regrouped_digits(const char* digits, size_t len, int root,
+        int k, char* end)
 {
-    if (outputBase < 2 || outputBase > 36) {
-        return NULL;
+    char* p = end;
+    const char* q = digits + len;
+    // Roots are below 10, so every root digit is a decimal character
+    if (k == 1) {
+        p -= len;
+        memcpy(p, digits, len);
+        return p;
+    } else if (k == 2) {
+        for (; q - digits >= 2; q -= 2) {
+            *--p = DIGIT_CHARS[(q[-2] - '0') * root + (q[-1] - '0')];
+        }
+    } else {
+        for (; q - digits >= 3; q -= 3) {
+            *--p = DIGIT_CHARS[((q[-3] - '0') * root + (q[-2] - '0')) * root + (q[-1] - '0')];
+        }
     }
     
-    // Handle zero case
-    if (value == 0) {
-        char* result = (char*)malloc(2);
-        if (result) {
-            result[0] = '0';
-            result[1] = '\0';
+    // The leading group may be short
+    if (q > digits) {
+        int digit = 0;
+        for (const char* r = digits; r < q; r++) {
+            digit = digit * root + (*r - '0');
         }
-        return result;
+        *--p = DIGIT_CHARS[digit];
     }
-    
-    // Buffer for digits (64 bits = max 64 binary digits + null)
-    char buffer[65];
-    int index = 64;
-    buffer[index] = '\0';
-    
-    while (value > 0) {
-        index--;
-        buffer[index] = digit_to_char(value % outputBase);
-        value /= outputBase;
+    return p;
+}
+
+/*
+ * split_root_digits()
+ * -------------------
+ * Writes the k digits in root of every digit of base root^k, zero padded,
+ * starting at p. Inlined with a constant root and k, the divisions become
+ * multiplications.
+ */
+static inline void split_root_digits(const char* digits, size_t len, int root, int k,
+        char* p)
+{
+    for (size_t i = 0; i < len; i++) {
+        int digit = char_to_digit(digits[i]);
+        p += k;
+        for (int j = 1; j <= k; j++) {
+            p[-j] = (char)('0' + digit % root);
+            digit /= root;
+        }
     }
-    
-    char* result = strdup(&buffer[index]);
-    return result;
 }
 
 /*
- * is_operator()
- * -------------
- * Helper function to check if a character is an operator.
+ * format_split_digits()
+ * ---------------------
+ * Writes the digits in root of a value given its digits in base root^k
+ * (27, 9, 25 or 36), so that they end just before end: every digit of the
+ * power becomes k digits of the root. This is the inverse of
+ * format_regrouped_digits() and also needs no division of the value.
+ *
+ * Returns: Pointer to the first digit written.
  */
-static inline bool is_operator(char c)
+static inline char* format_split_digits(const char* digits, size_t len, int root,
+        int k, char* end)
 {
-    return c == '+' || c == '-' || c == '*' || c == '/' || 
-           c == '%' || c == '(' || c == ')' || c == '^';
+    char* p = end - len * (size_t)k;
+    switch (RADIX_ROOT(root, k)) {
+    case RADIX_ROOT(3, 3):
+        split_root_digits(digits, len, 3, 3, p);
+        break;
+    case RADIX_ROOT(3, 2):
+        split_root_digits(digits, len, 3, 2, p);
+        break;
+    case RADIX_ROOT(5, 2):
+        split_root_digits(digits, len, 5, 2, p);
+        break;
+    default:
+        split_root_digits(digits, len, 6, 2, p);
+        break;
+    }
+    
+    // Only the leading group can carry leading zeros
+    while (p < end - 1 && *p == '0') {
+        p++;
+    }
+    return p;
 }
 
 /*
- * convert_expression()
- * --------------------
- * Converts all numbers in a mathematical expression from one base to another.
+ * RootDigits
+ * ----------
+ * The digits of a value in the largest power of a root that was asked for
+ * and, when needed, in the root itself (see format_all_bases()).
+ */
+typedef struct {
+    int top;                           // Largest exponent asked for, or 0
+    size_t topLen;                     // Digits in root^top, once written
+    char topDigits[FORMAT_DIGITS_BYTES];
+    size_t rootLen;                    // Digits in the root, once written
+    char rootDigits[FORMAT_DIGITS_BYTES];
+} RootDigits;
+
+/*
+ * format_all_bases()
+ * ------------------
+ * Writes the digits of value in every base of bases, one after another in
+ * a single block, so that a whole "Base N: ..." display is rendered in one
+ * pass. Work is shared between the bases: the power-of-two bases use one
+ * bit length and shifts alone, and when two or more of 3, 9 and 27 (or 5
+ * and 25, or 6 and 36) are requested the value is divided down only once,
+ * in the largest of them, which has the fewest digits. The root's digits
+ * are split out of those, and the other powers regrouped from the root.
+ * Every other base is written in 32-bit chunks by its DIGIT_FORMATTERS
+ * entry, whose divisions are by constants.
  *
- * expression: The mathematical expression string to convert
- * inputBase: The base of numbers in the expression (2-36)
- * outputBase: The base to convert numbers to (2-36)
+ * value: The number to write
+ * bases: The bases to write it in (each 2-36)
+ * count: Number of bases
+ * out: Buffer of at least count * FORMAT_DIGITS_BYTES bytes
+ * ends: Receives, for each base, the offset in out just past its digits
  *
- * Returns: A dynamically allocated string with converted numbers or NULL if error.
- *          It is the caller's responsibility to free this buffer.
+ * Returns: The total number of bytes written to out (no terminator).
  */
-static inline char* convert_expression(const char* expression, int inputBase, int outputBase)
+static inline size_t format_all_bases(unsigned long long value, const int* bases,
+        size_t count, char* out, size_t* ends)
 {
-    if (!expression || inputBase < 2 || inputBase > 36 || 
-        outputBase < 2 || outputBase > 36) {
-        return NULL;
+    size_t used = 0;
+    if (value == 0) {
+        for (size_t i = 0; i < count; i++) {
+            out[used++] = '0';
+            ends[i] = used;
+        }
+        return used;
     }
     
-    size_t len = strlen(expression);
-    // Allocate generous buffer (conversion can expand size)
-    size_t resultCapacity = len * 4 + 1;
-    char* result = (char*)malloc(resultCapacity);
-    if (!result) {
-        return NULL;
+    // A root is only worth sharing when two bases are powers of it
+    unsigned char rootUses[RADIX_ROOT_LIMIT] = {0};
+    RootDigits roots[RADIX_ROOT_LIMIT];
+    for (int r = 0; r < RADIX_ROOT_LIMIT; r++) {
+        roots[r].top = 0;
+        roots[r].topLen = 0;
+        roots[r].rootLen = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        int root = RADIX_ROOTS[bases[i]] / 4;
+        int k = RADIX_ROOTS[bases[i]] % 4;
+        rootUses[root]++;
+        if (k > roots[root].top) {
+            roots[root].top = k;
+        }
     }
     
-    size_t resultLen = 0;
-    size_t i = 0;
-    
-    while (i < len) {
-        char c = expression[i];
+    int bits = 64 - __builtin_clzll(value);
+    for (size_t i = 0; i < count; i++) {
+        int base = bases[i];
+        int shift = radix_pow2_shift(base);
+        int root = RADIX_ROOTS[base] / 4;
+        size_t len;
         
-        // Check if it's the start of a number
-        int digit = char_to_digit(c);
-        if (digit >= 0 && digit < inputBase) {
-            // Extract the full number
-            size_t numStart = i;
-            while (i < len) {
-                digit = char_to_digit(expression[i]);
-                if (digit < 0 || digit >= inputBase) {
-                    break;
-                }
-                i++;
-            }
-            
-            // Convert the number
-            size_t numLen = i - numStart;
-            char* numStr = (char*)malloc(numLen + 1);
-            if (!numStr) {
-                free(result);
-                return NULL;
-            }
-            strncpy(numStr, expression + numStart, numLen);
-            numStr[numLen] = '\0';
-            
-            // Convert to base 10 first
-            char* baseTen = convert_any_base_to_base_ten(numStr, inputBase);
-            free(numStr);
-            
-            if (!baseTen) {
-                free(result);
-                return NULL;
+        if (shift) {
+            len = (size_t)((bits + shift - 1) / shift);
+            format_pow2_digits(value, shift, out + used + len);
+        } else if (root && rootUses[root] > 1) {
+            RootDigits* r = &roots[root];
+            int k = RADIX_ROOTS[base] % 4;
+            int topBase = r->top == 3 ? root * root * root : r->top == 2 ? root * root : root;
+            if (r->topLen == 0) {
+                char* end = r->topDigits + FORMAT_DIGITS_BYTES;
+                char* start = DIGIT_FORMATTERS[topBase](value, end);
+                r->topLen = (size_t)(end - start);
+                memmove(r->topDigits, start, r->topLen);
             }
-            
-            // Convert from base 10 to output base
-            unsigned long long value = strtoull(baseTen, NULL, 10);
-            free(baseTen);
-            
-            char* converted = convert_int_to_str_any_base(value, outputBase);
-            if (!converted) {
-                free(result);
-                return NULL;
-            }
-            
-            // Append converted number to result
-            size_t convertedLen = strlen(converted);
-            if (resultLen + convertedLen + 1 > resultCapacity) {
-                resultCapacity = (resultLen + convertedLen + 1) * 2;
-                char* newResult = (char*)realloc(result, resultCapacity);
-                if (!newResult) {
-                    free(converted);
-                    free(result);
-                    return NULL;
-                }
-                result = newResult;
-            }
-            
-            strcpy(result + resultLen, converted);
-            resultLen += convertedLen;
-            free(converted);
-        }
-        else if (is_operator(c) || isspace(c)) {
-            // Copy operator or whitespace directly
-            if (resultLen + 2 > resultCapacity) {
-                resultCapacity *= 2;
-                char* newResult = (char*)realloc(result, resultCapacity);
-                if (!newResult) {
-                    free(result);
-                    return NULL;
+            if (k == r->top) {
+                len = r->topLen;
+                memcpy(out + used, r->topDigits, len);
+            } else {
+                if (r->rootLen == 0) {
+                    char* end = r->rootDigits + FORMAT_DIGITS_BYTES;
+                    char* start = format_split_digits(r->topDigits, r->topLen, root,
+                            r->top, end);
+                    r->rootLen = (size_t)(end - start);
+                    memmove(r->rootDigits, start, r->rootLen);
                 }
-                result = newResult;
+                len = (r->rootLen + (size_t)k - 1) / (size_t)k;
+                format_regrouped_digits(r->rootDigits, r->rootLen, root, k,
+                        out + used + len);
             }
-            result[resultLen++] = c;
-            i++;
-        }
-        else {
-            // Invalid character for the given base
-            free(result);
-            return NULL;
+        } else {
+            char digits[FORMAT_DIGITS_BYTES];
+            char* end = digits + sizeof(digits);
+            char* start = DIGIT_FORMATTERS[base](value, end);
+            len = (size_t)(end - start);
+            memcpy(out + used, start, len);
         }
+        used += len;
+        ends[i] = used;
     }
-    
-    result[resultLen] = '\0';
-    return result;
+    return used;
 }
 
 /*
- * evaluate_expression()
- * ---------------------
- * Evaluates a mathematical expression in base 10.
- *
- * expression: The mathematical expression string (must be in base 10)
- * result: Pointer to store the result
- *
- * Returns: 0 if successful, 1 if the expression could not be evaluated or is NULL,
- *          or if the result is less than zero or >= 2^53.
- *
- * Note: This is a simple recursive descent parser for basic expressions.
+ * Returned by the _into and _size conversions below when the input or the
+ * base is invalid, or when the caller's buffer is too small.
  */
+#define CONVERT_ERROR ((size_t)-1)
 
-/* Forward declarations for recursive descent parser */
-static inline int parse_expression(const char** expr, double* result);
-static inline int parse_term(const char** expr, double* result);
-static inline int parse_factor(const char** expr, double* result);
-static inline int parse_power(const char** expr, double* result);
-static inline int parse_number(const char** expr, double* result);
-
-static inline void skip_whitespace(const char** expr)
+/*
+ * convert_int_to_str_any_base_size()
+ * ----------------------------------
+ * Returns the exact number of digits of value in outputBase (2-36), not
+ * counting the terminator, without formatting it. Returns CONVERT_ERROR
+ * if the base is invalid.
+ */
+static inline size_t convert_int_to_str_any_base_size(unsigned long long value, int outputBase)
 {
-    while (**expr && isspace(**expr)) {
-        (*expr)++;
+    if (outputBase < 2 || outputBase > 36) {
+        return CONVERT_ERROR;
     }
-}
-
-static inline int parse_number(const char** expr, double* result)
-{
-    skip_whitespace(expr);
     
-    if (!**expr) {
-        return 1;
+    int shift = radix_pow2_shift(outputBase);
+    if (shift) {
+        int bits = value ? 64 - __builtin_clzll(value) : 1;
+        return (size_t)((bits + shift - 1) / shift);
     }
     
-    char* end;
-    *result = strtod(*expr, &end);
-    
-    if (end == *expr) {
-        return 1;
+    // Count the powers of the base that do not exceed value
+    unsigned long long base = (unsigned long long)outputBase;
+    unsigned long long limit = ~0ULL / base;
+    size_t digits = 1;
+    for (unsigned long long power = base; value >= power; power *= base) {
+        digits++;
+        if (power > limit) {
+            break;  // The next power would not fit in 64 bits
+        }
     }
-    
-    *expr = end;
-    return 0;
+    return digits;
 }
 
-static inline int parse_power(const char** expr, double* result)
+/*
+ * convert_int_to_str_any_base_into()
+ * ----------------------------------
+ * Writes a numeric value in the specified base into a caller-provided
+ * buffer, followed by a terminator. No memory is allocated.
+ *
+ * value: The number to convert
+ * outputBase: The base to convert to (2-36)
+ * buffer: Buffer to receive the digits
+ * capacity: Size of buffer; convert_int_to_str_any_base_size() + 1 suffices
+ *
+ * Returns: The number of digits written, not counting the terminator, or
+ *          CONVERT_ERROR if the base is invalid or buffer is too small
+ *          (in which case buffer holds an empty string if capacity > 0).
+ */
+static inline size_t convert_int_to_str_any_base_into(unsigned long long value, int outputBase,
+        char* buffer, size_t capacity)
 {
-    skip_whitespace(expr);
-    
-    // Handle parentheses
-    if (**expr == '(') {
-        (*expr)++;
-        if (parse_expression(expr, result) != 0) {
-            return 1;
-        }
-        skip_whitespace(expr);
-        if (**expr != ')') {
-            return 1;
-        }
-        (*expr)++;
-    } else {
-        if (parse_number(expr, result) != 0) {
-            return 1;
-        }
+    if (!buffer || capacity == 0) {
+        return CONVERT_ERROR;
+    }
+    buffer[0] = '\0';
+    if (outputBase < 2 || outputBase > 36) {
+        return CONVERT_ERROR;
     }
     
-    skip_whitespace(expr);
-    
-    // Handle exponentiation (right-associative)
-    if (**expr == '^') {
-        (*expr)++;
-        double exponent;
-        if (parse_power(expr, &exponent) != 0) {
-            return 1;
-        }
-        *result = pow(*result, exponent);
+    // Buffer for digits (64 bits = max 64 binary digits)
+    char digits[64];
+    char* start = format_digits(value, outputBase, digits + sizeof(digits));
+    size_t len = (size_t)(digits + sizeof(digits) - start);
+    if (len >= capacity) {
+        return CONVERT_ERROR;
     }
     
-    return 0;
+    memcpy(buffer, start, len);
+    buffer[len] = '\0';
+    return len;
 }
 
-static inline int parse_factor(const char** expr, double* result)
+/*
+ * convert_int_to_str_any_base_arena()
+ * -----------------------------------
+ * Converts a numeric value to a string representation in the specified base.
+ *
+ * arena: Scratch arena for the result, or NULL to use the heap
+ * value: The number to convert
+ * outputBase: The base to convert to (2-36)
+ *
+ * Returns: A string containing the number in the specified base, which lives
+ *          in arena until its next reset, or was allocated with malloc() if
+ *          arena is NULL (in which case the caller must free it).
+ */
+static inline char* convert_int_to_str_any_base_arena(Arena* arena, unsigned long long value,
+        int outputBase)
 {
-    skip_whitespace(expr);
-    
-    // Handle unary minus
-    bool negative = false;
-    if (**expr == '-') {
-        negative = true;
-        (*expr)++;
-    } else if (**expr == '+') {
-        (*expr)++;
-    }
-    
-    if (parse_power(expr, result) != 0) {
-        return 1;
+    size_t len = convert_int_to_str_any_base_size(value, outputBase);
+    if (len == CONVERT_ERROR) {
+        return NULL;
     }
     
-    if (negative) {
-        *result = -(*result);
+    char* result = (char*)arena_alloc(arena, len + 1);
+    if (result) {
+        convert_int_to_str_any_base_into(value, outputBase, result, len + 1);
     }
-    
-    return 0;
+    return result;
+}
+
+/*
+ * convert_int_to_str_any_base()
+ * -----------------------------
+ * Heap-backed convert_int_to_str_any_base_arena(): the string is allocated
+ * with malloc() and the caller must free it.
+ */
+static inline char* convert_int_to_str_any_base(unsigned long long value, int outputBase)
+{
+    return convert_int_to_str_any_base_arena(NULL, value, outputBase);
 }
 
-static inline int parse_term(const char** expr, double* result)
+/*
+ * convert_any_base_to_base_ten_size()
+ * -----------------------------------
+ * Returns the exact number of base-10 digits of a number written in the
+ * given base, not counting the terminator, or CONVERT_ERROR if input is
+ * not a number in that base.
+ */
+static inline size_t convert_any_base_to_base_ten_size(const char* input, int base)
 {
-    if (parse_factor(expr, result) != 0) {
-        return 1;
+    if (!input || base < 2 || base > 36) {
+        return CONVERT_ERROR;
+    }
+    
+    size_t len = strlen(input);
+    unsigned long long value;
+    if (digit_run_parse(input, len, base, &value) != len) {
+        return CONVERT_ERROR;
+    }
+    return convert_int_to_str_any_base_size(value, 10);
+}
+
+/*
+ * convert_any_base_to_base_ten_into()
+ * -----------------------------------
+ * Converts a string representing a number in a given base to base-10 in a
+ * caller-provided buffer, followed by a terminator. No memory is allocated.
+ *
+ * input: A string representing the number (not NULL)
+ * base: The base of the input number (2-36)
+ * buffer: Buffer to receive the digits
+ * capacity: Size of buffer; 21 bytes always suffice
+ *
+ * Returns: The number of digits written, not counting the terminator, or
+ *          CONVERT_ERROR on invalid input or if buffer is too small.
+ */
+static inline size_t convert_any_base_to_base_ten_into(const char* input, int base,
+        char* buffer, size_t capacity)
+{
+    if (!buffer || capacity == 0) {
+        return CONVERT_ERROR;
+    }
+    buffer[0] = '\0';
+    if (!input || base < 2 || base > 36) {
+        return CONVERT_ERROR;
+    }
+    
+    size_t len = strlen(input);
+    unsigned long long value;
+    if (digit_run_parse(input, len, base, &value) != len) {
+        return CONVERT_ERROR;
+    }
+    return convert_int_to_str_any_base_into(value, 10, buffer, capacity);
+}
+
+/*
+ * convert_any_base_to_base_ten_arena()
+ * ------------------------------------
+ * Converts a string representing a number in a given base to base-10.
+ *
+ * arena: Scratch arena for the result, or NULL to use the heap
+ * input: A string representing the number (not NULL)
+ * base: The base of the input number (2-36)
+ *
+ * Returns: A string containing the base-10 representation, which lives in
+ *          arena until its next reset, or was allocated with malloc() if
+ *          arena is NULL (in which case the caller must free it).
+ *          Returns NULL on error.
+ */
+static inline char* convert_any_base_to_base_ten_arena(Arena* arena, const char* input, int base)
+{
+    size_t len = convert_any_base_to_base_ten_size(input, base);
+    if (len == CONVERT_ERROR) {
+        return NULL;
+    }
+    
+    char* result = (char*)arena_alloc(arena, len + 1);
+    if (result) {
+        convert_any_base_to_base_ten_into(input, base, result, len + 1);
+    }
+    return result;
+}
+
+/*
+ * convert_any_base_to_base_ten()
+ * ------------------------------
+ * Heap-backed convert_any_base_to_base_ten_arena(): the string is allocated
+ * with malloc() and the caller must free it.
+ */
+static inline char* convert_any_base_to_base_ten(const char* input, int base)
+{
+    return convert_any_base_to_base_ten_arena(NULL, input, base);
+}
+
+/*
+ * is_operator()
+ * -------------
+ * Helper function to check if a character is an operator.
+ */
+static inline bool is_operator(char c)
+{
+    return c == '+' || c == '-' || c == '*' || c == '/' || 
+           c == '%' || c == '(' || c == ')' || c == '^';
+}
+
+/*
+ * TokenType
+ * ---------
+ * Kinds of token produced by tokenize_expression().
+ */
+typedef enum {
+    TOKEN_NUMBER,   // Integer literal (value holds its numeric value)
+    TOKEN_PLUS,     // '+'
+    TOKEN_MINUS,    // '-'
+    TOKEN_MULTIPLY, // '*'
+    TOKEN_DIVIDE,   // '/'
+    TOKEN_MODULO,   // '%'
+    TOKEN_POWER,    // '^'
+    TOKEN_LPAREN,   // '('
+    TOKEN_RPAREN,   // ')'
+    TOKEN_END       // End of expression sentinel
+} TokenType;
+
+/*
+ * Token
+ * -----
+ * A single lexical unit of an expression. Literals are parsed once, in the
+ * input base, so the evaluator never sees their text again.
+ */
+typedef struct {
+    TokenType type;           // Kind of token
+    unsigned long long value; // Value of a TOKEN_NUMBER (wraps at 64 bits)
+    const char* text;         // Start of the token in the source expression
+    size_t length;            // Number of source characters in the token
+} Token;
+
+/* Number of tokens evaluate_expression_in_base() keeps on the stack */
+#define TOKEN_STACK_CAPACITY 128
+
+/*
+ * operator_token_type()
+ * ---------------------
+ * Maps an operator character to its token type.
+ * Returns TOKEN_END if the character is not an operator.
+ */
+static inline TokenType operator_token_type(char c)
+{
+    switch (c) {
+        case '+': return TOKEN_PLUS;
+        case '-': return TOKEN_MINUS;
+        case '*': return TOKEN_MULTIPLY;
+        case '/': return TOKEN_DIVIDE;
+        case '%': return TOKEN_MODULO;
+        case '^': return TOKEN_POWER;
+        case '(': return TOKEN_LPAREN;
+        case ')': return TOKEN_RPAREN;
+        default: return TOKEN_END;
+    }
+}
+
+/*
+ * tokenize_expression()
+ * ---------------------
+ * Splits an expression into tokens in a single pass, parsing each number
+ * directly from the given input base. A TOKEN_END sentinel is always
+ * written after the last token.
+ *
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ * tokens: Array to receive the tokens
+ * capacity: Number of entries available in tokens (len + 1 always suffices)
+ * count: Receives the number of tokens written, excluding the sentinel
+ *
+ * Returns: 0 if successful, 1 if the expression contains a character that
+ *          is neither a digit of inputBase, an operator nor whitespace, or
+ *          if tokens is too small.
+ */
+static inline int tokenize_expression(const char* expression, size_t len,
+        int inputBase, Token* tokens, size_t capacity, size_t* count)
+{
+    if (!expression || !tokens || !count || capacity == 0 ||
+            inputBase < 2 || inputBase > 36) {
+        return 1;
+    }
+    
+    size_t n = 0;
+    size_t i = 0;
+    
+    while (i < len) {
+        char c = expression[i];
+        
+        if (isspace(c)) {
+            i++;
+            continue;
+        }
+        
+        // Reserve room for this token and the sentinel
+        if (n + 1 >= capacity) {
+            return 1;
+        }
+        Token* token = &tokens[n];
+        token->text = expression + i;
+        
+        int digit = char_to_digit(c);
+        if (digit >= 0 && digit < inputBase) {
+            // Accumulate the full number in the input base
+            size_t digits = digit_run_parse(expression + i, len - i, inputBase, &token->value);
+            token->type = TOKEN_NUMBER;
+            token->length = digits;
+            i += digits;
+        } else {
+            TokenType type = operator_token_type(c);
+            if (type == TOKEN_END) {
+                // Invalid character for the given base
+                return EVAL_FAIL(EVAL_FAILURE_CHARACTER);
+            }
+            token->type = type;
+            token->value = 0;
+            token->length = 1;
+            i++;
+        }
+        n++;
+    }
+    
+    tokens[n].type = TOKEN_END;
+    tokens[n].value = 0;
+    tokens[n].text = expression + len;
+    tokens[n].length = 0;
+    *count = n;
+    return 0;
+}
+
+/*
+ * expression_space()
+ * ------------------
+ * Returns true for the whitespace tokenize_expression() skips: the
+ * characters isspace() accepts in the C locale.
+ */
+static inline bool expression_space(char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+#if DIGITS_BLOCK
+/*
+ * expression_block_classify()
+ * ---------------------------
+ * Classifies DIGITS_BLOCK characters starting at s as tokenize_expression()
+ * would. A block of nothing but digits, the common case, is settled by
+ * digits_block_classify() alone.
+ *
+ * s: At least DIGITS_BLOCK readable characters
+ * base: The base of numbers in the expression (2-36)
+ * opens: Receives a mask of the '(' characters
+ * closes: Receives a mask of the ')' characters
+ *
+ * Returns: A mask of the characters that are neither a digit of base, an
+ *          operator nor whitespace. Every mask has DIGITS_MASK_BITS set
+ *          bits per character, in order.
+ */
+#if defined(DIGITS_AVX2)
+static inline uint64_t expression_block_classify(const char* s, int base,
+        uint64_t* opens, uint64_t* closes)
+{
+    DigitBlock values;
+    uint64_t invalid = digits_block_classify(s, base, &values);
+    *opens = 0;
+    *closes = 0;
+    if (!invalid) {
+        return 0;
+    }
+    
+    __m256i c = _mm256_loadu_si256((const __m256i*)s);
+    __m256i open = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('('));
+    __m256i close = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(')'));
+    __m256i control = _mm256_sub_epi8(c, _mm256_set1_epi8('\t'));
+    __m256i ok = _mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8('\r' - '\t')),
+                                   control);
+    ok = _mm256_or_si256(ok, _mm256_or_si256(open, close));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+')));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('*')));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/')));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('%')));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(c, _mm256_set1_epi8('^')));
+    *opens = (uint32_t)_mm256_movemask_epi8(open);
+    *closes = (uint32_t)_mm256_movemask_epi8(close);
+    return invalid & ~(uint64_t)(uint32_t)_mm256_movemask_epi8(ok);
+}
+#elif defined(DIGITS_SSE2)
+static inline uint64_t expression_block_classify(const char* s, int base,
+        uint64_t* opens, uint64_t* closes)
+{
+    DigitBlock values;
+    uint64_t invalid = digits_block_classify(s, base, &values);
+    *opens = 0;
+    *closes = 0;
+    if (!invalid) {
+        return 0;
+    }
+    
+    __m128i c = _mm_loadu_si128((const __m128i*)s);
+    __m128i open = _mm_cmpeq_epi8(c, _mm_set1_epi8('('));
+    __m128i close = _mm_cmpeq_epi8(c, _mm_set1_epi8(')'));
+    __m128i control = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+    __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8('\r' - '\t')), control);
+    ok = _mm_or_si128(ok, _mm_or_si128(open, close));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('+')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('*')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('/')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('%')));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, _mm_set1_epi8('^')));
+    *opens = (uint64_t)_mm_movemask_epi8(open);
+    *closes = (uint64_t)_mm_movemask_epi8(close);
+    return invalid & ~(uint64_t)_mm_movemask_epi8(ok);
+}
+#else
+/* Narrows a comparison to four bits per character to form a mask */
+static inline uint64_t expression_block_mask(uint8x16_t match)
+{
+    uint8x8_t mask = vshrn_n_u16(vreinterpretq_u16_u8(match), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(mask), 0);
+}
+
+static inline uint64_t expression_block_classify(const char* s, int base,
+        uint64_t* opens, uint64_t* closes)
+{
+    DigitBlock values;
+    uint64_t invalid = digits_block_classify(s, base, &values);
+    *opens = 0;
+    *closes = 0;
+    if (!invalid) {
+        return 0;
+    }
+    
+    uint8x16_t c = vld1q_u8((const uint8_t*)s);
+    uint8x16_t open = vceqq_u8(c, vdupq_n_u8('('));
+    uint8x16_t close = vceqq_u8(c, vdupq_n_u8(')'));
+    uint8x16_t ok = vcleq_u8(vsubq_u8(c, vdupq_n_u8('\t')), vdupq_n_u8('\r' - '\t'));
+    ok = vorrq_u8(ok, vorrq_u8(open, close));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8(' ')));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8('+')));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8('-')));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8('*')));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8('/')));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8('%')));
+    ok = vorrq_u8(ok, vceqq_u8(c, vdupq_n_u8('^')));
+    *opens = expression_block_mask(open);
+    *closes = expression_block_mask(close);
+    return invalid & ~expression_block_mask(ok);
+}
+#endif
+
+/*
+ * expression_block_parens()
+ * -------------------------
+ * Follows the parentheses of one block in order, for a block that closes
+ * more than is known to be open before it.
+ *
+ * opens: Mask of the block's '(' characters
+ * closes: Mask of the block's ')' characters
+ * depth: Pointer to the parentheses open before the block (updated)
+ *
+ * Returns: false if a ')' has no '(' to close
+ */
+static inline bool expression_block_parens(uint64_t opens, uint64_t closes, size_t* depth)
+{
+    bool paired = true;
+    uint64_t parens = opens | closes;
+    while (parens) {
+        int bit = __builtin_ctzll(parens);
+        if ((opens >> bit) & 1) {
+            (*depth)++;
+        } else if (*depth == 0) {
+            paired = false;
+        } else {
+            (*depth)--;
+        }
+        parens &= ~((((uint64_t)1 << DIGITS_MASK_BITS) - 1) << bit);
+    }
+    return paired;
+}
+#endif /* DIGITS_BLOCK */
+
+/*
+ * expression_precheck()
+ * ---------------------
+ * A cheap pass over an expression, a vector at a time where digits.h has
+ * vectors, that rejects most malformed lines before anything is allocated,
+ * tokenized or looked up: every character must be a digit of inputBase, an
+ * operator or whitespace, the parentheses must pair up, and there must be
+ * something besides whitespace. Whatever it rejects every evaluator would
+ * reject too; passing it proves nothing. A bad character is reported ahead
+ * of unbalanced parentheses wherever it is.
+ *
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ *
+ * Returns: 0 if the expression may be valid, 1 if it is not (the reason
+ *          is noted with EVAL_FAIL())
+ */
+static inline int expression_precheck(const char* expression, size_t len, int inputBase)
+{
+    size_t i = 0;
+    while (i < len && expression_space(expression[i])) {
+        i++;
+    }
+    if (i == len) {
+        return EVAL_FAIL(EVAL_FAILURE_EMPTY);
+    }
+    
+    size_t depth = 0;   // Parentheses open so far
+    bool paired = true; // Whether every ')' so far had a '(' to close
+#if DIGITS_BLOCK
+    while (len - i >= DIGITS_BLOCK) {
+        uint64_t opens, closes;
+        if (expression_block_classify(expression + i, inputBase, &opens, &closes)) {
+            return EVAL_FAIL(EVAL_FAILURE_CHARACTER);
+        }
+        if (closes) {
+            size_t closeCount = (size_t)__builtin_popcountll(closes) / DIGITS_MASK_BITS;
+            if (closeCount <= depth) {
+                // No prefix of the block can close more than is open
+                depth = depth - closeCount +
+                        (size_t)__builtin_popcountll(opens) / DIGITS_MASK_BITS;
+            } else {
+                paired = expression_block_parens(opens, closes, &depth) && paired;
+            }
+        } else if (opens) {
+            depth += (size_t)__builtin_popcountll(opens) / DIGITS_MASK_BITS;
+        }
+        i += DIGITS_BLOCK;
+    }
+#endif
+    for (; i < len; i++) {
+        char c = expression[i];
+        if ((unsigned)digit_value(c) < (unsigned)inputBase || expression_space(c)) {
+            continue;
+        }
+        if (!is_operator(c)) {
+            return EVAL_FAIL(EVAL_FAILURE_CHARACTER);
+        }
+        if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            if (depth == 0) {
+                paired = false;
+            } else {
+                depth--;
+            }
+        }
+    }
+    return paired && depth == 0 ? 0 : EVAL_FAIL(EVAL_FAILURE_PARENTHESES);
+}
+
+/*
+ * convert_expression_emit()
+ * -------------------------
+ * Shared walk behind convert_expression_size() and convert_expression_into().
+ * Every number is converted and every operator or whitespace character is
+ * copied; characters are only stored while they fit in capacity, and
+ * nothing is stored when buffer is NULL.
+ *
+ * Returns: The length of the converted expression, not counting the
+ *          terminator, or CONVERT_ERROR if it contains an invalid character.
+ */
+static inline size_t convert_expression_emit(const char* expression, int inputBase,
+        int outputBase, char* buffer, size_t capacity)
+{
+    if (!expression || inputBase < 2 || inputBase > 36 || 
+        outputBase < 2 || outputBase > 36) {
+        return CONVERT_ERROR;
+    }
+    
+    size_t len = strlen(expression);
+    size_t resultLen = 0;
+    size_t i = 0;
+    
+    while (i < len) {
+        char c = expression[i];
+        
+        // Check if it's the start of a number
+        int digit = char_to_digit(c);
+        if (digit >= 0 && digit < inputBase) {
+            // Parse the full number straight from the input base
+            unsigned long long value;
+            size_t digits = digit_run_parse(expression + i, len - i, inputBase, &value);
+            i += digits;
+            
+            char digitBuffer[64];
+            char* converted = format_digits(value, outputBase, digitBuffer + sizeof(digitBuffer));
+            size_t convertedLen = (size_t)(digitBuffer + sizeof(digitBuffer) - converted);
+            if (buffer && resultLen + convertedLen <= capacity) {
+                memcpy(buffer + resultLen, converted, convertedLen);
+            }
+            resultLen += convertedLen;
+        }
+        else if (is_operator(c) || isspace(c)) {
+            // Copy operator or whitespace directly
+            if (buffer && resultLen < capacity) {
+                buffer[resultLen] = c;
+            }
+            resultLen++;
+            i++;
+        }
+        else {
+            // Invalid character for the given base
+            return CONVERT_ERROR;
+        }
+    }
+    
+    return resultLen;
+}
+
+/*
+ * convert_expression_size()
+ * -------------------------
+ * Returns the exact length of convert_expression()'s result, not counting
+ * the terminator, or CONVERT_ERROR if the expression cannot be converted.
+ */
+static inline size_t convert_expression_size(const char* expression, int inputBase,
+        int outputBase)
+{
+    return convert_expression_emit(expression, inputBase, outputBase, NULL, 0);
+}
+
+/*
+ * convert_expression_into()
+ * -------------------------
+ * Converts all numbers in a mathematical expression from one base to another,
+ * writing the result into a caller-provided buffer followed by a terminator.
+ * No memory is allocated.
+ *
+ * expression: The mathematical expression string to convert
+ * inputBase: The base of numbers in the expression (2-36)
+ * outputBase: The base to convert numbers to (2-36)
+ * buffer: Buffer to receive the converted expression
+ * capacity: Size of buffer; convert_expression_size() + 1 suffices
+ *
+ * Returns: The number of characters written, not counting the terminator,
+ *          or CONVERT_ERROR if the expression cannot be converted or buffer
+ *          is too small (in which case buffer holds an empty string if
+ *          capacity > 0).
+ */
+static inline size_t convert_expression_into(const char* expression, int inputBase,
+        int outputBase, char* buffer, size_t capacity)
+{
+    if (!buffer || capacity == 0) {
+        return CONVERT_ERROR;
+    }
+    
+    size_t len = convert_expression_emit(expression, inputBase, outputBase, buffer, capacity);
+    if (len == CONVERT_ERROR || len >= capacity) {
+        buffer[0] = '\0';
+        return CONVERT_ERROR;
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+/*
+ * convert_expression_arena()
+ * --------------------------
+ * Converts all numbers in a mathematical expression from one base to another.
+ *
+ * arena: Scratch arena for the result, or NULL to use the heap
+ * expression: The mathematical expression string to convert
+ * inputBase: The base of numbers in the expression (2-36)
+ * outputBase: The base to convert numbers to (2-36)
+ *
+ * Returns: A string with converted numbers or NULL if error. The string lives
+ *          in arena until its next reset, or was allocated with malloc() if
+ *          arena is NULL (in which case the caller must free it).
+ */
+static inline char* convert_expression_arena(Arena* arena, const char* expression,
+        int inputBase, int outputBase)
+{
+    size_t len = convert_expression_size(expression, inputBase, outputBase);
+    if (len == CONVERT_ERROR) {
+        return NULL;
+    }
+    
+    char* result = (char*)arena_alloc(arena, len + 1);
+    if (result) {
+        convert_expression_into(expression, inputBase, outputBase, result, len + 1);
+    }
+    return result;
+}
+
+/*
+ * convert_expression()
+ * --------------------
+ * Heap-backed convert_expression_arena(): the string is allocated with
+ * malloc() and the caller must free it.
+ */
+static inline char* convert_expression(const char* expression, int inputBase, int outputBase)
+{
+    return convert_expression_arena(NULL, expression, inputBase, outputBase);
+}
+
+/*
+ * ExprOp
+ * ------
+ * Instructions of the postfix bytecode produced by compile_tokens(). Each
+ * one pops its operands from the evaluation stack and pushes its result.
+ */
+typedef enum {
+    EXPR_OP_CONST,   // Push a constant
+    EXPR_OP_LITERAL, // Push a literal that can be rebound between runs
+    EXPR_OP_NEG,     // Negate the top of the stack
+    EXPR_OP_ADD,
+    EXPR_OP_SUB,
+    EXPR_OP_MUL,
+    EXPR_OP_DIV,
+    EXPR_OP_MOD,
+    EXPR_OP_POW
+} ExprOp;
+
+/*
+ * ExprInstr
+ * ---------
+ * One bytecode instruction. value is the constant pushed by EXPR_OP_CONST,
+ * or the value currently bound to literal number slot for EXPR_OP_LITERAL.
+ */
+typedef struct {
+    ExprOp op;
+    uint32_t slot;
+    double value;
+} ExprInstr;
+
+#define EXPR_INLINE_CODE 16 // Instructions stored without allocation
+
+/*
+ * ExprProgram
+ * -----------
+ * A compiled expression. heap is NULL while the code fits in inlineCode,
+ * so short expressions compile and run without touching the heap. shape
+ * records the token pattern a bound program was compiled from, so new
+ * literals can be dropped into it by rebind_expr_program(). When arena is
+ * set, every buffer the program needs is taken from it instead of the heap,
+ * and the program must not outlive the arena's next reset.
+ */
+typedef struct {
+    ExprInstr* heap;         // Code once it outgrows inlineCode, else NULL
+    size_t length;           // Instructions in use
+    size_t capacity;         // Instructions available
+    size_t depth;            // Stack depth reached by the code so far
+    size_t maxDepth;         // Deepest stack the program needs
+    size_t literalCount;     // Number of EXPR_OP_LITERAL slots
+    bool bindLiterals;       // Literals are slots, not folded constants
+    unsigned char* shape;    // Token pattern of a bound program, else NULL
+    size_t shapeLength;      // Number of entries in shape
+    Arena* arena;            // Scratch arena for buffers, or NULL for the heap
+    ExprInstr inlineCode[EXPR_INLINE_CODE];
+} ExprProgram;
+
+/*
+ * expr_program_init()
+ * -------------------
+ * Initialises an empty program that allocates from the heap. Set arena
+ * afterwards to have it allocate from an arena instead.
+ */
+static inline void expr_program_init(ExprProgram* p)
+{
+    p->heap = NULL;
+    p->length = 0;
+    p->capacity = EXPR_INLINE_CODE;
+    p->depth = 0;
+    p->maxDepth = 0;
+    p->literalCount = 0;
+    p->bindLiterals = false;
+    p->shape = NULL;
+    p->shapeLength = 0;
+    p->arena = NULL;
+}
+
+/*
+ * expr_program_free()
+ * -------------------
+ * Releases any memory held by a program and leaves it empty, still
+ * allocating from the same arena.
+ */
+static inline void expr_program_free(ExprProgram* p)
+{
+    Arena* arena = p->arena;
+    arena_release(arena, p->shape);
+    arena_release(arena, p->heap);
+    expr_program_init(p);
+    p->arena = arena;
+}
+
+static inline ExprInstr* expr_program_code(ExprProgram* p)
+{
+    return p->heap ? p->heap : p->inlineCode;
+}
+
+static inline const ExprInstr* expr_program_code_const(const ExprProgram* p)
+{
+    return p->heap ? p->heap : p->inlineCode;
+}
+
+/*
+ * expr_apply()
+ * ------------
+ * Applies a binary operator to two values.
+ *
+ * Returns: 0 if successful, 1 on division or modulo by zero.
+ */
+static inline int expr_apply(ExprOp op, double left, double right, double* result)
+{
+    switch (op) {
+        case EXPR_OP_ADD: *result = left + right; return 0;
+        case EXPR_OP_SUB: *result = left - right; return 0;
+        case EXPR_OP_MUL: *result = left * right; return 0;
+        case EXPR_OP_DIV:
+            if (right == 0) {
+                return EVAL_FAIL(EVAL_FAILURE_DIVIDE_BY_ZERO);
+            }
+            *result = left / right;
+            return 0;
+        case EXPR_OP_MOD:
+            if (right == 0) {
+                return EVAL_FAIL(EVAL_FAILURE_DIVIDE_BY_ZERO);  // Modulo by zero
+            }
+            *result = fmod(left, right);
+            return 0;
+        case EXPR_OP_POW: *result = pow(left, right); return 0;
+        default: return 1;
+    }
+}
+
+/*
+ * expr_emit()
+ * -----------
+ * Appends an instruction to the program, folding it into the preceding
+ * constants when all of its operands are known. Because a constant
+ * subexpression always folds down to a single EXPR_OP_CONST, its operands
+ * are then exactly the last one or two instructions.
+ *
+ * Returns: 0 if successful, 1 if folding divided by zero or on allocation
+ *          failure.
+ */
+static inline int expr_emit(ExprProgram* p, ExprOp op, uint32_t slot, double value)
+{
+    ExprInstr* code = expr_program_code(p);
+    size_t n = p->length;
+    
+    if (op == EXPR_OP_NEG && n >= 1 && code[n - 1].op == EXPR_OP_CONST) {
+        code[n - 1].value = -code[n - 1].value;
+        return 0;
+    }
+    if (op >= EXPR_OP_ADD && n >= 2 &&
+            code[n - 2].op == EXPR_OP_CONST && code[n - 1].op == EXPR_OP_CONST) {
+        if (expr_apply(op, code[n - 2].value, code[n - 1].value, &code[n - 2].value) != 0) {
+            return 1;
+        }
+        p->length--;
+        p->depth--;
+        return 0;
+    }
+    
+    if (n == p->capacity) {
+        size_t capacity = p->capacity * 2;
+        ExprInstr* grown;
+        if (p->heap) {
+            grown = (ExprInstr*)arena_grow(p->arena, p->heap, n * sizeof(ExprInstr),
+                    capacity * sizeof(ExprInstr));
+        } else {
+            grown = (ExprInstr*)arena_alloc(p->arena, capacity * sizeof(ExprInstr));
+            if (grown) {
+                memcpy(grown, p->inlineCode, n * sizeof(ExprInstr));
+            }
+        }
+        if (!grown) {
+            return 1;
+        }
+        p->heap = grown;
+        p->capacity = capacity;
+        code = grown;
+    }
+    
+    code[n].op = op;
+    code[n].slot = slot;
+    code[n].value = value;
+    p->length = n + 1;
+    
+    // Keep track of the stack the program will need when it runs
+    if (op == EXPR_OP_CONST || op == EXPR_OP_LITERAL) {
+        if (++p->depth > p->maxDepth) {
+            p->maxDepth = p->depth;
+        }
+    } else if (op != EXPR_OP_NEG) {
+        p->depth--;
+    }
+    return 0;
+}
+
+/* Forward declarations for recursive descent compiler */
+static inline int compile_sum(ExprProgram* p, const Token** tok);
+static inline int compile_term(ExprProgram* p, const Token** tok);
+static inline int compile_factor(ExprProgram* p, const Token** tok);
+static inline int compile_power(ExprProgram* p, const Token** tok);
+static inline int compile_number(ExprProgram* p, const Token** tok);
+
+static inline int compile_number(ExprProgram* p, const Token** tok)
+{
+    const Token* t = *tok;
+    
+    // A sign written directly against a literal belongs to the number
+    bool negative = false;
+    if ((t->type == TOKEN_PLUS || t->type == TOKEN_MINUS) &&
+            t[1].type == TOKEN_NUMBER && t->text + 1 == t[1].text) {
+        negative = (t->type == TOKEN_MINUS);
+        t++;
+    }
+    
+    if (t->type != TOKEN_NUMBER) {
+        return 1;
+    }
+    
+    if (p->bindLiterals) {
+        if (expr_emit(p, EXPR_OP_LITERAL, (uint32_t)p->literalCount++, (double)t->value) != 0) {
+            return 1;
+        }
+    } else if (expr_emit(p, EXPR_OP_CONST, 0, (double)t->value) != 0) {
+        return 1;
+    }
+    if (negative && expr_emit(p, EXPR_OP_NEG, 0, 0) != 0) {
+        return 1;
+    }
+    
+    *tok = t + 1;
+    return 0;
+}
+
+static inline int compile_power(ExprProgram* p, const Token** tok)
+{
+    // Handle parentheses
+    if ((*tok)->type == TOKEN_LPAREN) {
+        (*tok)++;
+        if (compile_sum(p, tok) != 0) {
+            return 1;
+        }
+        if ((*tok)->type != TOKEN_RPAREN) {
+            return 1;
+        }
+        (*tok)++;
+    } else {
+        if (compile_number(p, tok) != 0) {
+            return 1;
+        }
+    }
+    
+    // Handle exponentiation (right-associative)
+    if ((*tok)->type == TOKEN_POWER) {
+        (*tok)++;
+        if (compile_power(p, tok) != 0) {
+            return 1;
+        }
+        return expr_emit(p, EXPR_OP_POW, 0, 0);
+    }
+    
+    return 0;
+}
+
+static inline int compile_factor(ExprProgram* p, const Token** tok)
+{
+    // Handle unary minus
+    bool negative = false;
+    if ((*tok)->type == TOKEN_MINUS) {
+        negative = true;
+        (*tok)++;
+    } else if ((*tok)->type == TOKEN_PLUS) {
+        (*tok)++;
+    }
+    
+    if (compile_power(p, tok) != 0) {
+        return 1;
+    }
+    
+    if (negative) {
+        return expr_emit(p, EXPR_OP_NEG, 0, 0);
+    }
+    
+    return 0;
+}
+
+static inline int compile_term(ExprProgram* p, const Token** tok)
+{
+    if (compile_factor(p, tok) != 0) {
+        return 1;
+    }
+    
+    while (1) {
+        TokenType op = (*tok)->type;
+        
+        if (op != TOKEN_MULTIPLY && op != TOKEN_DIVIDE && op != TOKEN_MODULO) {
+            break;
+        }
+        
+        (*tok)++;
+        if (compile_factor(p, tok) != 0) {
+            return 1;
+        }
+        
+        ExprOp instr = (op == TOKEN_MULTIPLY) ? EXPR_OP_MUL :
+                       (op == TOKEN_DIVIDE) ? EXPR_OP_DIV : EXPR_OP_MOD;
+        if (expr_emit(p, instr, 0, 0) != 0) {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+static inline int compile_sum(ExprProgram* p, const Token** tok)
+{
+    if (compile_term(p, tok) != 0) {
+        return 1;
     }
     
     while (1) {
-        skip_whitespace(expr);
-        char op = **expr;
+        TokenType op = (*tok)->type;
+        
+        if (op != TOKEN_PLUS && op != TOKEN_MINUS) {
+            break;
+        }
+        
+        (*tok)++;
+        if (compile_term(p, tok) != 0) {
+            return 1;
+        }
+        
+        if (expr_emit(p, op == TOKEN_PLUS ? EXPR_OP_ADD : EXPR_OP_SUB, 0, 0) != 0) {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/*
+ * expr_token_shape()
+ * ------------------
+ * Encodes a token for shape comparison: its type, plus whether it is a
+ * sign glued directly to the literal after it (which changes the parse).
+ */
+static inline unsigned char expr_token_shape(const Token* t)
+{
+    bool glued = (t->type == TOKEN_PLUS || t->type == TOKEN_MINUS) &&
+            t[1].type == TOKEN_NUMBER && t->text + 1 == t[1].text;
+    return (unsigned char)(t->type | (glued ? 0x80 : 0));
+}
+
+/*
+ * compile_tokens()
+ * ----------------
+ * Compiles a tokenized expression into postfix bytecode, folding every
+ * subexpression whose operands are constant. With bindLiterals false the
+ * literals themselves are constants, so a valid expression folds down to
+ * a single instruction; with bindLiterals true each literal becomes a slot
+ * that rebind_expr_program() can refill, and the program can be run again
+ * for every new set of literals without reparsing.
+ *
+ * tokens: Token array produced by tokenize_expression() (TOKEN_END terminated)
+ * bindLiterals: Whether literals should stay rebindable
+ * program: Initialised program to receive the code (any old code is freed)
+ *
+ * Returns: 0 if successful, 1 if the expression is malformed, a constant
+ *          subexpression divides by zero, or on allocation failure.
+ */
+static inline int compile_tokens(const Token* tokens, bool bindLiterals, ExprProgram* program)
+{
+    if (!tokens || !program) {
+        return 1;
+    }
+    
+    expr_program_free(program);
+    program->bindLiterals = bindLiterals;
+    
+    const Token* tok = tokens;
+    if (compile_sum(program, &tok) != 0 || tok->type != TOKEN_END) {
+        expr_program_free(program);
+        return 1;
+    }
+    
+    if (bindLiterals) {
+        size_t count = (size_t)(tok - tokens);
+        program->shape = (unsigned char*)arena_alloc(program->arena, count ? count : 1);
+        if (!program->shape) {
+            expr_program_free(program);
+            return 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            program->shape[i] = expr_token_shape(&tokens[i]);
+        }
+        program->shapeLength = count;
+    }
+    return 0;
+}
+
+/*
+ * run_expr_program()
+ * ------------------
+ * Runs a compiled program on a small value stack.
+ *
+ * program: Program produced by compile_tokens()
+ * literals: Values for the literal slots in order, or NULL to use the
+ *           values currently bound to the program
+ * result: Pointer to store the result
+ *
+ * Returns: 0 if successful, 1 if the program is empty, a division by zero
+ *          occurred, or the result is less than zero or >= 2^53.
+ */
+static inline int run_expr_program(const ExprProgram* program, const double* literals,
+        unsigned long long* result)
+{
+    if (!program || !result || program->length == 0) {
+        return 1;
+    }
+    
+    double stackBuffer[EXPR_INLINE_CODE];
+    double* stack = stackBuffer;
+    if (program->maxDepth > EXPR_INLINE_CODE) {
+        stack = (double*)arena_alloc(program->arena, program->maxDepth * sizeof(double));
+        if (!stack) {
+            return 1;
+        }
+    }
+    
+    const ExprInstr* code = expr_program_code_const(program);
+    size_t top = 0;
+    int status = 0;
+    for (size_t i = 0; i < program->length && status == 0; i++) {
+        switch (code[i].op) {
+            case EXPR_OP_CONST:
+                stack[top++] = code[i].value;
+                break;
+            case EXPR_OP_LITERAL:
+                stack[top++] = literals ? literals[code[i].slot] : code[i].value;
+                break;
+            case EXPR_OP_NEG:
+                stack[top - 1] = -stack[top - 1];
+                break;
+            default:
+                top--;
+                status = expr_apply(code[i].op, stack[top - 1], stack[top], &stack[top - 1]);
+                break;
+        }
+    }
+    double value = stack[0];
+    
+    if (stack != stackBuffer) {
+        arena_release(program->arena, stack);
+    }
+    
+    if (status != 0) {
+        return 1;
+    }
+    // Check for negative result, or one beyond 2^53 (largest exact integer in double)
+    if (value < 0 || value >= 9007199254740992.0) {
+        return EVAL_FAIL(EVAL_FAILURE_OUT_OF_RANGE);
+    }
+    
+    *result = (unsigned long long)value;
+    return 0;
+}
+
+/*
+ * evaluate_tokens_arena()
+ * -----------------------
+ * Evaluates a tokenized mathematical expression.
+ *
+ * arena: Scratch arena for the compiled program, or NULL to use the heap
+ * tokens: Token array produced by tokenize_expression() (TOKEN_END terminated)
+ * result: Pointer to store the result
+ *
+ * Returns: 0 if successful, 1 if the expression could not be evaluated or is NULL,
+ *          or if the result is less than zero or >= 2^53.
+ *
+ * Note: The expression is compiled with constant folding, so evaluation
+ *       happens in the compiler and the program is a single constant.
+ */
+static inline int evaluate_tokens_arena(Arena* arena, const Token* tokens,
+        unsigned long long* result)
+{
+    if (!tokens || !result) {
+        return 1;
+    }
+    
+    ExprProgram program;
+    expr_program_init(&program);
+    program.arena = arena;
+    
+    int status = compile_tokens(tokens, false, &program);
+    if (status == 0) {
+        status = run_expr_program(&program, NULL, result);
+    }
+    
+    expr_program_free(&program);
+    return status;
+}
+
+/*
+ * evaluate_tokens()
+ * -----------------
+ * evaluate_tokens_arena() with the compiled program on the heap.
+ */
+static inline int evaluate_tokens(const Token* tokens, unsigned long long* result)
+{
+    return evaluate_tokens_arena(NULL, tokens, result);
+}
+
+/*
+ * Precision
+ * ---------
+ * Arithmetic used to evaluate expressions.
+ */
+typedef enum {
+    PRECISION_DOUBLE, // IEEE doubles; results must be below 2^53
+    PRECISION_BIG,    // Arbitrary-precision integers (see bigint.h)
+    PRECISION_INT     // Checked 64-bit integers, arbitrary precision on overflow
+} Precision;
+
+/*
+ * BigParser
+ * ---------
+ * Cursor state for the arbitrary-precision recursive descent parser.
+ */
+typedef struct {
+    const Token* tok; // Next token to consume
+    int base;         // Base the literals are written in
+    size_t u64Digits; // Literals with at most this many digits fit in 64 bits
+} BigParser;
+
+/*
+ * evaluate_tokens_big()
+ * ---------------------
+ * Evaluates a tokenized mathematical expression with arbitrary-precision
+ * integers. Division truncates toward zero and '%' takes the sign of the
+ * dividend, as in C. A negative exponent divides 1 by the power, so it
+ * only yields a non-zero result for bases 1 and -1.
+ *
+ * tokens: Token array produced by tokenize_expression() (TOKEN_END terminated)
+ * base: The base the literals in the tokens were written in (2-36)
+ * result: Initialised BigInt to store the result
+ *
+ * Returns: 0 if successful, 1 if the expression could not be evaluated,
+ *          a division by zero occurred, an intermediate value grew beyond
+ *          BIGINT_MAX_LIMBS, or the result is less than zero.
+ */
+
+/* Forward declarations for recursive descent parser */
+static inline int parse_expression_big(BigParser* p, BigInt* result);
+static inline int parse_term_big(BigParser* p, BigInt* result);
+static inline int parse_factor_big(BigParser* p, BigInt* result);
+static inline int parse_power_big(BigParser* p, BigInt* result);
+static inline int parse_number_big(BigParser* p, BigInt* result);
+
+static inline int parse_number_big(BigParser* p, BigInt* result)
+{
+    const Token* t = p->tok;
+    
+    // A sign written directly against a literal belongs to the number
+    bool negative = false;
+    if ((t->type == TOKEN_PLUS || t->type == TOKEN_MINUS) &&
+            t[1].type == TOKEN_NUMBER && t->text + 1 == t[1].text) {
+        negative = (t->type == TOKEN_MINUS);
+        t++;
+    }
+    
+    if (t->type != TOKEN_NUMBER) {
+        return 1;
+    }
+    
+    // Short literals were already parsed exactly by the tokenizer
+    if (t->length <= p->u64Digits) {
+        bigint_set_u64(result, t->value);
+    } else if (bigint_from_str(result, t->text, t->length, p->base) != 0) {
+        return 1;
+    }
+    result->negative = negative && result->size > 0;
+    
+    p->tok = t + 1;
+    return 0;
+}
+
+/*
+ * bigint_pow_signed()
+ * -------------------
+ * Computes r = base^exponent for a possibly negative or huge exponent.
+ * Returns: 0 if successful, 1 if the result is undefined or too large.
+ */
+static inline int bigint_pow_signed(BigInt* r, const BigInt* base, const BigInt* exponent)
+{
+    bool unit = base->size == 1 && bigint_limbs_const(base)[0] == 1;
+    
+    if (exponent->negative) {
+        if (base->size == 0) {
+            return EVAL_FAIL(EVAL_FAILURE_DIVIDE_BY_ZERO);
+        }
+        if (!unit) {
+            bigint_set_u64(r, 0);
+            return 0;
+        }
+    }
+    
+    if (!bigint_fits_u64(exponent)) {
+        // Only 0, 1 and -1 survive an exponent this large
+        if (base->size != 0 && !unit) {
+            return EVAL_FAIL(EVAL_FAILURE_OUT_OF_RANGE);
+        }
+        uint64_t parity = bigint_limbs_const(exponent)[0] & 1;
+        return bigint_pow(r, base, 2 + parity);
+    }
+    
+    if (bigint_pow(r, base, bigint_mag_u64(exponent)) != 0) {
+        return EVAL_FAIL(EVAL_FAILURE_OUT_OF_RANGE);
+    }
+    return 0;
+}
+
+static inline int parse_power_big(BigParser* p, BigInt* result)
+{
+    // Handle parentheses
+    if (p->tok->type == TOKEN_LPAREN) {
+        p->tok++;
+        if (parse_expression_big(p, result) != 0) {
+            return 1;
+        }
+        if (p->tok->type != TOKEN_RPAREN) {
+            return 1;
+        }
+        p->tok++;
+    } else {
+        if (parse_number_big(p, result) != 0) {
+            return 1;
+        }
+    }
+    
+    // Handle exponentiation (right-associative)
+    if (p->tok->type == TOKEN_POWER) {
+        p->tok++;
+        BigInt exponent;
+        bigint_init(&exponent);
+        int status = parse_power_big(p, &exponent);
+        if (status == 0) {
+            status = bigint_pow_signed(result, result, &exponent);
+        }
+        bigint_free(&exponent);
+        return status;
+    }
+    
+    return 0;
+}
+
+static inline int parse_factor_big(BigParser* p, BigInt* result)
+{
+    // Handle unary minus
+    bool negative = false;
+    if (p->tok->type == TOKEN_MINUS) {
+        negative = true;
+        p->tok++;
+    } else if (p->tok->type == TOKEN_PLUS) {
+        p->tok++;
+    }
+    
+    if (parse_power_big(p, result) != 0) {
+        return 1;
+    }
+    
+    if (negative && result->size > 0) {
+        result->negative = !result->negative;
+    }
+    
+    return 0;
+}
+
+static inline int parse_term_big(BigParser* p, BigInt* result)
+{
+    if (parse_factor_big(p, result) != 0) {
+        return 1;
+    }
+    
+    BigInt right;
+    bigint_init(&right);
+    int status = 0;
+    
+    while (status == 0) {
+        TokenType op = p->tok->type;
+        
+        if (op != TOKEN_MULTIPLY && op != TOKEN_DIVIDE && op != TOKEN_MODULO) {
+            break;
+        }
+        
+        p->tok++;
+        if (parse_factor_big(p, &right) != 0) {
+            status = 1;
+        } else if (op == TOKEN_MULTIPLY) {
+            status = bigint_mul(result, result, &right);
+        } else if (right.size == 0) {
+            status = EVAL_FAIL(EVAL_FAILURE_DIVIDE_BY_ZERO);
+        } else if (op == TOKEN_DIVIDE) {
+            status = bigint_divmod(result, NULL, result, &right);
+        } else {
+            status = bigint_divmod(NULL, result, result, &right);
+        }
+    }
+    
+    bigint_free(&right);
+    return status;
+}
+
+static inline int parse_expression_big(BigParser* p, BigInt* result)
+{
+    if (parse_term_big(p, result) != 0) {
+        return 1;
+    }
+    
+    BigInt right;
+    bigint_init(&right);
+    int status = 0;
+    
+    while (status == 0) {
+        TokenType op = p->tok->type;
         
-        if (op != '*' && op != '/' && op != '%') {
+        if (op != TOKEN_PLUS && op != TOKEN_MINUS) {
             break;
         }
         
-        (*expr)++;
-        double right;
-        if (parse_factor(expr, &right) != 0) {
+        p->tok++;
+        if (parse_term_big(p, &right) != 0) {
+            status = 1;
+        } else if (op == TOKEN_PLUS) {
+            status = bigint_add(result, result, &right);
+        } else {
+            status = bigint_sub(result, result, &right);
+        }
+    }
+    
+    bigint_free(&right);
+    return status;
+}
+
+static inline int evaluate_tokens_big(const Token* tokens, int base, BigInt* result)
+{
+    if (!tokens || !result || base < 2 || base > 36) {
+        return 1;
+    }
+    
+    // Literals up to a full 64-bit chunk of digits never overflow
+    BigParser parser = {tokens, base, (size_t)RADIX_CHUNKS[base].digits64};
+    
+    if (parse_expression_big(&parser, result) != 0) {
+        return 1;
+    }
+    
+    // Check for trailing tokens
+    if (parser.tok->type != TOKEN_END) {
+        return 1;
+    }
+    
+    // Check for negative result
+    if (result->negative) {
+        return EVAL_FAIL(EVAL_FAILURE_OUT_OF_RANGE);
+    }
+    
+    return 0;
+}
+
+/*
+ * IntParser
+ * ---------
+ * Cursor state for the checked 64-bit recursive descent parser.
+ */
+typedef struct {
+    const Token* tok; // Next token to consume
+    size_t u64Digits; // Literals with at most this many digits fit in 64 bits
+} IntParser;
+
+#define INT_OVERFLOW 2 // A value left the range of int64_t
+#define EVAL_WIDE 2    // Exact result too wide for 64 bits (see evaluate_tokens_int())
+
+/*
+ * evaluate_tokens_int()
+ * ---------------------
+ * Evaluates a tokenized mathematical expression exactly, in checked signed
+ * 64-bit integers, with no floating point at all. Division truncates toward
+ * zero and '%' takes the sign of the dividend, as in C; '^' is computed by
+ * squaring, and a negative exponent yields 0 unless the base is 1 or -1.
+ * These are the rules of evaluate_tokens_big(), to which the expression is
+ * handed whenever a literal, an intermediate value or the result does not
+ * fit in 64 bits, so the result is the same whichever engine produced it.
+ *
+ * tokens: Token array produced by tokenize_expression() (TOKEN_END terminated)
+ * base: The base the literals in the tokens were written in (2-36)
+ * result: Pointer to store a result that fits in 64 bits
+ * wide: Initialised BigInt to store a wider result, or NULL to treat such
+ *       a result as an error
+ *
+ * Returns: 0 if the result is in *result, EVAL_WIDE if it is in *wide, or
+ *          1 if the expression could not be evaluated, a division by zero
+ *          occurred, or the result is less than zero.
+ */
+
+/* Forward declarations for recursive descent parser */
+static inline int parse_expression_int(IntParser* p, int64_t* result);
+static inline int parse_term_int(IntParser* p, int64_t* result);
+static inline int parse_factor_int(IntParser* p, int64_t* result);
+static inline int parse_power_int(IntParser* p, int64_t* result);
+static inline int parse_number_int(IntParser* p, int64_t* result);
+
+static inline int parse_number_int(IntParser* p, int64_t* result)
+{
+    const Token* t = p->tok;
+    
+    // A sign written directly against a literal belongs to the number
+    bool negative = false;
+    if ((t->type == TOKEN_PLUS || t->type == TOKEN_MINUS) &&
+            t[1].type == TOKEN_NUMBER && t->text + 1 == t[1].text) {
+        negative = (t->type == TOKEN_MINUS);
+        t++;
+    }
+    
+    if (t->type != TOKEN_NUMBER) {
+        return 1;
+    }
+    
+    // Longer literals may have wrapped in the tokenizer
+    if (t->length > p->u64Digits || t->value > (unsigned long long)INT64_MAX) {
+        return INT_OVERFLOW;
+    }
+    *result = negative ? -(int64_t)t->value : (int64_t)t->value;
+    
+    p->tok = t + 1;
+    return 0;
+}
+
+/*
+ * int_pow()
+ * ---------
+ * Computes *result = base^exponent by squaring.
+ * Returns: 0 if successful, 1 for 0 to a negative power, INT_OVERFLOW if
+ *          the result does not fit in int64_t.
+ */
+static inline int int_pow(int64_t base, int64_t exponent, int64_t* result)
+{
+    if (exponent < 0) {
+        if (base == 0) {
+            return EVAL_FAIL(EVAL_FAILURE_DIVIDE_BY_ZERO);
+        }
+        // Only 1 and -1 survive a negative exponent
+        *result = (base == -1 && (exponent & 1)) ? -1 : (base == 1 || base == -1);
+        return 0;
+    }
+    
+    int64_t acc = 1;
+    while (1) {
+        if ((exponent & 1) && __builtin_mul_overflow(acc, base, &acc)) {
+            return INT_OVERFLOW;
+        }
+        exponent >>= 1;
+        if (exponent == 0) {
+            break;
+        }
+        if (__builtin_mul_overflow(base, base, &base)) {
+            return INT_OVERFLOW;
+        }
+    }
+    *result = acc;
+    return 0;
+}
+
+static inline int parse_power_int(IntParser* p, int64_t* result)
+{
+    int status;
+    
+    // Handle parentheses
+    if (p->tok->type == TOKEN_LPAREN) {
+        p->tok++;
+        if ((status = parse_expression_int(p, result)) != 0) {
+            return status;
+        }
+        if (p->tok->type != TOKEN_RPAREN) {
             return 1;
         }
+        p->tok++;
+    } else if ((status = parse_number_int(p, result)) != 0) {
+        return status;
+    }
+    
+    // Handle exponentiation (right-associative)
+    if (p->tok->type == TOKEN_POWER) {
+        p->tok++;
+        int64_t exponent;
+        if ((status = parse_power_int(p, &exponent)) != 0) {
+            return status;
+        }
+        return int_pow(*result, exponent, result);
+    }
+    
+    return 0;
+}
+
+static inline int parse_factor_int(IntParser* p, int64_t* result)
+{
+    // Handle unary minus
+    bool negative = false;
+    if (p->tok->type == TOKEN_MINUS) {
+        negative = true;
+        p->tok++;
+    } else if (p->tok->type == TOKEN_PLUS) {
+        p->tok++;
+    }
+    
+    int status = parse_power_int(p, result);
+    if (status != 0) {
+        return status;
+    }
+    
+    if (negative) {
+        if (*result == INT64_MIN) {
+            return INT_OVERFLOW;
+        }
+        *result = -*result;
+    }
+    
+    return 0;
+}
+
+static inline int parse_term_int(IntParser* p, int64_t* result)
+{
+    int status = parse_factor_int(p, result);
+    
+    while (status == 0) {
+        TokenType op = p->tok->type;
+        
+        if (op != TOKEN_MULTIPLY && op != TOKEN_DIVIDE && op != TOKEN_MODULO) {
+            break;
+        }
         
-        if (op == '*') {
-            *result *= right;
-        } else if (op == '/') {
-            if (right == 0) {
-                return 1;  // Division by zero
+        p->tok++;
+        int64_t right;
+        if ((status = parse_factor_int(p, &right)) != 0) {
+            break;
+        }
+        if (op == TOKEN_MULTIPLY) {
+            if (__builtin_mul_overflow(*result, right, result)) {
+                status = INT_OVERFLOW;
             }
-            *result /= right;
-        } else if (op == '%') {
-            if (right == 0) {
-                return 1;  // Modulo by zero
+        } else if (right == 0) {
+            status = EVAL_FAIL(EVAL_FAILURE_DIVIDE_BY_ZERO);
+        } else if (right == -1) {
+            // INT64_MIN / -1 is the one quotient that overflows
+            if (op == TOKEN_MODULO) {
+                *result = 0;
+            } else if (*result == INT64_MIN) {
+                status = INT_OVERFLOW;
+            } else {
+                *result = -*result;
             }
-            *result = fmod(*result, right);
+        } else {
+            *result = op == TOKEN_DIVIDE ? *result / right : *result % right;
         }
     }
     
-    return 0;
+    return status;
 }
 
-static inline int parse_expression(const char** expr, double* result)
+static inline int parse_expression_int(IntParser* p, int64_t* result)
 {
-    if (parse_term(expr, result) != 0) {
-        return 1;
-    }
+    int status = parse_term_int(p, result);
     
-    while (1) {
-        skip_whitespace(expr);
-        char op = **expr;
+    while (status == 0) {
+        TokenType op = p->tok->type;
         
-        if (op != '+' && op != '-') {
+        if (op != TOKEN_PLUS && op != TOKEN_MINUS) {
             break;
         }
         
-        (*expr)++;
-        double right;
-        if (parse_term(expr, &right) != 0) {
+        p->tok++;
+        int64_t right;
+        if ((status = parse_term_int(p, &right)) != 0) {
+            break;
+        }
+        bool overflow = op == TOKEN_PLUS ? __builtin_add_overflow(*result, right, result)
+                                         : __builtin_sub_overflow(*result, right, result);
+        if (overflow) {
+            status = INT_OVERFLOW;
+        }
+    }
+    
+    return status;
+}
+
+static inline int evaluate_tokens_int(const Token* tokens, int base,
+        unsigned long long* result, BigInt* wide)
+{
+    if (!tokens || !result || base < 2 || base > 36) {
+        return 1;
+    }
+    
+    IntParser parser = {tokens, (size_t)RADIX_CHUNKS[base].digits64};
+    int64_t value;
+    int status = parse_expression_int(&parser, &value);
+    if (status == 0) {
+        // Check for trailing tokens and for a negative result
+        if (parser.tok->type != TOKEN_END) {
             return 1;
         }
-        
-        if (op == '+') {
-            *result += right;
+        if (value < 0) {
+            return EVAL_FAIL(EVAL_FAILURE_OUT_OF_RANGE);
+        }
+        *result = (unsigned long long)value;
+        return 0;
+    }
+    if (status != INT_OVERFLOW) {
+        return 1;
+    }
+    
+    // Only an overflow pays for bignum arithmetic
+    BigInt local;
+    BigInt* big = wide ? wide : &local;
+    if (!wide) {
+        bigint_init(&local);
+    }
+    status = evaluate_tokens_big(tokens, base, big);
+    if (status == 0) {
+        if (bigint_fits_u64(big)) {
+            *result = bigint_mag_u64(big);
         } else {
-            *result -= right;
+            status = wide ? EVAL_WIDE : EVAL_FAIL(EVAL_FAILURE_OUT_OF_RANGE);
+        }
+    }
+    if (!wide) {
+        bigint_free(&local);
+    }
+    return status;
+}
+
+/*
+ * tokenize_into_buffer()
+ * ----------------------
+ * Tokenizes an expression into stackTokens (TOKEN_STACK_CAPACITY entries)
+ * when it is short enough, or into an array taken from arena (or the heap
+ * if arena is NULL) otherwise.
+ *
+ * Returns: The token array, or NULL if tokenizing failed. If the returned
+ *          pointer differs from stackTokens the caller must give it back
+ *          with arena_release().
+ */
+static inline Token* tokenize_into_buffer(const char* expression, size_t len,
+        int inputBase, Token* stackTokens, Arena* arena)
+{
+    Token* tokens = stackTokens;
+    size_t capacity = len + 1;
+    if (capacity > TOKEN_STACK_CAPACITY) {
+        tokens = (Token*)arena_alloc(arena, capacity * sizeof(Token));
+        if (!tokens) {
+            return NULL;
         }
     }
     
-    return 0;
+    size_t count;
+    if (tokenize_expression(expression, len, inputBase, tokens, capacity, &count) != 0) {
+        if (tokens != stackTokens) {
+            arena_release(arena, tokens);
+        }
+        return NULL;
+    }
+    return tokens;
 }
 
-static inline int evaluate_expression(const char* expression, unsigned long long* result)
+/*
+ * evaluate_expression_in_base_arena()
+ * -----------------------------------
+ * Tokenizes and evaluates an expression whose numbers are written in
+ * inputBase, without converting them to decimal text first. Short
+ * expressions are tokenized into a stack buffer; only expressions longer
+ * than TOKEN_STACK_CAPACITY characters allocate a token array.
+ *
+ * arena: Scratch arena for long expressions, or NULL to use the heap
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ * result: Pointer to store the result
+ *
+ * Returns: 0 if successful, 1 if the expression could not be converted or
+ *          evaluated (see evaluate_tokens()).
+ */
+static inline int evaluate_expression_in_base_arena(Arena* arena, const char* expression,
+        size_t len, int inputBase, unsigned long long* result)
 {
     if (!expression || !result) {
         return 1;
     }
     
-    const char* expr = expression;
-    double evalResult;
+    EVAL_FAIL_RESET();
+    STATS_CLOCK(stageStart);
+    Token stackTokens[TOKEN_STACK_CAPACITY];
+    Token* tokens = tokenize_into_buffer(expression, len, inputBase, stackTokens, arena);
+    STATS_LAP(STATS_TOKENIZE, stageStart);
+    if (!tokens) {
+        return 1;
+    }
+    
+    int status = evaluate_tokens_arena(arena, tokens, result);
+    STATS_LAP(STATS_EVALUATE, stageStart);
     
-    if (parse_expression(&expr, &evalResult) != 0) {
+    if (tokens != stackTokens) {
+        arena_release(arena, tokens);
+    }
+    return status;
+}
+
+/*
+ * evaluate_expression_in_base()
+ * -----------------------------
+ * evaluate_expression_in_base_arena() with long token arrays on the heap.
+ */
+static inline int evaluate_expression_in_base(const char* expression, size_t len, int inputBase,
+        unsigned long long* result)
+{
+    return evaluate_expression_in_base_arena(NULL, expression, len, inputBase, result);
+}
+
+/*
+ * compile_expression()
+ * --------------------
+ * Tokenizes an expression whose numbers are written in inputBase and
+ * compiles it with compile_tokens().
+ *
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ * bindLiterals: Whether literals should stay rebindable
+ * program: Initialised program to receive the code
+ *
+ * Returns: 0 if successful, 1 if the expression could not be converted or
+ *          compiled.
+ */
+static inline int compile_expression(const char* expression, size_t len,
+        int inputBase, bool bindLiterals, ExprProgram* program)
+{
+    if (!expression || !program) {
         return 1;
     }
     
-    // Check for trailing characters
-    skip_whitespace(&expr);
-    if (*expr != '\0') {
+    Token stackTokens[TOKEN_STACK_CAPACITY];
+    Token* tokens = tokenize_into_buffer(expression, len, inputBase, stackTokens,
+            program->arena);
+    if (!tokens) {
         return 1;
     }
     
-    // Check for negative result
-    if (evalResult < 0) {
+    int status = compile_tokens(tokens, bindLiterals, program);
+    
+    if (tokens != stackTokens) {
+        arena_release(program->arena, tokens);
+    }
+    return status;
+}
+
+/*
+ * rebind_expr_program()
+ * ---------------------
+ * Binds the literals of a new expression to a program compiled with
+ * bindLiterals, so it can be run again without parsing. The expression
+ * must have the same shape as the original: the same operators and
+ * parentheses in the same order, with only the literals changed.
+ *
+ * program: Program compiled with bindLiterals true
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ *
+ * Returns: 0 if successful, 1 if the program has no literal slots to bind,
+ *          the expression could not be converted, or its shape differs.
+ */
+static inline int rebind_expr_program(ExprProgram* program, const char* expression,
+        size_t len, int inputBase)
+{
+    if (!program || !expression || !program->shape) {
         return 1;
     }
     
-    // Check if result exceeds 2^53 (largest exact integer in double)
-    if (evalResult >= 9007199254740992.0) {  // 2^53
+    Token stackTokens[TOKEN_STACK_CAPACITY];
+    Token* tokens = tokenize_into_buffer(expression, len, inputBase, stackTokens,
+            program->arena);
+    if (!tokens) {
         return 1;
     }
     
-    *result = (unsigned long long)evalResult;
-    return 0;
+    int status = 0;
+    for (size_t i = 0; i < program->shapeLength && status == 0; i++) {
+        if (tokens[i].type == TOKEN_END || expr_token_shape(&tokens[i]) != program->shape[i]) {
+            status = 1;
+        }
+    }
+    if (status == 0 && tokens[program->shapeLength].type != TOKEN_END) {
+        status = 1;
+    }
+    
+    // Literals appear in the code in the same order as in the text
+    if (status == 0) {
+        ExprInstr* code = expr_program_code(program);
+        const Token* t = tokens;
+        for (size_t i = 0; i < program->length; i++) {
+            if (code[i].op == EXPR_OP_LITERAL) {
+                while (t->type != TOKEN_NUMBER) {
+                    t++;
+                }
+                code[i].value = (double)t->value;
+                t++;
+            }
+        }
+    }
+    
+    if (tokens != stackTokens) {
+        arena_release(program->arena, tokens);
+    }
+    return status;
+}
+
+/*
+ * evaluate_expression_big_arena()
+ * -------------------------------
+ * Arbitrary-precision counterpart of evaluate_expression_in_base().
+ *
+ * arena: Scratch arena for long expressions, or NULL to use the heap
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ * result: Initialised BigInt to store the result
+ *
+ * Returns: 0 if successful, 1 if the expression could not be converted or
+ *          evaluated (see evaluate_tokens_big()).
+ */
+static inline int evaluate_expression_big_arena(Arena* arena, const char* expression,
+        size_t len, int inputBase, BigInt* result)
+{
+    if (!expression || !result) {
+        return 1;
+    }
+    
+    EVAL_FAIL_RESET();
+    STATS_CLOCK(stageStart);
+    Token stackTokens[TOKEN_STACK_CAPACITY];
+    Token* tokens = tokenize_into_buffer(expression, len, inputBase, stackTokens, arena);
+    STATS_LAP(STATS_TOKENIZE, stageStart);
+    if (!tokens) {
+        return 1;
+    }
+    
+    int status = evaluate_tokens_big(tokens, inputBase, result);
+    STATS_LAP(STATS_EVALUATE, stageStart);
+    
+    if (tokens != stackTokens) {
+        arena_release(arena, tokens);
+    }
+    return status;
+}
+
+/*
+ * evaluate_expression_big()
+ * -------------------------
+ * evaluate_expression_big_arena() with long token arrays on the heap.
+ */
+static inline int evaluate_expression_big(const char* expression, size_t len, int inputBase,
+        BigInt* result)
+{
+    return evaluate_expression_big_arena(NULL, expression, len, inputBase, result);
+}
+
+/*
+ * evaluate_expression_int_arena()
+ * -------------------------------
+ * Checked 64-bit counterpart of evaluate_expression_in_base(), falling back
+ * to arbitrary precision on overflow (see evaluate_tokens_int()).
+ *
+ * arena: Scratch arena for long expressions, or NULL to use the heap
+ * expression: The expression text (need not be null terminated)
+ * len: Number of characters in the expression
+ * inputBase: The base of numbers in the expression (2-36)
+ * result: Pointer to store a result that fits in 64 bits
+ * wide: Initialised BigInt to store a wider result, or NULL
+ *
+ * Returns: 0 if the result is in *result, EVAL_WIDE if it is in *wide, or 1
+ *          if the expression could not be converted or evaluated.
+ */
+static inline int evaluate_expression_int_arena(Arena* arena, const char* expression,
+        size_t len, int inputBase, unsigned long long* result, BigInt* wide)
+{
+    if (!expression || !result) {
+        return 1;
+    }
+    
+    EVAL_FAIL_RESET();
+    STATS_CLOCK(stageStart);
+    Token stackTokens[TOKEN_STACK_CAPACITY];
+    Token* tokens = tokenize_into_buffer(expression, len, inputBase, stackTokens, arena);
+    STATS_LAP(STATS_TOKENIZE, stageStart);
+    if (!tokens) {
+        return 1;
+    }
+    
+    int status = evaluate_tokens_int(tokens, inputBase, result, wide);
+    STATS_LAP(STATS_EVALUATE, stageStart);
+    
+    if (tokens != stackTokens) {
+        arena_release(arena, tokens);
+    }
+    return status;
+}
+
+/*
+ * evaluate_expression_int()
+ * -------------------------
+ * evaluate_expression_int_arena() with long token arrays on the heap.
+ */
+static inline int evaluate_expression_int(const char* expression, size_t len, int inputBase,
+        unsigned long long* result, BigInt* wide)
+{
+    return evaluate_expression_int_arena(NULL, expression, len, inputBase, result, wide);
+}
+
+/*
+ * evaluate_expression()
+ * ---------------------
+ * Evaluates a mathematical expression in base 10.
+ *
+ * expression: The mathematical expression string (must be in base 10)
+ * result: Pointer to store the result
+ *
+ * Returns: 0 if successful, 1 if the expression could not be evaluated or is NULL,
+ *          or if the result is less than zero or >= 2^53.
+ */
+static inline int evaluate_expression(const char* expression, unsigned long long* result)
+{
+    if (!expression || !result) {
+        return 1;
+    }
+    
+    return evaluate_expression_in_base(expression, strlen(expression), 10, result);
 }
 
 #endif /* UQBASEJUMP_H */